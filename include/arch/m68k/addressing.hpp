@@ -0,0 +1,21 @@
+#pragma once
+#include "arch/m68k/instruction.hpp"
+#include <optional>
+#include <vector>
+
+namespace GoldScorpion::m68k {
+
+	/**
+	 * Instructions that turn an array index in a data register into a byte offset, given the byte stride of
+	 * that index. Strides that are powers of two become shifts; anything else falls back to mulu, which only
+	 * takes a 16-bit stride.
+	 */
+	std::optional< std::vector< Instruction > > scaleIndex( OperandType index, long stride );
+
+	/**
+	 * Whether an address can be given as a sign-extended abs.w operand, which is two bytes and four cycles
+	 * cheaper than abs.l. On a 24-bit bus that is the bottom and the top 32KB of the address space.
+	 */
+	bool isShortAddress( long address );
+
+}
\ No newline at end of file
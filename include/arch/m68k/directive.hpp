@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+
+namespace GoldScorpion::m68k {
+
+	/**
+	 * A block of bytes under a label as dc.b directives, one line per NUL-terminated string, with printable
+	 * runs quoted
+	 */
+	std::string toByteDirectives( const std::string& label, const std::string& bytes );
+
+}
\ No newline at end of file
@@ -15,7 +15,8 @@ namespace GoldScorpion::m68k {
 		DIVIDE_UNSIGNED,
 		AND,
 		OR,
-		NOT
+		NOT,
+		SHIFT_LEFT
 	};
 
 	enum class OperatorSize {
@@ -0,0 +1,52 @@
+#pragma once
+#include "ast.hpp"
+#include "symbol.hpp"
+#include "error.hpp"
+#include "result_type.hpp"
+#include <string>
+#include <vector>
+
+namespace GoldScorpion::m68k::md {
+
+	// Work RAM on the MD; the top half of it is reachable with abs.w, and the stack grows down from its end
+	constexpr long RAM_START = 0xFF0000;
+	constexpr long RAM_SHORT_START = 0xFF8000;
+	constexpr long RAM_END = 0x1000000;
+
+	struct RamModule {
+		std::string module;
+		const Program* program;
+		const SymbolResolver* symbols;
+	};
+
+	struct RamPlacement {
+		std::string module;
+		std::string id;
+		std::string typeId;
+		long address;
+		long size;
+		// Static count of references, weighted by how deeply they are nested in loops
+		long references;
+	};
+
+	struct RamLayout {
+		// In order of address
+		std::vector< RamPlacement > placements;
+		long size;
+		long padding;
+		// Bytes from the first address past the last global to the end of RAM, for the stack
+		long stackSpace;
+		// Where the overlaid static frames start, if there are any
+		long staticFrames;
+	};
+
+	/**
+	 * Place the globals of every module in a target. The most referenced globals per byte go in the abs.w
+	 * window at the top of RAM and the rest just below it, each region ordered by alignment so that no padding
+	 * is needed between them. Static frames, when given, take the start of the window ahead of every global.
+	 */
+	Result< RamLayout, Error > layoutRam( const std::vector< RamModule >& modules, long staticFrameSize = 0 );
+
+	void printRamLayout( const RamLayout& layout );
+
+}
\ No newline at end of file
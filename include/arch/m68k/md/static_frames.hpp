@@ -0,0 +1,45 @@
+#pragma once
+#include "ast.hpp"
+#include "symbol.hpp"
+#include "frame_layout.hpp"
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace GoldScorpion::m68k::md {
+
+	struct StaticFrameModule {
+		std::string module;
+		const Program* program;
+		const SymbolResolver* symbols;
+		const std::map< const FunctionDeclaration*, FrameLayout >* frames;
+	};
+
+	struct StaticFrame {
+		std::string module;
+		std::string id;
+		// Offset into the static frame area, when the frame is in it
+		std::optional< long > offset;
+		long size;
+		// Why the frame stays on the stack
+		std::string reason;
+	};
+
+	struct StaticFrameLayout {
+		std::map< const FunctionDeclaration*, StaticFrame > frames;
+		// Most bytes of static frame that can be live at once
+		long size;
+	};
+
+	/**
+	 * Give every function that can never be active twice at once a fixed frame, overlaying the frames of
+	 * functions that are never active together. A function keeps its stack frame if it can reach itself
+	 * through the call graph, or if an interrupt handler can reach it, as the handler may run in the middle of
+	 * any other function.
+	 */
+	StaticFrameLayout layoutStaticFrames( const std::vector< StaticFrameModule >& modules );
+
+	void printStaticFrames( const StaticFrameLayout& layout, long address );
+
+}
\ No newline at end of file
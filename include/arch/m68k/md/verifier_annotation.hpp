@@ -3,6 +3,9 @@
 #include "memory_tracker.hpp"
 #include "token.hpp"
 #include "symbol.hpp"
+#include "error.hpp"
+#include "result_type.hpp"
+#include <optional>
 #include <variant>
 #include <string>
 #include <vector>
@@ -16,6 +19,11 @@ namespace GoldScorpion::m68k::md {
     // Defines the function below as the target for an MD interrupt.
     // Valid interrupt targets are:
     // "vblank", "hblank", "external", "addressException", "illegalException", "divException"
+    //
+    // `pad_pow2` (pad_pow2)
+    // Adjacent nodes: VarDeclaration of an array type
+    // Rounds every dimension but the last up to a power of two, so indexing the array
+    // shifts instead of multiplies at the cost of the padding RAM.
 
     using AnnotationValue = std::variant< std::string, long, bool >;
 
@@ -26,15 +34,21 @@ namespace GoldScorpion::m68k::md {
 
     struct AnnotationSettings {
         SymbolResolver& symbols;
-        std::optional< Token > nearestToken;
+        SourceSpan nearestSpan;
     };
 
-    AnnotationPackage getAnnotationPackage( const AssignmentExpression& node, AnnotationSettings settings );
+    Result< AnnotationPackage, Error > getAnnotationPackage( const AssignmentExpression& node, AnnotationSettings settings );
+
+    Result< AnnotationPackage, Error > getAnnotationFlag( const Primary& node, AnnotationSettings settings );
+
+    Result< std::vector< AnnotationPackage >, Error > getAnnotationPackageList( const Annotation& annotation, AnnotationSettings settings );
+
+    std::optional< Error > checkInterrupt( const std::optional< SymbolType >& functionReturnType, SourceSpan nearestSpan );
 
-    std::vector< AnnotationPackage > getAnnotationPackageList( const Annotation& annotation, AnnotationSettings settings );
+    std::optional< Error > checkFunction( const std::string& directive, SourceSpan nearestSpan, const std::optional< SymbolType >& functionReturnType );
 
-    void checkInterrupt( const std::optional< SymbolType >& functionReturnType, const std::optional< Token >& nearestToken );
+    std::optional< Error > checkVariable( const std::string& directive, SourceSpan nearestSpan, const SymbolType& variableType );
 
-    void checkFunction( const std::string& directive, const std::optional< Token >& nearestToken, const std::optional< SymbolType >& functionReturnType );
+    bool padsArrays( const std::vector< AnnotationPackage >& packages );
 
 }
\ No newline at end of file
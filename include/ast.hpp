@@ -38,6 +38,8 @@ namespace GoldScorpion {
 
 	struct Primary {
 		std::variant< Token, std::unique_ptr< struct Expression > > value;
+		// Set on literals produced by constant folding, so they keep the type of the expression they replaced
+		std::optional< TokenType > foldedType = {};
 	};
 
 	struct CallExpression {
@@ -75,7 +77,7 @@ namespace GoldScorpion {
 			std::unique_ptr< ArrayExpression >,
 			std::unique_ptr< Primary >
 		> value;
-		std::optional< Token > nearestToken;
+		SourceSpan nearestSpan;
 	};
 
 	struct ExpressionStatement {
@@ -117,7 +119,7 @@ namespace GoldScorpion {
 			std::unique_ptr< AsmStatement >,
 			std::unique_ptr< WhileStatement >
 		> value;
-		std::optional< Token > nearestToken;
+		SourceSpan nearestSpan;
 	};
 
 	struct Parameter {
@@ -138,7 +140,7 @@ namespace GoldScorpion {
 	struct FunctionDeclaration {
 		std::optional< Token > name;
 		std::vector< Parameter > arguments;
-		std::optional< Token > returnType;
+		std::optional< DataType > returnType;
 		std::vector< std::unique_ptr< struct Declaration > > body;
 	};
 
@@ -166,7 +168,7 @@ namespace GoldScorpion {
 			std::unique_ptr< ImportDeclaration >,
 			std::unique_ptr< Statement >
 		> value;
-		std::optional< Token > nearestToken;
+		SourceSpan nearestSpan;
 	};
 
 	struct Program {
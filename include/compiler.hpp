@@ -1,27 +1,169 @@
 #pragma once
 #include "ast.hpp"
-#include "result_type.hpp"
+#include "error.hpp"
 #include "symbol.hpp"
+#include "frame_layout.hpp"
+#include "module_resolver.hpp"
+#include "source_provider.hpp"
+#include "query.hpp"
+#include "utility.hpp"
 #include <string>
 #include <set>
+#include <map>
+#include <vector>
+#include <optional>
+#include <memory>
 
 namespace GoldScorpion {
 
-    struct CompilerSettings {
-        std::set< std::string >& activeFiles;
-        std::set< std::string >& resolvedFiles;
-        SymbolResolver& symbols;
+    /**
+     * A module that has been read, lexed and parsed, but not yet verified
+     */
+    struct ParsedFile {
+        bool read = false;
+        bool lexed = false;
+        // Only kept for --debug-lex
+        std::vector< Token > tokens;
+        std::optional< Program > tree;
+        // Why the file could not be opened, lexed or parsed
+        Diagnostics diagnostics;
+        // The file the spans in tokens and tree point into, dropped from the SourceMap along with them
+        SourceMap::RegisteredFile file;
+    };
+
+    struct CompileOptions {
+        // Modules are read from disk unless another provider is given
+        const SourceProvider* sources = nullptr;
+        // Roots to look for imports under when they are not found relative to the working directory
+        std::vector< std::string > searchPaths;
+        std::string outputPath;
+        // Write a make dependency file here when set
+        std::string depfilePath;
+        bool depfilePhonyTargets = false;
+        // Print a line as each module is lexed, parsed and validated
+        bool printProgress = true;
         bool printLex = false;
         bool printAst = false;
+        bool printAstMemory = false;
+        // Print the pooled string literals of each target
+        bool printStrings = false;
+        // Print where each global of a target was placed in RAM
+        bool printRamMap = false;
+        // Give functions that are never active twice at once overlaid frames at fixed addresses
+        bool staticFrames = false;
+    };
+
+    /**
+     * The outcome of verifying a module after everything it imports
+     */
+    struct ModuleCheck {
+        bool valid = false;
+        // What went wrong in this module alone; errors in its imports belong to them
+        Diagnostics diagnostics;
+        // What the module declares, if it got as far as being checked
+        std::shared_ptr< const SymbolResolver > symbols;
+    };
+
+    /**
+     * A verified module with its constants folded. The tree is a copy, so the parse result stays as it was parsed.
+     */
+    struct FoldedModule {
+        // Keeps the file the spans in tree point into
+        std::shared_ptr< const ParsedFile > parsed;
+        Program tree;
+        // Stack frame of every function in tree
+        std::map< const FunctionDeclaration*, FrameLayout > frames;
     };
 
     /**
-     * Return an unverified tree
+     * The compiler's state, kept as memoized queries over modules: the source of a module, its tree, its imports
+     * and whether it verified. Each result remembers which queries it read, so after a source changes only the
+     * results that depended on it are worked out again, and a result that comes out the same as before does not
+     * invalidate anything downstream of it. A long-running host can keep one database across builds.
+     * Not thread-safe, apart from prefetch, which parses in parallel internally.
      */
-    Result< Program, std::string > fileToTree( const std::string& path, CompilerSettings settings );
+    class QueryDatabase {
+        DiskSourceProvider disk;
+        CompileOptions options;
+        ModuleResolver modules;
+        Revision revision = 1;
+
+        std::map< std::string, Memo< VariantResult< Utility::File > > > sourceMemos;
+        std::map< std::string, Memo< std::shared_ptr< const ParsedFile > > > parseMemos;
+        std::map< std::string, Memo< std::vector< std::string > > > importMemos;
+        std::map< std::string, Memo< ModuleCheck > > checkMemos;
+        std::map< std::string, Memo< std::shared_ptr< const FoldedModule > > > foldMemos;
+
+        template< typename Value, typename Compute, typename Equal >
+        const Value& fetch( Memo< Value >& memo, const QueryKey& key, Compute compute, Equal equal );
+        bool stale( QueryState& state );
+        Revision refresh( const QueryKey& key );
+        ModuleCheck computeCheck( const std::string& module );
+        std::shared_ptr< const FoldedModule > computeFold( const std::string& module );
+
+    public:
+        explicit QueryDatabase( CompileOptions options );
+
+        QueryDatabase( const QueryDatabase& ) = delete;
+        QueryDatabase& operator=( const QueryDatabase& ) = delete;
+
+        const CompileOptions& getOptions() const;
+
+        /**
+         * Note that the source of a module may have changed. It is read again the next time it is needed.
+         */
+        void invalidate( const std::string& module );
 
-    Result< Program, std::string > fileToProgram( const std::string& path, CompilerSettings settings );
+        /**
+         * Note that any source may have changed
+         */
+        void invalidateAll();
 
-    int compile( const std::string& parseFilename, bool printLex, bool printAst );
+        std::string resolveName( const std::string& importPath );
+
+        const VariantResult< Utility::File >& source( const std::string& module );
+        std::shared_ptr< const ParsedFile > parse( const std::string& module );
+        const std::vector< std::string >& imports( const std::string& module );
+
+        /**
+         * Verify a module after its imports. Progress is printed as each module is checked, not when an earlier
+         * result is reused.
+         */
+        const ModuleCheck& check( const std::string& module );
+
+        /**
+         * Fold the constants of a copy of a module's tree and lay out its stack frames. Nothing if the module
+         * did not verify.
+         */
+        std::shared_ptr< const FoldedModule > fold( const std::string& module );
+
+        /**
+         * Bring the tree of every module reachable from these up to date, one level of the import graph at a time
+         * with the modules in each level parsed in parallel
+         */
+        void prefetch( const std::vector< std::string >& entryModules );
+    };
+
+    /**
+     * Read, lex and parse a file. Touches no shared state, so files can be parsed in parallel.
+     */
+    ParsedFile parseFile( const std::string& path, const SourceProvider& sources, bool keepTokens );
+
+    /**
+     * Build each entry file as a separate target. Modules the targets share are parsed and verified once. Errors
+     * go to diagnostics rather than the console. Returns whether each target built.
+     */
+    std::vector< bool > build( const std::vector< std::string >& entryFiles, const CompileOptions& options, Diagnostics& diagnostics );
+
+    /**
+     * Build against a database kept from earlier builds, so only what changed since is done again. Errors from
+     * every module the targets use are reported, including ones found by earlier builds.
+     */
+    std::vector< bool > build( const std::vector< std::string >& entryFiles, QueryDatabase& database, Diagnostics& diagnostics );
+
+    /**
+     * Build, then print every error and a line per target. Returns the process exit code.
+     */
+    int compile( const std::vector< std::string >& entryFiles, const CompileOptions& options );
 
 }
\ No newline at end of file
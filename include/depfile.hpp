@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace GoldScorpion {
+
+	struct DepfileRule {
+		std::string target;
+		// The entry file first, then every module it imports
+		std::vector< std::string > dependencies;
+	};
+
+	/**
+	 * Write rules in the format make and ninja read from compiler-generated dependency files. With phonyTargets,
+	 * every dependency but a rule's entry file also gets an empty rule of its own, so deleting a module doesn't
+	 * break the outer build.
+	 * Returns false if the file could not be written.
+	 */
+	bool writeDepfile( const std::string& path, const std::vector< DepfileRule >& rules, bool phonyTargets );
+
+}
\ No newline at end of file
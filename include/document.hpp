@@ -0,0 +1,96 @@
+#pragma once
+#include "ast.hpp"
+#include "token.hpp"
+#include "error.hpp"
+#include "symbol.hpp"
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <optional>
+#include <cstdint>
+
+namespace GoldScorpion {
+
+	// Zero-based, as editors count
+	struct DocumentPosition {
+		uint32_t line;
+		uint32_t character;
+	};
+
+	struct DocumentRange {
+		DocumentPosition start;
+		DocumentPosition end;
+	};
+
+	struct DocumentDiagnostic {
+		DocumentRange range;
+		std::string message;
+	};
+
+	/**
+	 * A source file kept parsed and checked while it is edited. The text is divided into blocks, each running from
+	 * the start of a top-level declaration to the start of the next. An edit re-lexes and re-parses only the blocks
+	 * it touches. Checking re-registers every declaration, which is cheap, but only re-verifies the function
+	 * bodies in edited blocks and those that mention a name whose declaration changed.
+	 */
+	class Document {
+		struct Block {
+			uint32_t firstLine;
+			uint32_t lineCount;
+			// The SourceMap file this block was lexed as, and the line in it that the block starts on
+			std::string chunk;
+			uint32_t chunkFirstLine;
+			// How many of program.statements belong to this block
+			size_t declarations;
+			std::vector< Token > tokens;
+			std::set< std::string > identifiers;
+			Diagnostics parseDiagnostics;
+		};
+
+		std::string fileId;
+		std::vector< std::string > lines;
+		std::vector< Block > blocks;
+		Program program;
+		size_t chunkCount = 0;
+		// Base span of each SourceMap file some block was lexed as, so that it can be dropped with the last one
+		std::map< std::string, SourceSpan > chunks;
+
+		SymbolResolver symbols;
+		bool checked = false;
+		Diagnostics checkDiagnostics;
+		std::map< const FunctionDeclaration*, Diagnostics > bodyDiagnostics;
+		std::set< const FunctionDeclaration* > dirtyBodies;
+
+		size_t firstDeclaration( size_t block ) const;
+		void reparse( size_t firstBlock, size_t lastBlock, uint32_t firstLine, uint32_t lineCount );
+		std::optional< DocumentPosition > locate( SourceSpan span ) const;
+
+	public:
+		Document( std::string fileId, const std::string& text );
+
+		~Document();
+
+		Document( const Document& ) = delete;
+		Document& operator=( const Document& ) = delete;
+
+		/**
+		 * Replace the text in range with text, or the whole document if there is no range
+		 */
+		void edit( std::optional< DocumentRange > range, const std::string& text );
+
+		/**
+		 * Check whatever the edits since the last check could have affected. Skipped while there are parse errors,
+		 * since the missing declarations would only produce noise.
+		 */
+		void check();
+
+		std::vector< DocumentDiagnostic > getDiagnostics() const;
+
+		/**
+		 * Describe the type of the symbol named at position, using the symbols from the last check
+		 */
+		std::optional< std::string > hover( DocumentPosition position );
+	};
+
+}
\ No newline at end of file
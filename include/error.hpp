@@ -1,16 +1,31 @@
 #pragma once
-#include "token.hpp"
+#include "source_map.hpp"
 #include <string>
-#include <optional>
+#include <vector>
 
 namespace GoldScorpion {
 
 	struct Error {
 		std::string text;
-		std::optional< Token > near;
+		SourceSpan near;
 
 		std::string toString() const;
-		void throwException() const;
+	};
+
+	/**
+	 * Sink for errors found while compiling. Phases report here and return, instead of unwinding.
+	 */
+	class Diagnostics {
+		std::vector< Error > errors;
+
+	public:
+		void report( Error error );
+		void append( const Diagnostics& other );
+		// Stable sort by the position of each error; errors without a position go last
+		void sortByPosition();
+
+		bool empty() const;
+		const std::vector< Error >& getErrors() const;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include "ast.hpp"
+#include "symbol.hpp"
+#include <map>
+#include <optional>
+#include <string>
+
+namespace GoldScorpion {
+
+	struct FrameSlot {
+		long offset;
+		long size;
+	};
+
+	/**
+	 * Where each local of a function lives in its stack frame, in bytes from the bottom of the frame. Locals
+	 * that are never live at the same time share bytes.
+	 */
+	struct FrameLayout {
+		std::map< const VarDeclaration*, FrameSlot > locals;
+		std::map< const ForStatement*, FrameSlot > indices;
+		long size;
+		// What the frame would take if every local had bytes of its own
+		long unsharedSize;
+	};
+
+	/**
+	 * Lay out the frame of a verified function. symbols must be the table the function was verified against,
+	 * and contextTypeId the type a method belongs to. Fails only if a local has a type with no known size.
+	 */
+	std::optional< FrameLayout > layoutFrame( const std::string& fileId, const FunctionDeclaration& function, const SymbolResolver& symbols, const std::optional< std::string >& contextTypeId = {} );
+
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+// Everything needed to embed the compiler: link against libgoldscorpion.a and include this header
+
+#include "compiler.hpp"
+#include "verifier.hpp"
+#include "source_provider.hpp"
+#include "source_map.hpp"
+#include "error.hpp"
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <variant>
+#include <optional>
+#include <cstddef>
+
+namespace GoldScorpion::Json {
+
+	struct Value;
+	using Array = std::vector< Value >;
+	using Object = std::map< std::string, Value >;
+
+	/**
+	 * A JSON document, just enough of one for the language server protocol
+	 */
+	struct Value {
+		std::variant< std::nullptr_t, bool, double, std::string, Array, Object > value;
+
+		Value() : value( nullptr ) {}
+		Value( std::nullptr_t ) : value( nullptr ) {}
+		Value( bool boolean ) : value( boolean ) {}
+		Value( int number ) : value( ( double ) number ) {}
+		Value( long number ) : value( ( double ) number ) {}
+		Value( unsigned int number ) : value( ( double ) number ) {}
+		Value( size_t number ) : value( ( double ) number ) {}
+		Value( double number ) : value( number ) {}
+		Value( const char* string ) : value( std::string( string ) ) {}
+		Value( std::string string ) : value( std::move( string ) ) {}
+		Value( Array array ) : value( std::move( array ) ) {}
+		Value( Object object ) : value( std::move( object ) ) {}
+
+		/**
+		 * The member at key, if this is an object that has one
+		 */
+		const Value* get( const std::string& key ) const;
+
+		std::optional< double > getNumber() const;
+		std::optional< std::string > getString() const;
+		const Array* getArray() const;
+		const Object* getObject() const;
+		bool isNull() const;
+	};
+
+	std::optional< Value > parse( const std::string& text );
+	std::string serialize( const Value& value );
+
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+#include <istream>
+#include <ostream>
+
+namespace GoldScorpion {
+
+	/**
+	 * Serve the language server protocol over a pair of streams until the client says to exit. Returns the exit
+	 * code the protocol asks for.
+	 */
+	int runLanguageServer( std::istream& input, std::ostream& output );
+
+}
\ No newline at end of file
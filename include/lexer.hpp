@@ -1,10 +1,15 @@
 #pragma once
 #include "token.hpp"
 #include "result_type.hpp"
+#include "error.hpp"
+#include "source_map.hpp"
 #include <vector>
 
 namespace GoldScorpion {
 
-	VariantResult< std::vector< Token > > getTokens( std::string body );
+	/**
+	 * Split a file into tokens. start is the span the SourceMap gave the file's first character.
+	 */
+	Result< std::vector< Token >, Error > getTokens( std::string body, SourceSpan start );
 
 }
\ No newline at end of file
@@ -7,4 +7,6 @@ namespace GoldScorpion {
 
     void printSuccess( const std::string& message );
 
+    void printInfo( const std::string& message );
+
 }
\ No newline at end of file
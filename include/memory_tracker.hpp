@@ -4,6 +4,8 @@
 #include <optional>
 #include <variant>
 #include <stack>
+#include <unordered_map>
+#include <cstddef>
 
 namespace GoldScorpion {
 
@@ -32,6 +34,8 @@ namespace GoldScorpion {
 	struct UserDefinedType {
 		std::string id;
 		std::vector< UdtField > fields;
+		// Field id to position in fields
+		std::unordered_map< std::string, size_t > fieldIndex;
 	};
 
 	struct MemoryElement {
@@ -63,13 +67,35 @@ namespace GoldScorpion {
 		long udtItems;
 	};
 
+	// Elements are laid out as they arrive, so where each one starts is fixed at insertion
+	struct SegmentEntry {
+		MemoryElement value;
+		// Bytes before this element in its segment, counting from the bottom of the stack frame
+		long base;
+	};
+
 	class MemoryTracker {
-		std::vector< MemoryElement > textSegment;
-		std::vector< MemoryElement > dataSegment;
-		std::vector< MemoryElement > stack;
+		std::vector< SegmentEntry > textSegment;
+		std::vector< SegmentEntry > dataSegment;
+		std::vector< SegmentEntry > stack;
 		std::vector< UserDefinedType > udts;
 		std::stack< Scope > scopes;
 
+		// Id to position in the segment; the first declaration wins in the data and text segments,
+		// the innermost (last) one on the stack
+		std::unordered_map< std::string, size_t > textIndex;
+		std::unordered_map< std::string, size_t > dataIndex;
+		std::unordered_map< std::string, std::vector< size_t > > stackIndex;
+		long textSize = 0;
+		long dataSize = 0;
+		long stackSize = 0;
+
+		void insertSegment( std::vector< SegmentEntry >& segment, std::unordered_map< std::string, size_t >& index, long& size, const MemoryElement& element );
+		void removeStackTop();
+
+		const UserDefinedType* getUdt( const std::string& id, bool currentScope ) const;
+		UserDefinedType* getUdt( const std::string& id, bool currentScope );
+
 	public:
 		void insert( MemoryElement element, bool constant = false );
 
@@ -82,6 +108,7 @@ namespace GoldScorpion {
 		std::vector< StackMemoryElement > closeScope();
 
 		std::optional< MemoryQuery > find( const std::string& id, bool currentScope = false ) const;
+		long getFrameSize() const;
 
 		void addUdt( const UserDefinedType& udt );
 		std::optional< UserDefinedType > findUdt( const std::string& id, bool currentScope = false ) const;
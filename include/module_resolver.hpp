@@ -0,0 +1,44 @@
+#pragma once
+#include "source_provider.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace GoldScorpion {
+
+	using ModuleId = uint32_t;
+
+	/**
+	 * Turns import paths into module identities. A path is looked for as written and then under each search root;
+	 * the first source found is identified by its SourceProvider key (for files on disk, the canonical path), so
+	 * every spelling of one file is the same module.
+	 * Each module is known by the first spelling seen for it, and each spelling is only resolved once. Not
+	 * thread-safe.
+	 */
+	class ModuleResolver {
+		const SourceProvider& sources;
+		std::vector< std::string > searchPaths;
+		std::vector< std::string > names;
+		std::unordered_map< std::string, ModuleId > byCanonicalPath;
+		std::unordered_map< std::string, ModuleId > byImportPath;
+
+	public:
+		explicit ModuleResolver( const SourceProvider& sources, std::vector< std::string > searchPaths = {} );
+
+		ModuleId resolve( const std::string& importPath );
+		const std::string& getName( ModuleId id ) const;
+
+		/**
+		 * The name a module is known by, which is the path to read it from
+		 */
+		std::string resolveName( const std::string& importPath );
+
+		/**
+		 * Look every spelling up again on its next use, for when files may have come or gone. Modules already
+		 * known keep their ids and names.
+		 */
+		void forgetImportPaths();
+	};
+
+}
\ No newline at end of file
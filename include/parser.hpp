@@ -1,11 +1,15 @@
 #pragma once
 #include "ast.hpp"
 #include "token.hpp"
-#include "result_type.hpp"
+#include "error.hpp"
 #include <vector>
+#include <optional>
 
 namespace GoldScorpion {
 
-	VariantResult< Program > getProgram( std::vector< Token > tokens );
+	/**
+	 * Parse a token stream into a Program, reporting any errors into diagnostics
+	 */
+	std::optional< Program > getProgram( std::vector< Token > tokens, Diagnostics& diagnostics );
 
 }
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include "time_report.hpp"
+
+namespace GoldScorpion {
+
+	/**
+	 * Measures one phase of work on one module for as long as it is in scope, for the time report and the trace.
+	 * When neither is switched on this is two flag checks and nothing else. The detail, such as a function name,
+	 * only appears in the trace.
+	 */
+	class Phase {
+		bool timing;
+		bool tracing;
+		std::string module;
+		const char* name;
+		std::string detail;
+		TimeReport::Sample start;
+		double traceStart;
+
+	public:
+		Phase( const std::string& module, const char* name, const std::string& detail = "" );
+		~Phase();
+
+		Phase( const Phase& ) = delete;
+		Phase& operator=( const Phase& ) = delete;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <tuple>
+#include <cstdint>
+
+namespace GoldScorpion {
+
+	// Bumped each time an input changes; query results remember the revisions they were computed and checked at
+	using Revision = uint64_t;
+
+	enum class QueryKind {
+		// The text of a module, as read from the SourceProvider. The only input; everything else is derived
+		SOURCE,
+		// The tokens and tree of a module
+		PARSE,
+		// The modules a module imports, by name
+		IMPORTS,
+		// Whether a module and everything it imports verified
+		CHECK,
+		// The tree of a verified module with its constants folded, and the stack frames laid out from it
+		FOLD
+	};
+
+	struct QueryKey {
+		QueryKind kind;
+		std::string module;
+
+		bool operator<( const QueryKey& rhs ) const { return std::tie( kind, module ) < std::tie( rhs.kind, rhs.module ); }
+		bool operator==( const QueryKey& rhs ) const { return kind == rhs.kind && module == rhs.module; }
+	};
+
+	/**
+	 * What is known about one memoized query: when its value last changed, when it was last confirmed to be
+	 * current, and which queries it read to produce it
+	 */
+	struct QueryState {
+		Revision changedAt = 0;
+		Revision verifiedAt = 0;
+		std::vector< QueryKey > dependencies;
+		// Set while the query is computed or verified, so a query that reaches itself can tell
+		bool active = false;
+		// Set on an input the host says may have changed, so that it is read again
+		bool invalidated = false;
+	};
+
+	template< typename Value >
+	struct Memo {
+		std::optional< Value > value;
+		QueryState state;
+	};
+
+}
+
+namespace GoldScorpion::Query {
+
+	/**
+	 * Note that the query running on this thread read key. Does nothing outside a query.
+	 */
+	void record( const QueryKey& key );
+
+	/**
+	 * Run body as a query and return every key it read. Queries nest; each level collects only its own reads.
+	 */
+	std::vector< QueryKey > collect( const std::function< void() >& body );
+
+}
\ No newline at end of file
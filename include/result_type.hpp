@@ -1,68 +1,49 @@
 #pragma once
 #include <variant>
 #include <string>
-#include <optional>
-#include <exception>
+#include <utility>
 
 namespace GoldScorpion {
 
 	template< typename T >
 	using VariantResult = std::variant< T, std::string >;
 
+	/**
+	 * Holds either a value or an error, never both. Accessing the side that isn't held is a programming error.
+	 */
 	template< typename Object, typename Error >
 	class Result {
-		std::optional< Object > result;
-		std::optional< Error > error;
+		std::variant< Object, Error > value;
 
-	public:
-		Result() {}
+		explicit Result( std::variant< Object, Error > value ) : value( std::move( value ) ) {}
 
+	public:
 		static Result good( Object object ) {
-			Result enhancedResult;
-			enhancedResult.result = std::move( object );
-			return enhancedResult;
+			return Result( std::variant< Object, Error >( std::in_place_index< 0 >, std::move( object ) ) );
 		};
 
 		static Result err( Error error ) {
-			Result enhancedResult;
-			enhancedResult.error = error;
-			return enhancedResult;
+			return Result( std::variant< Object, Error >( std::in_place_index< 1 >, std::move( error ) ) );
 		};
 
 		explicit operator bool() const {
-			return result.operator bool();
+			return value.index() == 0;
 		}
 
 		Object claim() {
-			if( !result ) {
-				throw std::runtime_error( "Attempted to dereference Result with error inside" );
-			}
-
-			return std::move( *result );
+			return std::move( std::get< 0 >( value ) );
 		}
 
 		Object& operator*() {
-			if( !result ) {
-				throw std::runtime_error( "Attempted to dereference Result with error inside" );
-			}
-
-			return *result;
+			return std::get< 0 >( value );
 		}
 
-		Object& operator->() {
-			if( !result ) {
-				throw std::runtime_error( "Attempted to dereference Result with error inside" );
-			}
-
-			return *result;
+		Object* operator->() {
+			return &std::get< 0 >( value );
 		}
 
 		Error& getError() {
-			if( !error ) {
-				throw std::runtime_error( "Attempted to get error from Result containing no error" );
-			}
-
-			return *error;
+			return std::get< 1 >( value );
 		}
 	};
 
@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <optional>
+#include <cstdint>
+
+namespace GoldScorpion {
+
+	/**
+	 * A position in source, packed into 32 bits. Every file registered with the SourceMap is handed its own range of
+	 * ids, so the id alone identifies both the file and the offset within it. Zero means "no position".
+	 */
+	struct SourceSpan {
+		uint32_t id = 0;
+
+		explicit operator bool() const { return id != 0; }
+		bool operator<( const SourceSpan& rhs ) const { return id < rhs.id; }
+	};
+
+	struct SourceLocation {
+		std::string file;
+		unsigned int line;
+		unsigned int column;
+	};
+
+}
+
+namespace GoldScorpion::SourceMap {
+
+	/**
+	 * Register a file's contents and return the span of its first character. The span of the character at
+	 * offset n is that id plus n. Returns nothing once the ids of every file still registered leave no room for
+	 * this one. Safe to call from any thread.
+	 */
+	std::optional< SourceSpan > addFile( const std::string& name, const std::string& contents );
+
+	/**
+	 * Forget a file once nothing holds spans into it, given the span addFile returned for it. Its ids are handed
+	 * out again to files added later, so a span left over from it may resolve into one of those.
+	 */
+	void removeFile( SourceSpan base );
+
+	/**
+	 * Turn a span back into a file, line and column. Lines are only worked out here, when a position is
+	 * actually needed for a message.
+	 */
+	std::optional< SourceLocation > resolve( SourceSpan span );
+
+	/**
+	 * Owns a file added to the SourceMap, and removes it when destroyed, so that the file lives exactly as long
+	 * as whatever holds spans into it
+	 */
+	class RegisteredFile {
+		SourceSpan base;
+
+	public:
+		RegisteredFile() = default;
+		explicit RegisteredFile( SourceSpan base ) : base( base ) {}
+		~RegisteredFile();
+
+		RegisteredFile( RegisteredFile&& other ) noexcept;
+		RegisteredFile& operator=( RegisteredFile&& other ) noexcept;
+		RegisteredFile( const RegisteredFile& ) = delete;
+		RegisteredFile& operator=( const RegisteredFile& ) = delete;
+	};
+
+}
\ No newline at end of file
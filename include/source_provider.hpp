@@ -0,0 +1,49 @@
+#pragma once
+#include "result_type.hpp"
+#include "utility.hpp"
+#include <string>
+#include <optional>
+#include <unordered_map>
+
+namespace GoldScorpion {
+
+	/**
+	 * Where the compiler gets module source from. Implementations must be safe to read from several threads at
+	 * once, as modules are parsed in parallel.
+	 */
+	class SourceProvider {
+	public:
+		virtual ~SourceProvider() = default;
+
+		/**
+		 * A key that is the same for every path naming the same source, or nothing if there is no source at path
+		 */
+		virtual std::optional< std::string > identify( const std::string& path ) const = 0;
+
+		virtual VariantResult< Utility::File > read( const std::string& path ) const = 0;
+	};
+
+	/**
+	 * Reads modules from disk, identifying them by their canonical path
+	 */
+	class DiskSourceProvider : public SourceProvider {
+	public:
+		std::optional< std::string > identify( const std::string& path ) const override;
+		VariantResult< Utility::File > read( const std::string& path ) const override;
+	};
+
+	/**
+	 * Serves modules from buffers held in memory, for compiling without touching the disk. Paths are compared after
+	 * lexical normalisation, so "a/../b.gs" finds "b.gs". Buffers must all be added before compiling.
+	 */
+	class MemorySourceProvider : public SourceProvider {
+		std::unordered_map< std::string, std::string > files;
+
+	public:
+		void add( const std::string& path, std::string contents );
+
+		std::optional< std::string > identify( const std::string& path ) const override;
+		VariantResult< Utility::File > read( const std::string& path ) const override;
+	};
+
+}
\ No newline at end of file
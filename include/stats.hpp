@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// Counters on the compiler's hot paths, printed by --stats. Build with DFLAGS=-DGOLDSCORPION_NO_STATS to compile
+// every GS_COUNT out of the binary.
+#ifdef GOLDSCORPION_NO_STATS
+#define GS_COUNT( counter ) ( ( void ) 0 )
+#define GS_COUNT_BY( counter, amount ) ( ( void ) sizeof( amount ) )
+#else
+#define GS_COUNT( counter ) GoldScorpion::Stats::add( GoldScorpion::Stats::Counter::counter, 1 )
+#define GS_COUNT_BY( counter, amount ) GoldScorpion::Stats::add( GoldScorpion::Stats::Counter::counter, amount )
+#endif
+
+namespace GoldScorpion::Stats {
+
+	enum class Counter : size_t {
+		TOKENS,
+		AST_PRIMARY,
+		AST_CALL_EXPRESSION,
+		AST_ARRAY_EXPRESSION,
+		AST_UNARY_EXPRESSION,
+		AST_BINARY_EXPRESSION,
+		AST_ASSIGNMENT_EXPRESSION,
+		AST_EXPRESSION,
+		AST_EXPRESSION_STATEMENT,
+		AST_FOR_STATEMENT,
+		AST_IF_STATEMENT,
+		AST_RETURN_STATEMENT,
+		AST_ASM_STATEMENT,
+		AST_WHILE_STATEMENT,
+		AST_STATEMENT,
+		AST_VAR_DECLARATION,
+		AST_CONST_DECLARATION,
+		AST_FUNCTION_DECLARATION,
+		AST_TYPE_DECLARATION,
+		AST_IMPORT_DECLARATION,
+		AST_ANNOTATION,
+		AST_DECLARATION,
+		GET_SYMBOL_CALLS,
+		GET_SYMBOL_SCANNED,
+		GET_TYPE_CALLS,
+		ADD_SYMBOL_TYPE_CALLS,
+		ADD_SYMBOL_TYPE_SCANNED,
+		EVALUATE_CONST_CALLS,
+		FOLDED_EXPRESSIONS,
+		FRAME_BYTES,
+		FRAME_BYTES_SHARED,
+		STRING_LITERAL_BYTES,
+		STRING_POOL_BYTES,
+		COUNT
+	};
+
+	/**
+	 * Each thread counts into its own block, so counting is a plain add with no contention between verifier
+	 * workers. Blocks are folded into the totals when their thread exits.
+	 */
+	struct Block {
+		uint64_t values[ ( size_t ) Counter::COUNT ] = {};
+
+		Block();
+		~Block();
+	};
+
+	inline Block& local() {
+		thread_local Block block;
+		return block;
+	}
+
+	inline void add( Counter counter, uint64_t amount ) {
+		local().values[ ( size_t ) counter ] += amount;
+	}
+
+	/**
+	 * Print every counter. Call once the worker threads have finished.
+	 */
+	void print();
+
+}
\ No newline at end of file
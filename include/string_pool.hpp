@@ -0,0 +1,22 @@
+#pragma once
+#include "ast.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace GoldScorpion {
+
+	/**
+	 * The string literals of a target, each stored once and NUL-terminated. A literal that ends another
+	 * takes no bytes of its own, and points into the tail of the longer one.
+	 */
+	struct StringPool {
+		std::string data;
+		std::map< std::string, long > offsets;
+		// What the literals would take stored once for every time they appear
+		long unpooledSize;
+	};
+
+	StringPool buildStringPool( const std::vector< const Program* >& programs );
+
+}
\ No newline at end of file
@@ -5,22 +5,59 @@
 #include "result_type.hpp"
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <variant>
 #include <optional>
 #include <memory>
 #include <stack>
 #include <cstddef>
+#include <cstdint>
 
 namespace GoldScorpion {
 
-    using ConstantExpressionValue = std::variant< long, std::string, std::vector< long >, std::vector< std::string > >;
+    /**
+     * The elements of a constant integer array, packed at the width of the array's element type. The buffer is
+     * immutable and shared, so copying the value, as the constant evaluator does with everything it touches, only
+     * copies a pointer.
+     */
+    class ConstantIntegerArray {
+        std::variant<
+            std::shared_ptr< const std::vector< uint8_t > >,
+            std::shared_ptr< const std::vector< uint16_t > >,
+            std::shared_ptr< const std::vector< uint32_t > >
+        > elements;
+        bool isSigned = false;
+
+    public:
+        /**
+         * Pack values into the width of elementType, which must be a native integer type
+         */
+        static ConstantIntegerArray pack( const std::vector< long >& values, TokenType elementType );
+
+        size_t size() const;
+        long at( size_t index ) const;
+    };
+
+    class ConstantStringArray {
+        std::shared_ptr< const std::vector< std::string > > elements;
+
+    public:
+        explicit ConstantStringArray( std::vector< std::string > values );
+
+        size_t size() const;
+        const std::string& at( size_t index ) const;
+    };
+
+    using ConstantExpressionValue = std::variant< long, std::string, ConstantIntegerArray, ConstantStringArray >;
     using SymbolTypeHandle = size_t;
 
     struct SymbolNativeType { TokenType type; };
     struct SymbolUdtType { std::string id; };
     struct SymbolFunctionType { std::string id; std::optional< std::string > associatedTypeId; };
     using ArrayIntermediateType = std::variant< SymbolNativeType, SymbolUdtType, SymbolFunctionType >;
-    struct SymbolArrayType { std::vector< long > dimensions; ArrayIntermediateType base; };
+    // strides[ i ] is the number of elements between consecutive values of index i; the first index varies fastest.
+    // A padded array lays out every dimension but the last as if it were rounded up to a power of two.
+    struct SymbolArrayType { std::vector< long > dimensions; ArrayIntermediateType base; std::vector< long > strides; bool padded = false; };
     using SymbolType = std::variant< SymbolNativeType, SymbolFunctionType, SymbolUdtType, SymbolArrayType >;
 
     using SymbolTypeResult = Result< SymbolType, std::string >;
@@ -34,7 +71,16 @@ namespace GoldScorpion {
         std::string id;
         std::variant< VariableSymbol, FunctionSymbol > value;
     };
-    struct UdtSymbol { std::string id; std::vector< SymbolField > fields; };
+    // Where a field sits in UdtSymbol::fields and, for variable fields, where it sits in an instance
+    // Function fields occupy no storage and have a size of zero
+    struct SymbolFieldSlot { size_t field; long offset; long size; long alignment; };
+    struct SymbolTypeLayout { long size; long alignment; };
+    struct UdtSymbol {
+        std::string id;
+        std::vector< SymbolField > fields;
+        std::unordered_map< std::string, SymbolFieldSlot > slots;
+        SymbolTypeLayout layout = { 0, 1 };
+    };
     struct Symbol {
         std::variant< VariableSymbol, ConstantSymbol, FunctionSymbol, UdtSymbol > symbol;
         bool external = false;
@@ -49,16 +95,28 @@ namespace GoldScorpion {
 
     class SymbolResolver {
         std::vector< SymbolTable > symbolTables;
+        const SymbolResolver* parent = nullptr;
         static std::vector< SymbolType > handles;
 
         SymbolTable* getByFileId( const std::string& id );
+        const SymbolTable* getByFileId( const std::string& id ) const;
+        const Symbol* findInTable( const SymbolTable& symbolTable, const std::string& symbolId ) const;
         Symbol* getSymbol( const std::string& fileId, const std::string& symbolId );
+        const Symbol* getSymbol( const std::string& fileId, const std::string& symbolId ) const;
 
     public:
+        /**
+         * Create a resolver with its own scope stack that falls back to this resolver for everything else.
+         * This resolver must outlive the fork and must not be modified while the fork is in use.
+         */
+        SymbolResolver fork() const;
+
         void addFile( const std::string& id );
         void addOuterScope( const std::string& id, const std::string& outerScopeId );
 
         std::optional< Symbol > findSymbol( const std::string& fileId, const std::string& symbolId );
+        const UdtSymbol* findUdt( const std::string& fileId, const std::string& udtId ) const;
+        const ConstantSymbol* findConstant( const std::string& fileId, const std::string& constantId ) const;
         void addSymbol( const std::string& fileId, Symbol symbol );
         void addFieldToSymbol( const std::string& fileId, const std::string& symbolId, SymbolField field );
 
@@ -72,6 +130,10 @@ namespace GoldScorpion {
     std::string getSymbolId( const Symbol& symbol );
     std::string getSymbolTypeId( const SymbolType& symbolType );
     bool fieldPresent( const std::string& fieldId, const UdtSymbol& symbol );
+    const SymbolField* findField( const std::string& fieldId, const UdtSymbol& symbol );
+    std::optional< SymbolFieldSlot > findFieldSlot( const std::string& fieldId, const UdtSymbol& symbol );
+    void addUdtField( UdtSymbol& symbol, SymbolField field, std::optional< SymbolTypeLayout > layout = {} );
     SymbolType toSymbolType( const ArrayIntermediateType& type );
-    ArrayIntermediateType toArrayIntermediateType( const SymbolType& type );
+    std::optional< ArrayIntermediateType > toArrayIntermediateType( const SymbolType& type );
+    SymbolArrayType makeArrayType( std::vector< long > dimensions, ArrayIntermediateType base, bool padded = false );
 }
\ No newline at end of file
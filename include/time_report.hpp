@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+namespace GoldScorpion::TimeReport {
+
+	enum class Format { TABLE, JSON };
+
+	/**
+	 * Process-wide counters at one instant. The cost of a phase is the difference between the samples taken on
+	 * either side of it, so CPU time and allocations include any worker threads the phase started.
+	 */
+	struct Sample {
+		double wallMs;
+		double cpuMs;
+		uint64_t allocations;
+		long peakRssKb;
+	};
+
+	void enable();
+	bool enabled();
+
+	/**
+	 * Allocations are only counted in a program that calls this from its own operator new, as the command line
+	 * front end does. The library leaves the global allocator alone for anyone else who links it.
+	 */
+	void countAllocation();
+
+	Sample sample();
+
+	/**
+	 * Add the work done between two samples to the totals for a phase of a module. Safe to call from any thread.
+	 */
+	void record( const std::string& module, const std::string& phase, const Sample& start, const Sample& end );
+
+	/**
+	 * Print each module's phases, most expensive first, followed by every phase summed across modules. Phases can
+	 * nest (const-eval runs inside check), so the lines are not meant to add up.
+	 */
+	void print( Format format );
+
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include "source_map.hpp"
 #include <optional>
 #include <variant>
 #include <string>
@@ -76,8 +77,7 @@ namespace GoldScorpion {
 	struct Token {
 		TokenType type;
 		std::optional< std::variant< long, std::string > > value;
-		unsigned int line;
-		unsigned int column;
+		SourceSpan span;
 
 		std::string toString() const;
 	};
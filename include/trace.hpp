@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+
+namespace GoldScorpion::Trace {
+
+	void enable();
+	bool enabled();
+
+	/**
+	 * Microseconds since tracing was enabled
+	 */
+	double now();
+
+	/**
+	 * Add a complete span to the track of the calling thread. Safe to call from any thread.
+	 */
+	void record( const std::string& name, const std::string& module, const std::string& detail, double startUs, double endUs );
+
+	/**
+	 * Write every recorded span to a file in Chrome trace-event format, loadable in chrome://tracing or Perfetto.
+	 * Returns false if the file could not be written.
+	 */
+	bool write( const std::string& path );
+
+}
\ No newline at end of file
@@ -2,25 +2,62 @@
 #include "ast.hpp"
 #include "token.hpp"
 #include "symbol.hpp"
+#include "type_tools.hpp"
+#include "error.hpp"
+#include "result_type.hpp"
 #include <optional>
+#include <functional>
 #include <string>
+#include <map>
 #include <vector>
 #include <stack>
 #include <variant>
 
 namespace GoldScorpion {
 
+	// Top-level functions by name, for constant expressions that call them
+	struct FunctionTable {
+		std::map< std::string, const FunctionDeclaration* > declarations;
+		// Checks a body before it is first interpreted, since only a verified body can be
+		std::function< bool( const FunctionDeclaration& ) > verify;
+	};
+
+	struct ConstantLocal {
+		ConstantExpressionValue value;
+		// The element type, for an array
+		TokenType type;
+		// An array keeps its elements unpacked while the function writes them, and is packed when read whole
+		std::optional< SymbolArrayType > arrayType;
+		std::vector< ConstantExpressionValue > elements;
+	};
+
+	struct ConstCallState {
+		long stepsLeft;
+		size_t depth;
+	};
+
 	struct ConstEvaluationSettings {
 		std::string fileId;
 		std::stack< ConstantExpressionValue >& stack;
 		SymbolResolver& symbols;
-		std::optional< Token > nearestToken;
+		SourceSpan nearestSpan;
+		// Calls are interpreted at compile time only when the functions they may reach are given
+		const FunctionTable* functions = nullptr;
+		// Arguments and locals of the call being interpreted
+		std::map< std::string, ConstantLocal >* locals = nullptr;
+		ConstCallState* calls = nullptr;
 	};
 
-	long flattenArrayIndex( const std::vector< long >& dimensions, const std::vector< long >& indices );
+	long flattenArrayIndex( const SymbolArrayType& type, const std::vector< long >& indices );
+
+	// Byte offset of an element from constant indices, so constant indexing needs no arithmetic at runtime
+	std::optional< long > getElementOffset( const SymbolArrayType& type, const std::vector< long >& indices, SymbolTypeSettings settings );
 
 	bool constantIsArray( const ConstantExpressionValue& value );
 
+	// Integers are evaluated in a long and narrowed to their type as they are stored, as they would be on the target
+	ConstantExpressionValue narrowToType( ConstantExpressionValue value, TokenType type );
+
 	std::optional< std::string > getIdentifierName( const Expression& node );
 
 	std::optional< std::string > getIdentifierName( const Token& token );
@@ -33,5 +70,10 @@ namespace GoldScorpion {
 
 	bool containsReturn( const FunctionDeclaration& node );
 
-	ConstantExpressionValue evaluateConst( const Expression& node, ConstEvaluationSettings settings );
+	Result< ConstantExpressionValue, Error > evaluateConst( const Expression& node, ConstEvaluationSettings settings );
+
+	void foldConstants( const std::string& fileId, Program& program, const SymbolResolver& symbols );
+
+	// Deep copy of a tree, so a pass that rewrites it can leave the original as it was
+	Program copyProgram( const Program& program );
 }
\ No newline at end of file
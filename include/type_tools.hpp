@@ -44,10 +44,14 @@ namespace GoldScorpion {
 
     SymbolNativeType promotePrimitiveTypes( const SymbolNativeType& lhs, const SymbolNativeType& rhs );
 
+    // Storage size and alignment of a type on the target, if it can be stored at all
+    std::optional< SymbolTypeLayout > getTypeLayout( const SymbolType& type, SymbolTypeSettings settings );
+
     // New symbol type stuff that will replace the type stuff immediately above
     SymbolTypeResult getType( const Primary& node, SymbolTypeSettings settings );
     SymbolTypeResult getType( const CallExpression& node, SymbolTypeSettings settings );
     SymbolTypeResult getType( const BinaryExpression& node, SymbolTypeSettings settings );
+    SymbolTypeResult getType( const ArrayExpression& node, SymbolTypeSettings settings );
     SymbolTypeResult getType( const AssignmentExpression& node, SymbolTypeSettings settings );
     SymbolTypeResult getType( const Expression& node, SymbolTypeSettings settings );
 
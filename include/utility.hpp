@@ -2,6 +2,8 @@
 #include "result_type.hpp"
 #include <vector>
 #include <string>
+#include <functional>
+#include <cstddef>
 
 namespace GoldScorpion::Utility {
 
@@ -27,4 +29,15 @@ namespace GoldScorpion::Utility {
 
 	std::string longToHex( long value );
 
+	/**
+	 * Escape text for use inside a JSON string literal
+	 */
+	std::string jsonEscape( const std::string& text );
+
+	/**
+	 * Run job( 0 ) through job( count - 1 ) across the hardware threads, returning when all have completed.
+	 * Jobs are handed out in index order but may finish in any order.
+	 */
+	void parallelFor( size_t count, const std::function< void( size_t ) >& job );
+
 }
\ No newline at end of file
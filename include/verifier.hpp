@@ -4,9 +4,25 @@
 #include "ast.hpp"
 #include "error.hpp"
 #include <optional>
+#include <functional>
+#include <map>
 
 namespace GoldScorpion {
 
-    std::optional< std::string > check( const std::string& fileId, const Program& program, SymbolResolver& symbols );
+    bool check( const std::string& fileId, const Program& program, SymbolResolver& symbols, Diagnostics& diagnostics );
+
+    /**
+     * Check a file, but verify only the function bodies that bodyFilter accepts. Diagnostics from the bodies that
+     * are verified go to bodyDiagnostics under their declaration rather than to diagnostics, so a caller checking
+     * again after an edit can keep what it already knows about the bodies the edit could not have affected.
+     */
+    bool check(
+        const std::string& fileId,
+        const Program& program,
+        SymbolResolver& symbols,
+        Diagnostics& diagnostics,
+        const std::function< bool( const FunctionDeclaration& ) >& bodyFilter,
+        std::map< const FunctionDeclaration*, Diagnostics >& bodyDiagnostics
+    );
 
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+#include "ast.hpp"
+
+namespace GoldScorpion {
+
+	/**
+	 * Print how much memory a tree holds: count and bytes per node kind, bytes in token strings and source spans,
+	 * and the deepest expression nesting
+	 */
+	void printAstMemory( const Program& program );
+
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "arch/m68k/addressing.hpp"
+#include <algorithm>
+
+namespace GoldScorpion::m68k {
+
+	static std::optional< int > getShift( long stride ) {
+		if( stride <= 0 || ( stride & ( stride - 1 ) ) ) {
+			return {};
+		}
+
+		int shift = 0;
+		while( stride >>= 1 ) {
+			shift++;
+		}
+
+		return shift;
+	}
+
+	std::optional< std::vector< Instruction > > scaleIndex( OperandType index, long stride ) {
+		std::vector< Instruction > result;
+
+		if( auto shift = getShift( stride ) ) {
+			// An immediate shift count can be 1 to 8
+			for( int remaining = *shift; remaining > 0; remaining -= 8 ) {
+				result.push_back( Instruction{
+					Operator::SHIFT_LEFT,
+					OperatorSize::LONG,
+					Operand{ 0, OperandType::IMMEDIATE, 0, std::min( remaining, 8 ) },
+					Operand{ 0, index, 0, 0 },
+					{}
+				} );
+			}
+
+			return result;
+		}
+
+		if( stride <= 0 || stride > 0xFFFF ) {
+			return {};
+		}
+
+		result.push_back( Instruction{
+			Operator::MULTIPLY_UNSIGNED,
+			OperatorSize::WORD,
+			Operand{ 0, OperandType::IMMEDIATE, 0, stride },
+			Operand{ 0, index, 0, 0 },
+			{}
+		} );
+
+		return result;
+	}
+
+	bool isShortAddress( long address ) {
+		long bus = address & 0xFFFFFF;
+		return bus < 0x8000 || bus >= 0xFF8000;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "arch/m68k/directive.hpp"
+#include <vector>
+
+namespace GoldScorpion::m68k {
+
+	// Keeps lines short enough for assemblers with a line length limit
+	static const size_t MAX_LINE_BYTES = 64;
+
+	// Some assemblers treat a backslash in a string as an escape, so it goes out as a number like a quote does
+	static bool isQuotable( unsigned char byte ) {
+		return byte >= 0x20 && byte < 0x7F && byte != '"' && byte != '\\';
+	}
+
+	std::string toByteDirectives( const std::string& label, const std::string& bytes ) {
+		std::string result = label + ":\n";
+		std::vector< std::string > items;
+		size_t lineBytes = 0;
+
+		auto flush = [ & ]() {
+			if( items.empty() ) {
+				return;
+			}
+
+			result += "\tdc.b ";
+			for( size_t i = 0; i != items.size(); i++ ) {
+				result += ( i ? "," : "" ) + items[ i ];
+			}
+			result += "\n";
+			items.clear();
+			lineBytes = 0;
+		};
+
+		for( size_t i = 0; i != bytes.size(); i++ ) {
+			unsigned char byte = bytes[ i ];
+			if( isQuotable( byte ) ) {
+				if( items.empty() || items.back().back() != '"' ) {
+					items.push_back( "\"\"" );
+				}
+				items.back().insert( items.back().size() - 1, 1, ( char ) byte );
+			} else {
+				items.push_back( std::to_string( byte ) );
+			}
+
+			lineBytes++;
+			if( byte == 0 || lineBytes == MAX_LINE_BYTES ) {
+				flush();
+			}
+		}
+		flush();
+
+		return result;
+	}
+
+}
\ No newline at end of file
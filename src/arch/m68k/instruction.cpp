@@ -115,6 +115,9 @@ namespace GoldScorpion::m68k {
 			case Operator::NOT:
 				instruction = "not." + operatorSizeToDirective( size );
 				break;
+			case Operator::SHIFT_LEFT:
+				instruction = "lsl." + operatorSizeToDirective( size );
+				break;
 		}
 
 		instruction += "\t";
@@ -0,0 +1,287 @@
+#include "arch/m68k/md/ram_layout.hpp"
+#include "arch/m68k/addressing.hpp"
+#include "tree_tools.hpp"
+#include "type_tools.hpp"
+#include "variant_visitor.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <map>
+
+namespace GoldScorpion::m68k::md {
+
+	// A reference in a loop is worth this many outside it, up to three loops deep
+	static const long LOOP_WEIGHT = 8;
+	static const long MAX_REFERENCE_WEIGHT = LOOP_WEIGHT * LOOP_WEIGHT * LOOP_WEIGHT;
+
+	struct RamGlobal {
+		RamPlacement placement;
+		long alignment;
+	};
+
+	struct ReferenceSettings {
+		std::map< std::string, long >& references;
+		long weight;
+	};
+
+	static void countDeclarations( const std::vector< std::unique_ptr< Declaration > >& body, ReferenceSettings settings );
+
+	static ReferenceSettings enterLoop( ReferenceSettings settings ) {
+		settings.weight = std::min( settings.weight * LOOP_WEIGHT, MAX_REFERENCE_WEIGHT );
+		return settings;
+	}
+
+	// Locals cannot share a name with a global, so any name that is not a field is either a global or ignored
+	static void countExpression( const Expression& node, ReferenceSettings settings, bool field = false ) {
+		std::visit( overloaded {
+
+			[ &settings ]( const std::unique_ptr< AssignmentExpression >& expression ) {
+				countExpression( *expression->identifier, settings );
+				countExpression( *expression->expression, settings );
+			},
+			[ &settings, field ]( const std::unique_ptr< BinaryExpression >& expression ) {
+				auto op = std::get_if< Token >( &expression->op->value );
+				bool dot = op && op->type == TokenType::TOKEN_DOT;
+				countExpression( *expression->lhsValue, settings, dot && field );
+				countExpression( *expression->rhsValue, settings, dot );
+			},
+			[ &settings ]( const std::unique_ptr< UnaryExpression >& expression ) {
+				countExpression( *expression->value, settings );
+			},
+			[ &settings, field ]( const std::unique_ptr< CallExpression >& expression ) {
+				countExpression( *expression->identifier, settings, field );
+				for( const auto& argument : expression->arguments ) {
+					countExpression( *argument, settings );
+				}
+			},
+			[ &settings, field ]( const std::unique_ptr< ArrayExpression >& expression ) {
+				countExpression( *expression->identifier, settings, field );
+				for( const auto& index : expression->indices ) {
+					countExpression( *index, settings );
+				}
+			},
+			[ &settings, field ]( const std::unique_ptr< Primary >& primary ) {
+				if( auto subexpression = std::get_if< std::unique_ptr< Expression > >( &primary->value ) ) {
+					countExpression( **subexpression, settings, field );
+					return;
+				}
+
+				auto name = getIdentifierName( std::get< Token >( primary->value ) );
+				if( name && !field ) {
+					auto global = settings.references.find( *name );
+					if( global != settings.references.end() ) {
+						global->second += settings.weight;
+					}
+				}
+			}
+
+		}, node.value );
+	}
+
+	static void countStatement( const Statement& node, ReferenceSettings settings ) {
+		std::visit( overloaded {
+
+			[ &settings ]( const std::unique_ptr< ExpressionStatement >& statement ) { countExpression( *statement->value, settings ); },
+			[ &settings ]( const std::unique_ptr< ForStatement >& statement ) {
+				countExpression( *statement->from, settings );
+				countExpression( *statement->to, enterLoop( settings ) );
+				if( statement->every ) {
+					countExpression( **statement->every, enterLoop( settings ) );
+				}
+				countDeclarations( statement->body, enterLoop( settings ) );
+			},
+			[ &settings ]( const std::unique_ptr< IfStatement >& statement ) {
+				for( const auto& condition : statement->conditions ) {
+					countExpression( *condition, settings );
+				}
+				for( const auto& body : statement->bodies ) {
+					countDeclarations( body, settings );
+				}
+			},
+			[ &settings ]( const std::unique_ptr< ReturnStatement >& statement ) {
+				if( statement->expression ) {
+					countExpression( **statement->expression, settings );
+				}
+			},
+			[]( const std::unique_ptr< AsmStatement >& ) {},
+			[ &settings ]( const std::unique_ptr< WhileStatement >& statement ) {
+				countExpression( *statement->condition, enterLoop( settings ) );
+				countDeclarations( statement->body, enterLoop( settings ) );
+			}
+
+		}, node.value );
+	}
+
+	static void countDeclarations( const std::vector< std::unique_ptr< Declaration > >& body, ReferenceSettings settings ) {
+		for( const auto& declaration : body ) {
+			std::visit( overloaded {
+
+				[]( const std::unique_ptr< Annotation >& ) {},
+				[ &settings ]( const std::unique_ptr< VarDeclaration >& declaration ) {
+					if( declaration->value ) {
+						countExpression( **declaration->value, settings );
+					}
+				},
+				[]( const std::unique_ptr< ConstDeclaration >& ) {},
+				[ &settings ]( const std::unique_ptr< FunctionDeclaration >& declaration ) { countDeclarations( declaration->body, settings ); },
+				[ &settings ]( const std::unique_ptr< TypeDeclaration >& declaration ) {
+					for( const auto& function : declaration->functions ) {
+						countDeclarations( function->body, settings );
+					}
+				},
+				[]( const std::unique_ptr< ImportDeclaration >& ) {},
+				[ &settings ]( const std::unique_ptr< Statement >& statement ) { countStatement( *statement, settings ); }
+
+			}, declaration->value );
+		}
+	}
+
+	static long alignTo( long offset, long alignment ) {
+		return ( offset + alignment - 1 ) / alignment * alignment;
+	}
+
+	/**
+	 * Give each global in a region an address from start, widest alignment first. Returns the end of the region.
+	 */
+	static long placeRegion( std::vector< RamGlobal* >& region, long start, long& padding ) {
+		std::stable_sort( region.begin(), region.end(), []( const RamGlobal* lhs, const RamGlobal* rhs ) {
+			return lhs->alignment > rhs->alignment;
+		} );
+
+		long address = start;
+		for( RamGlobal* global : region ) {
+			long aligned = alignTo( address, global->alignment );
+			padding += aligned - address;
+			global->placement.address = aligned;
+			address = aligned + global->placement.size;
+		}
+
+		return address;
+	}
+
+	static long getRegionSize( std::vector< RamGlobal* > region ) {
+		long padding = 0;
+		return alignTo( placeRegion( region, 0, padding ), 2 );
+	}
+
+	Result< RamLayout, Error > layoutRam( const std::vector< RamModule >& modules, long staticFrameSize ) {
+		using LayoutResult = Result< RamLayout, Error >;
+
+		// Every local of a static frame is a candidate for abs.w, so the frames go first, ahead of any global
+		std::vector< RamGlobal > globals;
+		if( staticFrameSize ) {
+			globals.push_back( RamGlobal{ RamPlacement{ "", "(static frames)", "", 0, staticFrameSize, 0 }, 2 } );
+		}
+		for( const RamModule& module : modules ) {
+			SymbolResolver symbols = module.symbols->fork();
+			std::map< std::string, long > references;
+
+			size_t first = globals.size();
+			for( const auto& declaration : module.program->statements ) {
+				auto varDeclaration = std::get_if< std::unique_ptr< VarDeclaration > >( &declaration->value );
+				auto name = varDeclaration ? getIdentifierName( ( *varDeclaration )->variable.name ) : std::optional< std::string >{};
+				auto symbol = name ? symbols.findSymbol( module.module, *name ) : std::optional< Symbol >{};
+				auto variable = symbol ? std::get_if< VariableSymbol >( &symbol->symbol ) : nullptr;
+				if( !variable ) {
+					continue;
+				}
+
+				auto layout = getTypeLayout( variable->type, SymbolTypeSettings{ module.module, symbols } );
+				if( !layout ) {
+					return LayoutResult::err( Error{ "Internal compiler error (global " + *name + " in " + module.module + " has no known size)", {} } );
+				}
+
+				references[ *name ] = 0;
+				globals.push_back( RamGlobal{ RamPlacement{ module.module, *name, getSymbolTypeId( variable->type ), 0, layout->size, 0 }, layout->alignment } );
+			}
+
+			countDeclarations( module.program->statements, ReferenceSettings{ references, 1 } );
+			for( size_t i = first; i != globals.size(); i++ ) {
+				globals[ i ].placement.references = references[ globals[ i ].placement.id ];
+			}
+		}
+
+		// Every reference to a short address saves the same, so the window goes to the most references per byte
+		std::vector< RamGlobal* > candidates;
+		for( RamGlobal& global : globals ) {
+			candidates.push_back( &global );
+		}
+		std::stable_sort( candidates.begin(), candidates.end(), []( const RamGlobal* lhs, const RamGlobal* rhs ) {
+			return lhs->placement.references * rhs->placement.size > rhs->placement.references * lhs->placement.size;
+		} );
+
+		const long shortCapacity = RAM_END - RAM_SHORT_START;
+		std::vector< RamGlobal* > shortRegion;
+		std::vector< RamGlobal* > longRegion;
+		long shortSize = 0;
+		if( staticFrameSize ) {
+			candidates.erase( std::find( candidates.begin(), candidates.end(), &globals.front() ) );
+			( staticFrameSize <= shortCapacity ? shortRegion : longRegion ).push_back( &globals.front() );
+			shortSize = staticFrameSize <= shortCapacity ? staticFrameSize : 0;
+		}
+		for( RamGlobal* global : candidates ) {
+			long end = alignTo( shortSize, global->alignment ) + global->placement.size;
+			if( global->placement.references && end <= shortCapacity ) {
+				shortRegion.push_back( global );
+				shortSize = end;
+			} else {
+				longRegion.push_back( global );
+			}
+		}
+
+		// The rest sit just below the window, or from the start of RAM up to it when they are larger than the
+		// space below it, and the window starts wherever they end
+		long longSize = getRegionSize( longRegion );
+		long longStart = std::max( RAM_START, RAM_SHORT_START - longSize );
+		if( longStart + longSize + getRegionSize( shortRegion ) > RAM_END ) {
+			long total = 0;
+			for( const RamGlobal& global : globals ) {
+				total += global.placement.size;
+			}
+
+			return LayoutResult::err( Error{ "Globals need " + std::to_string( total ) + " bytes, which do not fit in the " + std::to_string( RAM_END - RAM_START ) + " bytes of work RAM", {} } );
+		}
+
+		// Declaration order is kept within an alignment class, so that the map reads in source order
+		auto byDeclaration = []( const RamGlobal* lhs, const RamGlobal* rhs ) { return lhs < rhs; };
+		std::sort( shortRegion.begin(), shortRegion.end(), byDeclaration );
+		std::sort( longRegion.begin(), longRegion.end(), byDeclaration );
+
+		RamLayout layout{ {}, 0, 0, 0, 0 };
+		long longEnd = placeRegion( longRegion, longStart, layout.padding );
+		// The window starts where the long region, rounded up to a word, ends, and the stack above it starts on a word
+		layout.padding += longStart + longSize - longEnd;
+		long end = placeRegion( shortRegion, longStart + longSize, layout.padding );
+		layout.padding += alignTo( end, 2 ) - end;
+		layout.stackSpace = RAM_END - alignTo( end, 2 );
+		if( staticFrameSize ) {
+			layout.staticFrames = globals.front().placement.address;
+		}
+
+		for( const RamGlobal& global : globals ) {
+			layout.placements.push_back( global.placement );
+			layout.size += global.placement.size;
+		}
+		std::sort( layout.placements.begin(), layout.placements.end(), []( const RamPlacement& lhs, const RamPlacement& rhs ) {
+			return lhs.address < rhs.address;
+		} );
+
+		return LayoutResult::good( std::move( layout ) );
+	}
+
+	void printRamLayout( const RamLayout& layout ) {
+		std::cout << "RAM map:" << std::endl;
+		for( const RamPlacement& placement : layout.placements ) {
+			std::cout << "  $" << std::uppercase << std::hex << placement.address << std::dec << std::nouppercase
+				<< std::right << std::setw( 8 ) << placement.size << "  "
+				<< ( isShortAddress( placement.address ) ? "abs.w" : "abs.l" ) << "  "
+				<< std::left << std::setw( 32 ) << ( placement.module.empty() ? placement.id : placement.module + ":" + placement.id ) << " "
+				<< std::setw( 16 ) << placement.typeId << " "
+				<< placement.references << " references" << std::endl;
+		}
+
+		std::cout << std::right << "Globals use " << layout.size << " bytes with " << layout.padding << " bytes of padding; "
+			<< layout.stackSpace << " bytes above them are left for the stack" << std::endl;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,388 @@
+#include "arch/m68k/md/static_frames.hpp"
+#include "arch/m68k/md/verifier_annotation.hpp"
+#include "tree_tools.hpp"
+#include "variant_visitor.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <tuple>
+
+namespace GoldScorpion::m68k::md {
+
+	struct CallNode {
+		const FunctionDeclaration* function;
+		StaticFrame frame;
+		std::vector< size_t > callees;
+		bool interrupt = false;
+		bool addressTaken = false;
+		bool method = false;
+		// Calls that cannot be resolved may reach any method, or anything whose address is taken
+		bool callsUnknown = false;
+	};
+
+	// Functions and methods of one module by name; imports expose nothing, so no call leaves its module
+	struct CallScope {
+		std::map< std::string, size_t > functions;
+		std::multimap< std::string, size_t > methods;
+	};
+
+	struct CallSettings {
+		std::vector< CallNode >& nodes;
+		const CallScope& scope;
+		size_t caller;
+	};
+
+	static void findCalls( const std::vector< std::unique_ptr< Declaration > >& body, CallSettings settings );
+
+	static void findCalls( const Expression& node, CallSettings settings, bool field = false ) {
+		std::visit( overloaded {
+
+			[ &settings ]( const std::unique_ptr< AssignmentExpression >& expression ) {
+				findCalls( *expression->identifier, settings );
+				findCalls( *expression->expression, settings );
+			},
+			[ &settings, field ]( const std::unique_ptr< BinaryExpression >& expression ) {
+				auto op = std::get_if< Token >( &expression->op->value );
+				bool dot = op && op->type == TokenType::TOKEN_DOT;
+				findCalls( *expression->lhsValue, settings, dot && field );
+				findCalls( *expression->rhsValue, settings, dot );
+			},
+			[ &settings ]( const std::unique_ptr< UnaryExpression >& expression ) {
+				findCalls( *expression->value, settings );
+			},
+			[ &settings, field ]( const std::unique_ptr< CallExpression >& expression ) {
+				for( const auto& argument : expression->arguments ) {
+					findCalls( *argument, settings );
+				}
+
+				// A method call parses as a call of object.method, so the name is on the right of the dot
+				const Expression* callee = expression->identifier.get();
+				bool method = field;
+				if( auto binary = std::get_if< std::unique_ptr< BinaryExpression > >( &callee->value ) ) {
+					auto op = std::get_if< Token >( &( *binary )->op->value );
+					if( op && op->type == TokenType::TOKEN_DOT ) {
+						findCalls( *( *binary )->lhsValue, settings, field );
+						callee = ( *binary )->rhsValue.get();
+						method = true;
+					}
+				}
+
+				auto name = getIdentifierName( *callee );
+				if( !name ) {
+					findCalls( *callee, settings, method );
+					settings.nodes[ settings.caller ].callsUnknown = true;
+					return;
+				}
+
+				std::vector< size_t >& callees = settings.nodes[ settings.caller ].callees;
+				if( method ) {
+					// The type of the object is not known here, so this could be any method of the name
+					auto methods = settings.scope.methods.equal_range( *name );
+					for( auto method = methods.first; method != methods.second; ++method ) {
+						callees.push_back( method->second );
+					}
+					return;
+				}
+
+				auto function = settings.scope.functions.find( *name );
+				if( function != settings.scope.functions.end() ) {
+					callees.push_back( function->second );
+				} else {
+					settings.nodes[ settings.caller ].callsUnknown = true;
+				}
+			},
+			[ &settings, field ]( const std::unique_ptr< ArrayExpression >& expression ) {
+				findCalls( *expression->identifier, settings, field );
+				for( const auto& index : expression->indices ) {
+					findCalls( *index, settings );
+				}
+			},
+			[ &settings, field ]( const std::unique_ptr< Primary >& primary ) {
+				if( auto subexpression = std::get_if< std::unique_ptr< Expression > >( &primary->value ) ) {
+					findCalls( **subexpression, settings, field );
+					return;
+				}
+
+				// A function named anywhere but in a call can be called through a pointer
+				auto name = getIdentifierName( std::get< Token >( primary->value ) );
+				auto function = name && !field ? settings.scope.functions.find( *name ) : settings.scope.functions.end();
+				if( function != settings.scope.functions.end() ) {
+					settings.nodes[ function->second ].addressTaken = true;
+				}
+			}
+
+		}, node.value );
+	}
+
+	static void findCalls( const Statement& node, CallSettings settings ) {
+		std::visit( overloaded {
+
+			[ &settings ]( const std::unique_ptr< ExpressionStatement >& statement ) { findCalls( *statement->value, settings ); },
+			[ &settings ]( const std::unique_ptr< ForStatement >& statement ) {
+				findCalls( *statement->from, settings );
+				findCalls( *statement->to, settings );
+				if( statement->every ) {
+					findCalls( **statement->every, settings );
+				}
+				findCalls( statement->body, settings );
+			},
+			[ &settings ]( const std::unique_ptr< IfStatement >& statement ) {
+				for( const auto& condition : statement->conditions ) {
+					findCalls( *condition, settings );
+				}
+				for( const auto& body : statement->bodies ) {
+					findCalls( body, settings );
+				}
+			},
+			[ &settings ]( const std::unique_ptr< ReturnStatement >& statement ) {
+				if( statement->expression ) {
+					findCalls( **statement->expression, settings );
+				}
+			},
+			// Inline assembly may jump anywhere
+			[ &settings ]( const std::unique_ptr< AsmStatement >& ) { settings.nodes[ settings.caller ].callsUnknown = true; },
+			[ &settings ]( const std::unique_ptr< WhileStatement >& statement ) {
+				findCalls( *statement->condition, settings );
+				findCalls( statement->body, settings );
+			}
+
+		}, node.value );
+	}
+
+	static void findCalls( const std::vector< std::unique_ptr< Declaration > >& body, CallSettings settings ) {
+		for( const auto& declaration : body ) {
+			if( auto varDeclaration = std::get_if< std::unique_ptr< VarDeclaration > >( &declaration->value ) ) {
+				if( ( *varDeclaration )->value ) {
+					findCalls( **( *varDeclaration )->value, settings );
+				}
+			} else if( auto statement = std::get_if< std::unique_ptr< Statement > >( &declaration->value ) ) {
+				findCalls( **statement, settings );
+			}
+		}
+	}
+
+	static bool isInterrupt( const Annotation& annotation, SymbolResolver& symbols ) {
+		auto packages = getAnnotationPackageList( annotation, AnnotationSettings{ symbols, {} } );
+		if( !packages ) {
+			return false;
+		}
+
+		return std::any_of( packages->begin(), packages->end(), []( const AnnotationPackage& package ) {
+			return package.id == "interrupt";
+		} );
+	}
+
+	static void addNode( std::vector< CallNode >& nodes, const StaticFrameModule& module, const FunctionDeclaration& function, const std::string& id ) {
+		auto frame = module.frames->find( &function );
+		CallNode node{ &function, StaticFrame{ module.module, id, {}, 0, "" }, {} };
+		if( frame == module.frames->end() ) {
+			node.frame.reason = "frame size unknown";
+		} else {
+			node.frame.size = frame->second.size;
+		}
+
+		nodes.push_back( std::move( node ) );
+	}
+
+	/**
+	 * Strongly connected components, each listed after every component it calls into
+	 */
+	static std::vector< std::vector< size_t > > getComponents( const std::vector< CallNode >& nodes ) {
+		std::vector< std::vector< size_t > > components;
+		std::vector< long > index( nodes.size(), -1 );
+		std::vector< long > lowLink( nodes.size(), 0 );
+		std::vector< bool > onStack( nodes.size(), false );
+		std::vector< size_t > stack;
+		long next = 0;
+
+		std::function< void( size_t ) > visit = [ & ]( size_t node ) {
+			index[ node ] = lowLink[ node ] = next++;
+			stack.push_back( node );
+			onStack[ node ] = true;
+
+			for( size_t callee : nodes[ node ].callees ) {
+				if( index[ callee ] == -1 ) {
+					visit( callee );
+					lowLink[ node ] = std::min( lowLink[ node ], lowLink[ callee ] );
+				} else if( onStack[ callee ] ) {
+					lowLink[ node ] = std::min( lowLink[ node ], index[ callee ] );
+				}
+			}
+
+			if( lowLink[ node ] == index[ node ] ) {
+				std::vector< size_t > component;
+				size_t member;
+				do {
+					member = stack.back();
+					stack.pop_back();
+					onStack[ member ] = false;
+					component.push_back( member );
+				} while( member != node );
+
+				components.push_back( std::move( component ) );
+			}
+		};
+
+		for( size_t node = 0; node != nodes.size(); node++ ) {
+			if( index[ node ] == -1 ) {
+				visit( node );
+			}
+		}
+
+		return components;
+	}
+
+	StaticFrameLayout layoutStaticFrames( const std::vector< StaticFrameModule >& modules ) {
+		std::vector< CallNode > nodes;
+
+		for( const StaticFrameModule& module : modules ) {
+			SymbolResolver symbols = module.symbols->fork();
+			CallScope scope;
+			size_t first = nodes.size();
+
+			bool interrupt = false;
+			for( const auto& declaration : module.program->statements ) {
+				if( auto annotation = std::get_if< std::unique_ptr< Annotation > >( &declaration->value ) ) {
+					interrupt = isInterrupt( **annotation, symbols );
+					continue;
+				}
+
+				if( auto function = std::get_if< std::unique_ptr< FunctionDeclaration > >( &declaration->value ) ) {
+					auto name = ( *function )->name ? getIdentifierName( *( *function )->name ) : std::optional< std::string >{};
+					addNode( nodes, module, **function, name ? *name : "" );
+					nodes.back().interrupt = interrupt;
+					if( name ) {
+						scope.functions[ *name ] = nodes.size() - 1;
+					}
+				} else if( auto type = std::get_if< std::unique_ptr< TypeDeclaration > >( &declaration->value ) ) {
+					auto typeId = getIdentifierName( ( *type )->name );
+					for( const auto& method : ( *type )->functions ) {
+						auto name = method->name ? getIdentifierName( *method->name ) : std::optional< std::string >{};
+						addNode( nodes, module, *method, ( typeId ? *typeId : "" ) + "." + ( name ? *name : "" ) );
+						nodes.back().method = true;
+						if( name ) {
+							scope.methods.emplace( *name, nodes.size() - 1 );
+						}
+					}
+				}
+
+				interrupt = false;
+			}
+
+			for( size_t i = first; i != nodes.size(); i++ ) {
+				findCalls( nodes[ i ].function->body, CallSettings{ nodes, scope, i } );
+			}
+
+			// Neither pointers nor methods ever leave their module
+			for( size_t i = first; i != nodes.size(); i++ ) {
+				if( nodes[ i ].callsUnknown ) {
+					for( size_t j = first; j != nodes.size(); j++ ) {
+						if( nodes[ j ].addressTaken || nodes[ j ].method ) {
+							nodes[ i ].callees.push_back( j );
+						}
+					}
+				}
+			}
+		}
+
+		// Anything an interrupt handler reaches may be running already when the handler starts
+		std::vector< size_t > pending;
+		for( size_t i = 0; i != nodes.size(); i++ ) {
+			if( nodes[ i ].interrupt ) {
+				nodes[ i ].frame.reason = "interrupt handler";
+				pending.push_back( i );
+			}
+		}
+		while( !pending.empty() ) {
+			size_t node = pending.back();
+			pending.pop_back();
+			for( size_t callee : nodes[ node ].callees ) {
+				if( nodes[ callee ].frame.reason.empty() ) {
+					nodes[ callee ].frame.reason = "reached from an interrupt handler";
+					pending.push_back( callee );
+				}
+			}
+		}
+
+		// Components come callees first, so walking them backwards reaches every caller before its callees. A
+		// static frame starts past the end of every static frame that can be live when its function is called.
+		std::vector< std::vector< size_t > > components = getComponents( nodes );
+		std::vector< size_t > componentOf( nodes.size() );
+		for( size_t i = 0; i != components.size(); i++ ) {
+			for( size_t node : components[ i ] ) {
+				componentOf[ node ] = i;
+			}
+		}
+
+		StaticFrameLayout layout{ {}, 0 };
+		std::vector< long > starts( components.size(), 0 );
+		for( size_t i = components.size(); i-- != 0; ) {
+			long end = starts[ i ];
+			for( size_t node : components[ i ] ) {
+				CallNode& callNode = nodes[ node ];
+				bool recursive = components[ i ].size() > 1 ||
+					std::find( callNode.callees.begin(), callNode.callees.end(), node ) != callNode.callees.end();
+				if( recursive && callNode.frame.reason.empty() ) {
+					callNode.frame.reason = "recursive";
+				}
+
+				if( callNode.frame.reason.empty() ) {
+					callNode.frame.offset = starts[ i ];
+					end = starts[ i ] + callNode.frame.size;
+				}
+			}
+
+			layout.size = std::max( layout.size, end );
+			for( size_t node : components[ i ] ) {
+				for( size_t callee : nodes[ node ].callees ) {
+					size_t calleeComponent = componentOf[ callee ];
+					if( calleeComponent != i ) {
+						starts[ calleeComponent ] = std::max( starts[ calleeComponent ], end );
+					}
+				}
+			}
+		}
+
+		for( CallNode& node : nodes ) {
+			layout.frames.emplace( node.function, std::move( node.frame ) );
+		}
+
+		return layout;
+	}
+
+	void printStaticFrames( const StaticFrameLayout& layout, long address ) {
+		std::vector< const StaticFrame* > frames;
+		for( const auto& [ function, frame ] : layout.frames ) {
+			frames.push_back( &frame );
+		}
+		std::sort( frames.begin(), frames.end(), []( const StaticFrame* lhs, const StaticFrame* rhs ) {
+			if( lhs->offset.has_value() != rhs->offset.has_value() ) {
+				return lhs->offset.has_value();
+			}
+			if( lhs->offset != rhs->offset ) {
+				return lhs->offset < rhs->offset;
+			}
+			return std::tie( lhs->module, lhs->id ) < std::tie( rhs->module, rhs->id );
+		} );
+
+		std::cout << "Static frames:" << std::endl;
+		for( const StaticFrame* frame : frames ) {
+			if( frame->offset ) {
+				std::cout << "  $" << std::uppercase << std::hex << address + *frame->offset << std::dec << std::nouppercase;
+			} else {
+				std::cout << "  stack  ";
+			}
+
+			std::cout << std::right << std::setw( 8 ) << frame->size << "  " << std::left;
+			if( frame->reason.empty() ) {
+				std::cout << frame->module << ":" << frame->id << std::endl;
+			} else {
+				std::cout << std::setw( 32 ) << ( frame->module + ":" + frame->id ) << " " << frame->reason << std::endl;
+			}
+		}
+
+		std::cout << std::right << "Static frames peak at " << layout.size << " bytes" << std::endl;
+	}
+
+}
\ No newline at end of file
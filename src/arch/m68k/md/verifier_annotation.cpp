@@ -5,18 +5,20 @@
 
 namespace GoldScorpion::m68k::md {
 
-    AnnotationPackage getAnnotationPackage( const AssignmentExpression& node, AnnotationSettings settings ) {
+    Result< AnnotationPackage, Error > getAnnotationPackage( const AssignmentExpression& node, AnnotationSettings settings ) {
+        using PackageResult = Result< AnnotationPackage, Error >;
+
         // LHS must be an identifier
         std::optional< std::string > directive = getIdentifierName( *node.identifier );
         if( !directive ) {
-            Error{ "Unable to obtain directive name for annotation", settings.nearestToken }.throwException();
+            return PackageResult::err( Error{ "Unable to obtain directive name for annotation", settings.nearestSpan } );
         }
 
         switch( Utility::hash( directive->c_str() ) ) {
             case Utility::hash( "interrupt" ): {
                 std::optional< std::string > value = getIdentifierName( *node.expression );
                 if( !value ) {
-                    Error{ "Unable to obtain value for \"interrupt\" directive: Must provide one of: \"vblank\", \"hblank\", \"external\", \"addressException\", \"illegalException\", \"divException\"", settings.nearestToken }.throwException();
+                    return PackageResult::err( Error{ "Unable to obtain value for \"interrupt\" directive: Must provide one of: \"vblank\", \"hblank\", \"external\", \"addressException\", \"illegalException\", \"divException\"", settings.nearestSpan } );
                 }
 
                 switch( Utility::hash( value->c_str() ) ) {
@@ -27,50 +29,111 @@ namespace GoldScorpion::m68k::md {
                     case Utility::hash( "illegalException" ):
                     case Utility::hash( "divException" ):
                         // pass
-                        return AnnotationPackage{ *directive, *value };
+                        return PackageResult::good( AnnotationPackage{ *directive, *value } );
                     default:
-                        Error{ "Invalid value \"" + *value +  "\" provided for \"interrupt\" directive: Must provide one of: \"vblank\", \"hblank\", \"external\", \"addressException\", \"illegalException\", \"divException\"", settings.nearestToken }.throwException();
+                        return PackageResult::err( Error{ "Invalid value \"" + *value +  "\" provided for \"interrupt\" directive: Must provide one of: \"vblank\", \"hblank\", \"external\", \"addressException\", \"illegalException\", \"divException\"", settings.nearestSpan } );
                 }
-                break;
             }
             default:
-                Error{ "Invalid annotation directive name: " + *directive, settings.nearestToken }.throwException();
+                return PackageResult::err( Error{ "Invalid annotation directive name: " + *directive, settings.nearestSpan } );
+        }
+    }
+
+    Result< AnnotationPackage, Error > getAnnotationFlag( const Primary& node, AnnotationSettings settings ) {
+        using PackageResult = Result< AnnotationPackage, Error >;
+
+        // A bare identifier switches its directive on
+        const Token* token = std::get_if< Token >( &node.value );
+        std::optional< std::string > directive = token ? getIdentifierName( *token ) : std::optional< std::string >{};
+        if( !directive ) {
+            return PackageResult::err( Error{ "Unable to obtain directive name for annotation", settings.nearestSpan } );
         }
 
-         return AnnotationPackage{ "", "" };
+        switch( Utility::hash( directive->c_str() ) ) {
+            case Utility::hash( "pad_pow2" ):
+                return PackageResult::good( AnnotationPackage{ *directive, true } );
+            default:
+                return PackageResult::err( Error{ "Invalid annotation flag name: " + *directive, settings.nearestSpan } );
+        }
     }
 
-    std::vector< AnnotationPackage > getAnnotationPackageList( const Annotation& annotation, AnnotationSettings settings ) {
+    Result< std::vector< AnnotationPackage >, Error > getAnnotationPackageList( const Annotation& annotation, AnnotationSettings settings ) {
+        using PackageListResult = Result< std::vector< AnnotationPackage >, Error >;
         std::vector< AnnotationPackage > result;
 
         // Only Primary and AssignmentExpression valid here
         for( const auto& expression : annotation.directives ) {
             if( auto assignmentExpression = std::get_if< std::unique_ptr< AssignmentExpression > >( &expression->value ) ) {
-                result.push_back( getAnnotationPackage( **assignmentExpression, settings ) );
+                auto package = getAnnotationPackage( **assignmentExpression, settings );
+                if( !package ) {
+                    return PackageListResult::err( package.getError() );
+                }
+
+                result.push_back( package.claim() );
+            } else if( auto primary = std::get_if< std::unique_ptr< Primary > >( &expression->value ) ) {
+                auto package = getAnnotationFlag( **primary, settings );
+                if( !package ) {
+                    return PackageListResult::err( package.getError() );
+                }
+
+                result.push_back( package.claim() );
             } else {
-                Error{ "Invalid expression subtype for annotation: Valid type is AssignmentExpression", settings.nearestToken }.throwException();
+                return PackageListResult::err( Error{ "Invalid expression subtype for annotation: Valid types are Primary and AssignmentExpression", settings.nearestSpan } );
             }
         }
 
-        return result;
+        return PackageListResult::good( std::move( result ) );
     }
 
-    void checkInterrupt( const std::optional< SymbolType >& functionReturnType, const std::optional< Token >& nearestToken ) {
+    std::optional< Error > checkInterrupt( const std::optional< SymbolType >& functionReturnType, SourceSpan nearestSpan ) {
         // No interrupt can have a return type
         if( functionReturnType ) {
-            Error{ "Function annotated with type \"interrupt\" cannot return any type", nearestToken }.throwException();
+            return Error{ "Function annotated with type \"interrupt\" cannot return any type", nearestSpan };
         }
+
+        return {};
     }
 
-    void checkFunction( const std::string& directive, const std::optional< Token >& nearestToken, const std::optional< SymbolType >& functionReturnType ) {
+    std::optional< Error > checkFunction( const std::string& directive, SourceSpan nearestSpan, const std::optional< SymbolType >& functionReturnType ) {
         switch( Utility::hash( directive.c_str() ) ) {
             case Utility::hash( "interrupt" ): {
-                return checkInterrupt( functionReturnType, nearestToken );
+                return checkInterrupt( functionReturnType, nearestSpan );
+            }
+            case Utility::hash( "pad_pow2" ): {
+                return Error{ "Annotation \"pad_pow2\" can only be applied to an array variable", nearestSpan };
             }
             default: {
-                Error{ "Internal compiler error (invalid Annotation directive type " + directive + ")", nearestToken }.throwException();
+                return Error{ "Internal compiler error (invalid Annotation directive type " + directive + ")", nearestSpan };
             }
         }
     }
 
+    std::optional< Error > checkVariable( const std::string& directive, SourceSpan nearestSpan, const SymbolType& variableType ) {
+        switch( Utility::hash( directive.c_str() ) ) {
+            case Utility::hash( "interrupt" ): {
+                return Error{ "Annotation \"interrupt\" can only be applied to a function", nearestSpan };
+            }
+            case Utility::hash( "pad_pow2" ): {
+                if( !std::holds_alternative< SymbolArrayType >( variableType ) ) {
+                    return Error{ "Annotation \"pad_pow2\" can only be applied to an array variable", nearestSpan };
+                }
+
+                return {};
+            }
+            default: {
+                return Error{ "Internal compiler error (invalid Annotation directive type " + directive + ")", nearestSpan };
+            }
+        }
+    }
+
+    bool padsArrays( const std::vector< AnnotationPackage >& packages ) {
+        for( const AnnotationPackage& package : packages ) {
+            if( package.id == "pad_pow2" ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
 }
\ No newline at end of file
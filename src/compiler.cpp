@@ -2,106 +2,674 @@
 #include "variant_visitor.hpp"
 #include "utility.hpp"
 #include "lexer.hpp"
+#include "source_map.hpp"
 #include "parser.hpp"
 #include "verifier.hpp"
+#include "tree_tools.hpp"
 #include "log.hpp"
+#include "phase.hpp"
+#include "stats.hpp"
 #include "visitor_print.hpp"
+#include "visitor_memory.hpp"
+#include "depfile.hpp"
+#include "arch/m68k/md/ram_layout.hpp"
+#include "arch/m68k/md/static_frames.hpp"
+#include "arch/m68k/directive.hpp"
+#include "string_pool.hpp"
 #include <vector>
 #include <utility>
+#include <algorithm>
+#include <filesystem>
 
 namespace GoldScorpion {
 
-	Result< Program, std::string > fileToTree( const std::string& parseFilename, CompilerSettings settings ) {
-		auto fileResult = Utility::fileToString( parseFilename );
+	/**
+	 * Move diagnostics from a single phase into the compile-wide sink, prefixed with what was being done
+	 */
+	static void reportPhase( Diagnostics& diagnostics, const std::string& prefix, const Diagnostics& phase ) {
+		for( const Error& error : phase.getErrors() ) {
+			diagnostics.report( Error{ prefix + error.toString(), {} } );
+		}
+	}
+
+	/**
+	 * Lay out the stack frame of every function and method in a module
+	 */
+	static std::map< const FunctionDeclaration*, FrameLayout > layoutFrames( const std::string& module, const Program& program, const SymbolResolver& symbols ) {
+		// Each method goes with the type it belongs to
+		std::vector< std::pair< const FunctionDeclaration*, std::optional< std::string > > > functions;
+		for( const auto& declaration : program.statements ) {
+			if( auto function = std::get_if< std::unique_ptr< FunctionDeclaration > >( &declaration->value ) ) {
+				functions.emplace_back( function->get(), std::nullopt );
+			} else if( auto type = std::get_if< std::unique_ptr< TypeDeclaration > >( &declaration->value ) ) {
+				for( const auto& function : ( *type )->functions ) {
+					functions.emplace_back( function.get(), getIdentifierName( ( *type )->name ) );
+				}
+			}
+		}
 
-		if( auto file = std::get_if< Utility::File >( &fileResult ) ) {
-			settings.symbols.addFile( parseFilename );
+		std::map< const FunctionDeclaration*, FrameLayout > frames;
+		for( const auto& [ function, contextTypeId ] : functions ) {
+			if( auto frame = layoutFrame( module, *function, symbols, contextTypeId ) ) {
+				GS_COUNT_BY( FRAME_BYTES, frame->size );
+				GS_COUNT_BY( FRAME_BYTES_SHARED, frame->unsharedSize - frame->size );
+				frames.emplace( function, std::move( *frame ) );
+			}
+		}
+
+		return frames;
+	}
 
-			auto tokenResult = getTokens( file->contents );
-			if( auto tokens = std::get_if< std::vector< Token > >( &tokenResult ) ) {
-				printSuccess( "Lexed file " + parseFilename );
+	/**
+	 * Tell the user what power-of-two padding costs in RAM for each padded global array in the module
+	 */
+	static void reportPadding( const std::string& module, const Program& program, SymbolResolver& symbols ) {
+		for( const auto& declaration : program.statements ) {
+			auto varDeclaration = std::get_if< std::unique_ptr< VarDeclaration > >( &declaration->value );
+			if( !varDeclaration ) {
+				continue;
+			}
 
-				if( settings.printLex ) {
-					for( const Token& token : *tokens ) {
-						std::cout << token.toString() << std::endl;
-					}
+			auto name = getIdentifierName( ( *varDeclaration )->variable.name );
+			auto symbol = name ? symbols.findSymbol( module, *name ) : std::optional< Symbol >{};
+			auto variable = symbol ? std::get_if< VariableSymbol >( &symbol->symbol ) : nullptr;
+			auto array = variable ? std::get_if< SymbolArrayType >( &variable->type ) : nullptr;
+			if( !array || !array->padded ) {
+				continue;
+			}
+
+			auto layout = getTypeLayout( variable->type, SymbolTypeSettings{ module, symbols } );
+			if( !layout ) {
+				continue;
+			}
+
+			long paddedElements = array->strides.back() * array->dimensions.back();
+			long elements = 1;
+			for( long dimension : array->dimensions ) {
+				elements *= dimension;
+			}
+
+			long elementSize = paddedElements ? layout->size / paddedElements : 0;
+			printInfo(
+				"Padded array " + *name + " in " + module + " uses " + std::to_string( layout->size ) + " bytes (" +
+				std::to_string( ( paddedElements - elements ) * elementSize ) + " bytes of padding)"
+			);
+		}
+	}
+
+	/**
+	 * The modules a program imports, by the names their files are known by
+	 */
+	static std::vector< std::string > getImports( const Program& program, ModuleResolver& modules ) {
+		std::vector< std::string > imports;
+		for( const auto& statement : program.statements ) {
+			if( auto importDeclaration = std::get_if< std::unique_ptr< ImportDeclaration > >( &statement->value ) ) {
+				imports.push_back( modules.resolveName( ( *importDeclaration )->path ) );
+			}
+		}
+
+		return imports;
+	}
+
+	/**
+	 * Lex and parse a file that has been read, or say why it could not be
+	 */
+	static ParsedFile parseSource( const std::string& path, const VariantResult< Utility::File >& fileResult, bool keepTokens ) {
+		ParsedFile parsed;
+
+		auto file = std::get_if< Utility::File >( &fileResult );
+		if( !file ) {
+			parsed.diagnostics.report( Error{ "Could not open file " + path + ": " + std::get< std::string >( fileResult ), {} } );
+			return parsed;
+		}
+
+		parsed.read = true;
+
+		auto base = SourceMap::addFile( path, file->contents );
+		if( !base ) {
+			parsed.diagnostics.report( Error{ "Could not lex file " + path + ": Out of source positions for this file", {} } );
+			return parsed;
+		}
+		parsed.file = SourceMap::RegisteredFile( *base );
+
+		auto tokens = [ & ]() {
+			Phase phase( path, "lex" );
+			return getTokens( file->contents, *base );
+		}();
+		if( !tokens ) {
+			parsed.diagnostics.report( Error{ "Could not lex file " + path + ": " + tokens.getError().toString(), {} } );
+			return parsed;
+		}
+
+		parsed.lexed = true;
+		if( keepTokens ) {
+			parsed.tokens = *tokens;
+		}
+
+		Diagnostics parseDiagnostics;
+		parsed.tree = [ & ]() {
+			Phase phase( path, "parse" );
+			return getProgram( tokens.claim(), parseDiagnostics );
+		}();
+		if( !parsed.tree ) {
+			reportPhase( parsed.diagnostics, "Could not parse file " + path + ": ", parseDiagnostics );
+		}
+
+		return parsed;
+	}
+
+	static VariantResult< Utility::File > readSource( const std::string& path, const SourceProvider& sources ) {
+		Phase phase( path, "read" );
+		return sources.read( path );
+	}
+
+	ParsedFile parseFile( const std::string& path, const SourceProvider& sources, bool keepTokens ) {
+		return parseSource( path, readSource( path, sources ), keepTokens );
+	}
+
+	/**
+	 * Errors are compared by what they say, since the spans in a module change every time it is lexed again
+	 */
+	static bool sameDiagnostics( const Diagnostics& lhs, const Diagnostics& rhs ) {
+		const std::vector< Error >& lhsErrors = lhs.getErrors();
+		const std::vector< Error >& rhsErrors = rhs.getErrors();
+		return std::equal( lhsErrors.begin(), lhsErrors.end(), rhsErrors.begin(), rhsErrors.end(), []( const Error& lhs, const Error& rhs ) {
+			return lhs.toString() == rhs.toString();
+		} );
+	}
+
+	// Memos are only ever added from one thread, so that prefetch can read them from many
+	template< typename Value >
+	static Memo< Value >& getMemo( std::map< std::string, Memo< Value > >& memos, const std::string& module ) {
+		auto memo = memos.find( module );
+		return memo != memos.end() ? memo->second : memos[ module ];
+	}
+
+	QueryDatabase::QueryDatabase( CompileOptions options ) :
+		options( std::move( options ) ),
+		modules( this->options.sources ? *this->options.sources : disk, this->options.searchPaths ) {}
+
+	const CompileOptions& QueryDatabase::getOptions() const {
+		return options;
+	}
+
+	void QueryDatabase::invalidate( const std::string& module ) {
+		getMemo( sourceMemos, module ).state.invalidated = true;
+		revision++;
+	}
+
+	void QueryDatabase::invalidateAll() {
+		for( auto& memo : sourceMemos ) {
+			memo.second.state.invalidated = true;
+		}
+		// A file added under a search root can now be what an import finds
+		modules.forgetImportPaths();
+		revision++;
+	}
+
+	std::string QueryDatabase::resolveName( const std::string& importPath ) {
+		return modules.resolveName( importPath );
+	}
+
+	/**
+	 * Whether anything a result read has changed since the result was last known to be current. Each dependency is
+	 * brought up to date first, which may mean computing it again.
+	 */
+	bool QueryDatabase::stale( QueryState& state ) {
+		if( state.verifiedAt == revision ) {
+			return false;
+		}
+
+		// Reached again while being verified, through a cycle of imports; only computing it again will say how
+		if( state.active ) {
+			return true;
+		}
+
+		bool changed = false;
+		state.active = true;
+		// Bringing dependencies up to date is not reading them, so the query asking is not made to depend on them
+		Query::collect( [ & ]() {
+			for( const QueryKey& dependency : state.dependencies ) {
+				if( refresh( dependency ) > state.verifiedAt ) {
+					changed = true;
+					return;
 				}
+			}
+		} );
+		state.active = false;
 
-				auto parserResult = getProgram( *tokens );
-				if( auto program = std::get_if< Program >( &parserResult ) ) {
-					printSuccess( "Parsed file " + parseFilename );
+		if( !changed ) {
+			state.verifiedAt = revision;
+		}
 
-					if( settings.printAst ) {
-						GoldScorpion::printAst( *program );
-					}
+		return changed;
+	}
 
-					return Result< Program, std::string >::good( std::move( *program ) );
-				} else {
-					return Result< Program, std::string >::err( "Could not parse file " + parseFilename + ": " + std::get< std::string >( std::move( parserResult ) ) );
+	Revision QueryDatabase::refresh( const QueryKey& key ) {
+		switch( key.kind ) {
+			case QueryKind::SOURCE:
+				source( key.module );
+				return getMemo( sourceMemos, key.module ).state.changedAt;
+			case QueryKind::PARSE:
+				parse( key.module );
+				return getMemo( parseMemos, key.module ).state.changedAt;
+			case QueryKind::IMPORTS:
+				imports( key.module );
+				return getMemo( importMemos, key.module ).state.changedAt;
+			case QueryKind::FOLD:
+				fold( key.module );
+				return getMemo( foldMemos, key.module ).state.changedAt;
+			case QueryKind::CHECK:
+			default: {
+				Memo< ModuleCheck >& memo = getMemo( checkMemos, key.module );
+				// A module in the middle of being checked has not changed yet as far as the cycle can see
+				if( memo.state.active ) {
+					return memo.state.changedAt;
+				}
+
+				check( key.module );
+				return memo.state.changedAt;
+			}
+		}
+	}
+
+	template< typename Value, typename Compute, typename Equal >
+	const Value& QueryDatabase::fetch( Memo< Value >& memo, const QueryKey& key, Compute compute, Equal equal ) {
+		Query::record( key );
+
+		if( memo.value && !memo.state.invalidated && !stale( memo.state ) ) {
+			return *memo.value;
+		}
+
+		std::optional< Value > value;
+		memo.state.active = true;
+		memo.state.dependencies = Query::collect( [ & ]() { value = compute(); } );
+		memo.state.active = false;
+		memo.state.invalidated = false;
+
+		// A result that comes out the same keeps its old revision, so nothing that read it has to be redone
+		if( !memo.value || !equal( *memo.value, *value ) ) {
+			memo.value = std::move( value );
+			memo.state.changedAt = revision;
+		}
+		memo.state.verifiedAt = revision;
+
+		return *memo.value;
+	}
+
+	const VariantResult< Utility::File >& QueryDatabase::source( const std::string& module ) {
+		// Sources are inputs: they depend on nothing, and are only read again when the host says they changed
+		return fetch(
+			getMemo( sourceMemos, module ),
+			QueryKey{ QueryKind::SOURCE, module },
+			[ & ]() { return readSource( module, options.sources ? *options.sources : disk ); },
+			[]( const VariantResult< Utility::File >& lhs, const VariantResult< Utility::File >& rhs ) {
+				auto lhsFile = std::get_if< Utility::File >( &lhs );
+				auto rhsFile = std::get_if< Utility::File >( &rhs );
+				if( lhsFile && rhsFile ) {
+					return lhsFile->contents == rhsFile->contents;
+				}
+
+				return !lhsFile && !rhsFile && std::get< std::string >( lhs ) == std::get< std::string >( rhs );
+			}
+		);
+	}
+
+	std::shared_ptr< const ParsedFile > QueryDatabase::parse( const std::string& module ) {
+		return fetch(
+			getMemo( parseMemos, module ),
+			QueryKey{ QueryKind::PARSE, module },
+			[ & ]() { return std::shared_ptr< const ParsedFile >( std::make_shared< ParsedFile >( parseSource( module, source( module ), options.printLex ) ) ); },
+			// Trees are never compared; the source they came from already was
+			[]( const auto&, const auto& ) { return false; }
+		);
+	}
+
+	const std::vector< std::string >& QueryDatabase::imports( const std::string& module ) {
+		return fetch(
+			getMemo( importMemos, module ),
+			QueryKey{ QueryKind::IMPORTS, module },
+			[ & ]() {
+				std::shared_ptr< const ParsedFile > parsed = parse( module );
+				return parsed->tree ? getImports( *parsed->tree, modules ) : std::vector< std::string >{};
+			},
+			std::equal_to< std::vector< std::string > >()
+		);
+	}
+
+	const ModuleCheck& QueryDatabase::check( const std::string& module ) {
+		return fetch(
+			getMemo( checkMemos, module ),
+			QueryKey{ QueryKind::CHECK, module },
+			[ & ]() { return computeCheck( module ); },
+			[]( const ModuleCheck& lhs, const ModuleCheck& rhs ) {
+				return lhs.valid == rhs.valid && sameDiagnostics( lhs.diagnostics, rhs.diagnostics );
+			}
+		);
+	}
+
+	ModuleCheck QueryDatabase::computeCheck( const std::string& module ) {
+		ModuleCheck result;
+
+		// Spans the whole module, so the imports it triggers nest inside it in the trace
+		Phase phase( module, "module" );
+
+		std::shared_ptr< const ParsedFile > parsed = parse( module );
+
+		// Progress is reported here rather than while parsing, so the output is in the same order however the
+		// modules were parsed
+		if( parsed->lexed ) {
+			if( options.printProgress ) {
+				printSuccess( "Lexed file " + module );
+			}
+
+			if( options.printLex ) {
+				for( const Token& token : parsed->tokens ) {
+					std::cout << token.toString() << std::endl;
 				}
+			}
+		}
+
+		if( !parsed->tree ) {
+			result.diagnostics = parsed->diagnostics;
+			return result;
+		}
+
+		if( options.printProgress ) {
+			printSuccess( "Parsed file " + module );
+		}
+
+		if( options.printAst ) {
+			GoldScorpion::printAst( *parsed->tree );
+		}
+
+		if( options.printAstMemory ) {
+			std::cout << "Memory held by the tree for " << module << ":" << std::endl;
+			printAstMemory( *parsed->tree );
+		}
+
+		// Every import is checked even if an earlier one failed, so that all of their errors come out in one run
+		bool importsResolved = true;
+		for( const std::string& import : imports( module ) ) {
+			if( getMemo( checkMemos, import ).state.active ) {
+				Query::record( QueryKey{ QueryKind::CHECK, import } );
+				result.diagnostics.report( Error{ "Circular dependency detected: " + import, {} } );
+				importsResolved = false;
 			} else {
-				return Result< Program, std::string >::err( "Could not lex file " + parseFilename + ": " + std::get< std::string >( tokenResult ) );
+				importsResolved = check( import ).valid && importsResolved;
 			}
-		} else {
-			return Result< Program, std::string >::err( "Could not open file " + parseFilename + ": " + std::get< std::string >( fileResult ) );
 		}
+
+		// Validate this file, unless it depends on something broken; any errors found then would only be fallout
+		auto symbols = std::make_shared< SymbolResolver >();
+		symbols->addFile( module );
+		Diagnostics checkDiagnostics;
+		bool valid = importsResolved && [ & ]() {
+			Phase phase( module, "check" );
+			return GoldScorpion::check( module, *parsed->tree, *symbols, checkDiagnostics );
+		}();
+
+		if( !valid ) {
+			reportPhase( result.diagnostics, "Failed to validate file " + module + ": ", checkDiagnostics );
+			return result;
+		}
+
+		if( options.printProgress ) {
+			printSuccess( "Validated file " + module );
+			reportPadding( module, *parsed->tree, *symbols );
+		}
+
+		result.valid = true;
+		result.symbols = std::move( symbols );
+		return result;
 	}
 
-	Result< Program, std::string > fileToProgram( const std::string& parseFilename, CompilerSettings settings ) {
-		// Do not do a thing if this file was opened before it was done
-		if( settings.activeFiles.count( parseFilename ) ) {
-			return Result< Program, std::string >::err( "Circular dependency detected: " + parseFilename );
+	std::shared_ptr< const FoldedModule > QueryDatabase::fold( const std::string& module ) {
+		return fetch(
+			getMemo( foldMemos, module ),
+			QueryKey{ QueryKind::FOLD, module },
+			[ & ]() { return computeFold( module ); },
+			// Frames point into their own tree, so a new tree is never the same as an old one
+			[]( const auto&, const auto& ) { return false; }
+		);
+	}
+
+	std::shared_ptr< const FoldedModule > QueryDatabase::computeFold( const std::string& module ) {
+		const ModuleCheck& checked = check( module );
+		if( !checked.valid ) {
+			return nullptr;
+		}
+
+		auto folded = std::make_shared< FoldedModule >();
+		folded->parsed = parse( module );
+		{
+			Phase phase( module, "fold" );
+			folded->tree = copyProgram( *folded->parsed->tree );
+			foldConstants( module, folded->tree, *checked.symbols );
 		}
 
-		// Mark file active while processing
-		// If we try to reload this file before it was processed, it will throw a circular dependency error
-		settings.activeFiles.insert( parseFilename );
+		// Laid out after folding, so that no local is kept alive by a reference that folded away
+		{
+			Phase phase( module, "frames" );
+			folded->frames = layoutFrames( module, folded->tree, *checked.symbols );
+		}
 
-		// Lex and parse file
-		Result< Program, std::string > tree = fileToTree( parseFilename, settings );
+		return folded;
+	}
 
-		// Hand down error if it's an error
-		if( !tree ) {
-			return tree;
+	void QueryDatabase::prefetch( const std::vector< std::string >& entryModules ) {
+		std::set< std::string > seen;
+		std::vector< std::string > level;
+		for( const std::string& entryModule : entryModules ) {
+			if( seen.insert( entryModule ).second ) {
+				level.push_back( entryModule );
+			}
 		}
 
-		for( const auto& statement : ( *tree ).statements ) {
-			// Expose file to SymbolResolver so that symbols can be properly exposed
-			if( auto importDeclaration = std::get_if< std::unique_ptr< ImportDeclaration > >( &statement->value ) ) {
-				// Don't reload the file if it was already active
-				if( !settings.resolvedFiles.count( ( *importDeclaration )->path ) ) {
-					auto result = fileToProgram( ( *importDeclaration )->path, settings );
-					if( !result ) {
-						return result;
+		// A module's imports are only known once it has been parsed, so the graph is discovered level by level
+		while( !level.empty() ) {
+			// Each job below touches only its own module's memos, which must exist before the jobs start
+			for( const std::string& module : level ) {
+				getMemo( sourceMemos, module );
+				getMemo( parseMemos, module );
+			}
+
+			Utility::parallelFor( level.size(), [ & ]( size_t i ) {
+				parse( level[ i ] );
+			} );
+
+			std::vector< std::string > nextLevel;
+			for( const std::string& module : level ) {
+				for( const std::string& import : imports( module ) ) {
+					if( seen.insert( import ).second ) {
+						nextLevel.push_back( import );
 					}
 				}
 			}
+
+			level = std::move( nextLevel );
 		}
+	}
 
-		// Validate this file
-		if( auto error = check( parseFilename, *tree, settings.symbols ) ) {
-			return Result< Program, std::string >::err( "Failed to validate file " + parseFilename + ": " + *error );
-		} else {
-			printSuccess( "Validated file " + parseFilename );
-			settings.activeFiles.erase( parseFilename );
-			settings.resolvedFiles.insert( parseFilename );
-			return Result< Program, std::string >::good( std::move( *tree ) );
+	/**
+	 * Every module a target was built from, in the order they were first imported
+	 */
+	static void getDependencies( const std::string& module, QueryDatabase& database, std::set< std::string >& seen, std::vector< std::string >& dependencies ) {
+		if( !database.parse( module )->read || !seen.insert( module ).second ) {
+			return;
+		}
+
+		dependencies.push_back( module );
+		for( const std::string& import : database.imports( module ) ) {
+			getDependencies( import, database, seen, dependencies );
 		}
 	}
 
-    int compile( const std::string& parseFilename, bool printLex, bool printAst ) {
-		SymbolResolver symbols;
-		std::set< std::string > activeFiles;
-		std::set< std::string > resolvedFiles;
+	/**
+	 * Report the errors of a target's modules in the order checking them found the errors: each module after its
+	 * imports, except one that never parsed, as its imports were never known
+	 */
+	static void collectDiagnostics( const std::string& module, QueryDatabase& database, std::set< std::string >& seen, Diagnostics& diagnostics ) {
+		if( !seen.insert( module ).second ) {
+			return;
+		}
+
+		if( database.parse( module )->tree ) {
+			for( const std::string& import : database.imports( module ) ) {
+				collectDiagnostics( import, database, seen, diagnostics );
+			}
+		}
 
-		Result< Program, std::string > result = fileToProgram( parseFilename, CompilerSettings{ activeFiles, resolvedFiles, symbols, printLex, printAst } );
+		diagnostics.append( database.check( module ).diagnostics );
+	}
+
+	/**
+	 * Place the globals of a target and every module it imports in RAM, along with the static frames of its
+	 * functions when they are asked for
+	 */
+	static std::optional< Error > layoutTarget( const std::string& entryModule, QueryDatabase& database ) {
+		const CompileOptions& options = database.getOptions();
+
+		std::vector< std::string > dependencies;
+		std::set< std::string > seen;
+		getDependencies( entryModule, database, seen, dependencies );
+
+		std::vector< m68k::md::RamModule > ramModules;
+		std::vector< m68k::md::StaticFrameModule > frameModules;
+		std::vector< std::shared_ptr< const FoldedModule > > folded;
+		for( const std::string& module : dependencies ) {
+			folded.push_back( database.fold( module ) );
+			const ModuleCheck& check = database.check( module );
+			ramModules.push_back( m68k::md::RamModule{ module, &folded.back()->tree, check.symbols.get() } );
+			frameModules.push_back( m68k::md::StaticFrameModule{ module, &folded.back()->tree, check.symbols.get(), &folded.back()->frames } );
+		}
 
-		if( !result ) {
-			printError( result.getError() );
-			return 1;
+		Phase phase( entryModule, "ram" );
+		std::optional< m68k::md::StaticFrameLayout > staticFrames;
+		if( options.staticFrames ) {
+			staticFrames = m68k::md::layoutStaticFrames( frameModules );
+		}
+
+		auto ram = m68k::md::layoutRam( ramModules, staticFrames ? staticFrames->size : 0 );
+		if( !ram ) {
+			return ram.getError();
+		}
+
+		if( options.printRamMap ) {
+			m68k::md::printRamLayout( *ram );
+			if( staticFrames ) {
+				m68k::md::printStaticFrames( *staticFrames, ram->staticFrames );
+			}
+		}
+
+		return {};
+	}
+
+	/**
+	 * Pool the string literals of a target and every module it imports, so that each is stored once
+	 */
+	static StringPool poolTargetStrings( const std::string& entryModule, QueryDatabase& database ) {
+		std::vector< std::string > dependencies;
+		std::set< std::string > seen;
+		getDependencies( entryModule, database, seen, dependencies );
+
+		std::vector< std::shared_ptr< const FoldedModule > > folded;
+		std::vector< const Program* > programs;
+		for( const std::string& module : dependencies ) {
+			folded.push_back( database.fold( module ) );
+			programs.push_back( &folded.back()->tree );
+		}
+
+		Phase phase( entryModule, "strings" );
+		StringPool pool = buildStringPool( programs );
+		GS_COUNT_BY( STRING_LITERAL_BYTES, pool.unpooledSize );
+		GS_COUNT_BY( STRING_POOL_BYTES, pool.data.size() );
+		return pool;
+	}
+
+	static std::string getTargetPath( const std::string& entryFile, const CompileOptions& options, size_t targetCount ) {
+		if( !options.outputPath.empty() && targetCount == 1 ) {
+			return options.outputPath;
+		}
+
+		return std::filesystem::path( entryFile ).replace_extension( ".bin" ).string();
+	}
+
+	std::vector< bool > build( const std::vector< std::string >& entryFiles, const CompileOptions& options, Diagnostics& diagnostics ) {
+		QueryDatabase database( options );
+		return build( entryFiles, database, diagnostics );
+	}
+
+	std::vector< bool > build( const std::vector< std::string >& entryFiles, QueryDatabase& database, Diagnostics& diagnostics ) {
+		const CompileOptions& options = database.getOptions();
+
+		std::vector< std::string > entryModules;
+		for( const std::string& entryFile : entryFiles ) {
+			entryModules.push_back( database.resolveName( entryFile ) );
+		}
+
+		database.prefetch( entryModules );
+
+		std::vector< bool > built;
+		std::set< std::string > reported;
+		for( const std::string& entryModule : entryModules ) {
+			built.push_back( database.check( entryModule ).valid );
+			collectDiagnostics( entryModule, database, reported, diagnostics );
+
+			if( !built.back() ) {
+				continue;
+			}
+
+			if( auto error = layoutTarget( entryModule, database ) ) {
+				diagnostics.report( Error{ "Failed to lay out RAM for target " + entryModule + ": " + error->toString(), {} } );
+				built.back() = false;
+			}
+
+			StringPool strings = poolTargetStrings( entryModule, database );
+			if( options.printStrings ) {
+				std::cout << m68k::toByteDirectives( "strings", strings.data );
+			}
+		}
+
+		if( !options.depfilePath.empty() ) {
+			std::vector< DepfileRule > rules;
+			for( size_t i = 0; i != entryModules.size(); i++ ) {
+				DepfileRule rule{ getTargetPath( entryModules[ i ], options, entryModules.size() ), {} };
+				std::set< std::string > seen;
+				getDependencies( entryModules[ i ], database, seen, rule.dependencies );
+				rules.push_back( std::move( rule ) );
+			}
+
+			if( !writeDepfile( options.depfilePath, rules, options.depfilePhonyTargets ) ) {
+				diagnostics.report( Error{ "Could not write dependency file " + options.depfilePath, {} } );
+			}
+		}
+
+		return built;
+	}
+
+    int compile( const std::vector< std::string >& entryFiles, const CompileOptions& options ) {
+		Diagnostics diagnostics;
+		Phase phase( "(total)", "compile" );
+
+		std::vector< bool > built = build( entryFiles, options, diagnostics );
+
+		for( const Error& error : diagnostics.getErrors() ) {
+			printError( error.toString() );
+		}
+
+		if( entryFiles.size() > 1 ) {
+			for( size_t i = 0; i != entryFiles.size(); i++ ) {
+				if( built[ i ] ) {
+					printSuccess( "Built target " + entryFiles[ i ] );
+				} else {
+					printError( "Failed to build target " + entryFiles[ i ] );
+				}
+			}
 		}
 
-		return 0;
+		bool result = diagnostics.empty() && std::find( built.begin(), built.end(), false ) == built.end();
+		return result ? 0 : 1;
     }
 
 }
\ No newline at end of file
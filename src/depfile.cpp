@@ -0,0 +1,52 @@
+#include "depfile.hpp"
+#include <fstream>
+#include <set>
+
+namespace GoldScorpion {
+
+	// Spaces separate names and $ starts a variable, so both need escaping in a rule
+	static std::string escapeMake( const std::string& path ) {
+		std::string result;
+		for( char character : path ) {
+			if( character == ' ' || character == '#' ) {
+				result += '\\';
+			} else if( character == '$' ) {
+				result += '$';
+			}
+
+			result += character;
+		}
+
+		return result;
+	}
+
+	bool writeDepfile( const std::string& path, const std::vector< DepfileRule >& rules, bool phonyTargets ) {
+		std::ofstream out( path );
+		if( !out ) {
+			return false;
+		}
+
+		std::set< std::string > written;
+		for( const DepfileRule& rule : rules ) {
+			out << escapeMake( rule.target ) << ":";
+			for( const std::string& dependency : rule.dependencies ) {
+				out << " \\\n  " << escapeMake( dependency );
+			}
+			out << std::endl;
+		}
+
+		if( phonyTargets ) {
+			// As with -MP elsewhere, the file a rule builds from gets no rule of its own
+			for( const DepfileRule& rule : rules ) {
+				for( size_t i = 1; i < rule.dependencies.size(); i++ ) {
+					if( written.insert( rule.dependencies[ i ] ).second ) {
+						out << std::endl << escapeMake( rule.dependencies[ i ] ) << ":" << std::endl;
+					}
+				}
+			}
+		}
+
+		return bool( out );
+	}
+
+}
\ No newline at end of file
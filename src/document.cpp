@@ -0,0 +1,495 @@
+#include "document.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "verifier.hpp"
+#include "type_tools.hpp"
+#include "source_map.hpp"
+#include <algorithm>
+#include <tuple>
+
+namespace GoldScorpion {
+
+	static std::vector< std::string > splitLines( const std::string& text ) {
+		std::vector< std::string > lines;
+		size_t start = 0;
+		size_t end;
+		while( ( end = text.find( '\n', start ) ) != std::string::npos ) {
+			lines.push_back( text.substr( start, end - start ) );
+			start = end + 1;
+		}
+		lines.push_back( text.substr( start ) );
+
+		// Editors send \r\n on some platforms; columns are counted without the \r
+		for( std::string& line : lines ) {
+			if( !line.empty() && line.back() == '\r' ) {
+				line.pop_back();
+			}
+		}
+
+		return lines;
+	}
+
+	// Unlike Token::toString, leaves out where the token is, so moving a declaration does not count as changing it
+	static std::string tokenKey( const Token& token ) {
+		std::string key = std::to_string( ( int ) token.type );
+		if( token.value ) {
+			if( auto string = std::get_if< std::string >( &*token.value ) ) {
+				key += ":" + *string;
+			} else {
+				key += ":" + std::to_string( std::get< long >( *token.value ) );
+			}
+		}
+
+		return key;
+	}
+
+	static std::string dataTypeKey( const DataType& type ) {
+		std::string key = tokenKey( type.type );
+		for( const Token& dimension : type.arrayDimensions ) {
+			key += "[" + tokenKey( dimension ) + "]";
+		}
+
+		return key;
+	}
+
+	/**
+	 * Collect what other declarations can see of a top-level declaration: the names it declares, each with a key
+	 * that changes whenever what the verifier knows about that name changes. Declarations whose effect is not
+	 * captured by a key, such as initialisers or type layouts, get an empty key that never matches.
+	 */
+	static void addSignatures( const Declaration& declaration, std::map< std::string, std::string >& signatures ) {
+		// Whether a variable or constant gets declared at all depends on its initialiser checking, so these always count
+		if( auto var = std::get_if< std::unique_ptr< VarDeclaration > >( &declaration.value ) ) {
+			signatures[ tokenKey( ( *var )->variable.name ) ] = {};
+		} else if( auto constant = std::get_if< std::unique_ptr< ConstDeclaration > >( &declaration.value ) ) {
+			signatures[ tokenKey( ( *constant )->variable.name ) ] = {};
+		} else if( auto function = std::get_if< std::unique_ptr< FunctionDeclaration > >( &declaration.value ) ) {
+			if( ( *function )->name ) {
+				std::string key = "function(";
+				for( const Parameter& argument : ( *function )->arguments ) {
+					key += dataTypeKey( argument.type ) + ",";
+				}
+				key += ")";
+				if( ( *function )->returnType ) {
+					key += dataTypeKey( *( *function )->returnType );
+				}
+
+				signatures[ tokenKey( *( *function )->name ) ] = key;
+			}
+		} else if( auto type = std::get_if< std::unique_ptr< TypeDeclaration > >( &declaration.value ) ) {
+			// Members are reached through instances, so a change to the type also changes every member name
+			signatures[ tokenKey( ( *type )->name ) ] = {};
+			for( const Parameter& field : ( *type )->fields ) {
+				signatures[ tokenKey( field.name ) ] = {};
+			}
+			for( const auto& function : ( *type )->functions ) {
+				if( function->name ) {
+					signatures[ tokenKey( *function->name ) ] = {};
+				}
+			}
+		}
+	}
+
+	static void forEachFunction( const Declaration& declaration, const std::function< void( const FunctionDeclaration& ) >& callback ) {
+		if( auto function = std::get_if< std::unique_ptr< FunctionDeclaration > >( &declaration.value ) ) {
+			callback( **function );
+		} else if( auto type = std::get_if< std::unique_ptr< TypeDeclaration > >( &declaration.value ) ) {
+			for( const auto& function : ( *type )->functions ) {
+				callback( *function );
+			}
+		}
+	}
+
+	Document::Document( std::string fileId, const std::string& text ) : fileId( std::move( fileId ) ) {
+		edit( {}, text );
+	}
+
+	Document::~Document() {
+		for( const auto& [ chunk, base ] : chunks ) {
+			SourceMap::removeFile( base );
+		}
+	}
+
+	size_t Document::firstDeclaration( size_t block ) const {
+		size_t result = 0;
+		for( size_t i = 0; i != block; i++ ) {
+			result += blocks[ i ].declarations;
+		}
+
+		return result;
+	}
+
+	void Document::edit( std::optional< DocumentRange > range, const std::string& text ) {
+		if( !range ) {
+			lines = splitLines( text );
+			reparse( 0, blocks.size(), 0, lines.size() );
+			return;
+		}
+
+		// Editors may send positions past the end of a line or the document; clamp them like they would
+		DocumentPosition start = range->start;
+		DocumentPosition end = range->end;
+		start.line = std::min< uint32_t >( start.line, lines.size() - 1 );
+		end.line = std::min< uint32_t >( end.line, lines.size() - 1 );
+		start.character = std::min< uint32_t >( start.character, lines[ start.line ].size() );
+		end.character = std::min< uint32_t >( end.character, lines[ end.line ].size() );
+		if( std::tie( end.line, end.character ) < std::tie( start.line, start.character ) ) {
+			std::swap( start, end );
+		}
+
+		std::vector< std::string > replacement = splitLines(
+			lines[ start.line ].substr( 0, start.character ) + text + lines[ end.line ].substr( end.character )
+		);
+		int delta = ( int ) replacement.size() - ( int ) ( end.line - start.line + 1 );
+		lines.erase( lines.begin() + start.line, lines.begin() + end.line + 1 );
+		lines.insert( lines.begin() + start.line, replacement.begin(), replacement.end() );
+
+		// Blocks cover the document without gaps, so every edited line falls in one
+		size_t firstBlock = 0;
+		while( firstBlock + 1 < blocks.size() && blocks[ firstBlock ].firstLine + blocks[ firstBlock ].lineCount <= start.line ) {
+			firstBlock++;
+		}
+		size_t lastBlock = firstBlock;
+		while( lastBlock < blocks.size() && blocks[ lastBlock ].firstLine <= end.line ) {
+			lastBlock++;
+		}
+		lastBlock = std::max( lastBlock, std::min( firstBlock + 1, blocks.size() ) );
+
+		uint32_t firstLine = blocks.empty() ? 0 : blocks[ firstBlock ].firstLine;
+		uint32_t oldEnd = blocks.empty() ? 0 : blocks[ lastBlock - 1 ].firstLine + blocks[ lastBlock - 1 ].lineCount;
+		for( size_t i = lastBlock; i != blocks.size(); i++ ) {
+			blocks[ i ].firstLine += delta;
+		}
+
+		reparse( firstBlock, lastBlock, firstLine, oldEnd - firstLine + delta );
+
+		// An unfinished declaration swallows the ones after it, so let it see the rest of the file to report
+		// the same errors a full parse would
+		size_t failed = firstBlock;
+		while( failed != blocks.size() && blocks[ failed ].parseDiagnostics.empty() ) {
+			failed++;
+		}
+		if( failed != blocks.size() && failed + 1 != blocks.size() ) {
+			reparse( failed, blocks.size(), blocks[ failed ].firstLine, lines.size() - blocks[ failed ].firstLine );
+		}
+	}
+
+	/**
+	 * Replace blocks [firstBlock, lastBlock) with whatever the lines [firstLine, firstLine + lineCount) now parse into
+	 */
+	void Document::reparse( size_t firstBlock, size_t lastBlock, uint32_t firstLine, uint32_t lineCount ) {
+		auto firstStatement = program.statements.begin() + firstDeclaration( firstBlock );
+		auto lastStatement = program.statements.begin() + firstDeclaration( lastBlock );
+
+		std::map< std::string, std::string > oldSignatures;
+		for( auto statement = firstStatement; statement != lastStatement; ++statement ) {
+			addSignatures( **statement, oldSignatures );
+			forEachFunction( **statement, [ & ]( const FunctionDeclaration& function ) {
+				bodyDiagnostics.erase( &function );
+				dirtyBodies.erase( &function );
+			} );
+		}
+
+		std::string text;
+		std::vector< size_t > lineStarts;
+		for( uint32_t i = 0; i != lineCount; i++ ) {
+			lineStarts.push_back( text.size() );
+			text += lines[ firstLine + i ] + "\n";
+		}
+
+		std::string chunk = fileId + "#" + std::to_string( ++chunkCount );
+		std::optional< SourceSpan > addedBase = SourceMap::addFile( chunk, text );
+		SourceSpan base = addedBase ? *addedBase : SourceSpan{};
+		if( addedBase ) {
+			chunks[ chunk ] = base;
+		}
+		auto lineOf = [ & ]( SourceSpan span ) {
+			return ( uint32_t ) ( std::upper_bound( lineStarts.begin(), lineStarts.end(), span.id - base.id ) - lineStarts.begin() ) - 1;
+		};
+
+		std::vector< Block > newBlocks;
+		std::vector< std::unique_ptr< Declaration > > newStatements;
+
+		Diagnostics parseDiagnostics;
+		std::vector< Token > tokens;
+		std::optional< Program > parsed;
+		if( !addedBase ) {
+			parseDiagnostics.report( Error{ "Out of source positions for this file", {} } );
+		} else if( auto lexed = getTokens( text, base ) ) {
+			tokens = lexed.claim();
+			parsed = getProgram( tokens, parseDiagnostics );
+		} else {
+			parseDiagnostics.report( lexed.getError() );
+		}
+
+		if( !parsed ) {
+			newBlocks.push_back( Block{ firstLine, lineCount, chunk, 0, 0, {}, {}, std::move( parseDiagnostics ) } );
+		} else {
+			// A declaration starts a block unless it shares a line with, or is annotated by, the one before it
+			bool annotated = false;
+			for( auto& statement : parsed->statements ) {
+				uint32_t line = lineOf( statement->nearestSpan );
+				if( newBlocks.empty() ) {
+					newBlocks.push_back( Block{ firstLine, 0, chunk, 0, 0, {}, {}, {} } );
+				} else if( !annotated && line > newBlocks.back().chunkFirstLine ) {
+					newBlocks.push_back( Block{ firstLine + line, 0, chunk, line, 0, {}, {}, {} } );
+				}
+
+				newBlocks.back().declarations++;
+				annotated = std::holds_alternative< std::unique_ptr< Annotation > >( statement->value );
+				newStatements.push_back( std::move( statement ) );
+			}
+
+			if( newBlocks.empty() ) {
+				newBlocks.push_back( Block{ firstLine, 0, chunk, 0, 0, {}, {}, {} } );
+			}
+
+			for( size_t i = 0; i != newBlocks.size(); i++ ) {
+				uint32_t next = i + 1 == newBlocks.size() ? lineCount : newBlocks[ i + 1 ].chunkFirstLine;
+				newBlocks[ i ].lineCount = next - newBlocks[ i ].chunkFirstLine;
+			}
+
+			size_t block = 0;
+			for( Token& token : tokens ) {
+				uint32_t line = lineOf( token.span );
+				while( block + 1 < newBlocks.size() && line >= newBlocks[ block + 1 ].chunkFirstLine ) {
+					block++;
+				}
+
+				if( token.type == TokenType::TOKEN_IDENTIFIER && token.value ) {
+					newBlocks[ block ].identifiers.insert( tokenKey( token ) );
+				}
+				newBlocks[ block ].tokens.push_back( std::move( token ) );
+			}
+		}
+
+		std::map< std::string, std::string > newSignatures;
+		for( const auto& statement : newStatements ) {
+			addSignatures( *statement, newSignatures );
+		}
+
+		size_t statementIndex = firstStatement - program.statements.begin();
+		program.statements.erase( firstStatement, lastStatement );
+		program.statements.insert(
+			program.statements.begin() + statementIndex,
+			std::make_move_iterator( newStatements.begin() ),
+			std::make_move_iterator( newStatements.end() )
+		);
+		std::set< std::string > oldChunks;
+		for( size_t i = firstBlock; i != lastBlock; i++ ) {
+			oldChunks.insert( blocks[ i ].chunk );
+		}
+		blocks.erase( blocks.begin() + firstBlock, blocks.begin() + lastBlock );
+		blocks.insert( blocks.begin() + firstBlock, std::make_move_iterator( newBlocks.begin() ), std::make_move_iterator( newBlocks.end() ) );
+		size_t afterNew = firstBlock + newBlocks.size();
+
+		// A chunk can be split across several blocks, and only goes once none of them are left
+		for( const Block& block : blocks ) {
+			oldChunks.erase( block.chunk );
+		}
+		for( const std::string& chunk : oldChunks ) {
+			SourceMap::removeFile( chunks[ chunk ] );
+			chunks.erase( chunk );
+		}
+
+		std::set< std::string > changed;
+		for( const auto& [ name, signature ] : oldSignatures ) {
+			auto match = newSignatures.find( name );
+			if( match == newSignatures.end() || signature.empty() || match->second != signature ) {
+				changed.insert( name );
+			}
+		}
+		for( const auto& [ name, signature ] : newSignatures ) {
+			if( !oldSignatures.count( name ) ) {
+				changed.insert( name );
+			}
+		}
+
+		// A variable, constant or type built from a changed name changes too; functions only change their bodies
+		auto mentionsChanged = [ & ]( const Block& block ) {
+			for( const std::string& name : block.identifiers ) {
+				if( changed.count( name ) ) {
+					return true;
+				}
+			}
+			return false;
+		};
+
+		for( bool spread = true; spread; ) {
+			spread = false;
+			size_t statement = 0;
+			for( size_t i = 0; i != blocks.size(); statement += blocks[ i++ ].declarations ) {
+				if( ( i >= firstBlock && i < afterNew ) || !mentionsChanged( blocks[ i ] ) ) {
+					continue;
+				}
+
+				std::map< std::string, std::string > signatures;
+				for( size_t j = statement; j != statement + blocks[ i ].declarations; j++ ) {
+					if( !std::holds_alternative< std::unique_ptr< FunctionDeclaration > >( program.statements[ j ]->value ) ) {
+						addSignatures( *program.statements[ j ], signatures );
+					}
+				}
+				for( const auto& signature : signatures ) {
+					spread = changed.insert( signature.first ).second || spread;
+				}
+			}
+		}
+
+		size_t statement = 0;
+		for( size_t i = 0; i != blocks.size(); statement += blocks[ i++ ].declarations ) {
+			if( ( i >= firstBlock && i < afterNew ) || !mentionsChanged( blocks[ i ] ) ) {
+				continue;
+			}
+
+			for( size_t j = statement; j != statement + blocks[ i ].declarations; j++ ) {
+				forEachFunction( *program.statements[ j ], [ & ]( const FunctionDeclaration& function ) {
+					dirtyBodies.insert( &function );
+				} );
+			}
+		}
+	}
+
+	void Document::check() {
+		for( const Block& block : blocks ) {
+			if( !block.parseDiagnostics.empty() ) {
+				return;
+			}
+		}
+
+		// Registering the declarations is quick, so the symbols are rebuilt from scratch on every check
+		symbols = SymbolResolver();
+		symbols.addFile( fileId );
+		checkDiagnostics = Diagnostics();
+
+		auto needsCheck = [ & ]( const FunctionDeclaration& function ) {
+			return dirtyBodies.count( &function ) || !bodyDiagnostics.count( &function );
+		};
+		GoldScorpion::check( fileId, program, symbols, checkDiagnostics, needsCheck, bodyDiagnostics );
+		dirtyBodies.clear();
+		checked = true;
+	}
+
+	std::optional< DocumentPosition > Document::locate( SourceSpan span ) const {
+		auto location = SourceMap::resolve( span );
+		if( !location ) {
+			return {};
+		}
+
+		uint32_t line = location->line - 1;
+		for( const Block& block : blocks ) {
+			if( block.chunk == location->file && line >= block.chunkFirstLine && line < block.chunkFirstLine + block.lineCount ) {
+				return DocumentPosition{ block.firstLine + line - block.chunkFirstLine, location->column - 1 };
+			}
+		}
+
+		// The end of a chunk is one past its last line, which is where a declaration left unfinished is reported
+		for( const Block& block : blocks ) {
+			if( block.chunk == location->file && block.lineCount && line == block.chunkFirstLine + block.lineCount && location->column == 1 ) {
+				uint32_t last = block.firstLine + block.lineCount - 1;
+				return DocumentPosition{ last, ( uint32_t ) lines[ last ].size() };
+			}
+		}
+
+		return {};
+	}
+
+	std::vector< DocumentDiagnostic > Document::getDiagnostics() const {
+		Diagnostics diagnostics;
+		for( const Block& block : blocks ) {
+			diagnostics.append( block.parseDiagnostics );
+		}
+
+		// Results of the last check are stale while the document does not parse
+		if( diagnostics.empty() && checked ) {
+			diagnostics.append( checkDiagnostics );
+			for( const auto& statement : program.statements ) {
+				forEachFunction( *statement, [ & ]( const FunctionDeclaration& function ) {
+					auto body = bodyDiagnostics.find( &function );
+					if( body != bodyDiagnostics.end() ) {
+						diagnostics.append( body->second );
+					}
+				} );
+			}
+		}
+
+		std::vector< DocumentDiagnostic > result;
+		for( const Error& error : diagnostics.getErrors() ) {
+			if( !error.near ) {
+				result.push_back( DocumentDiagnostic{ { { 0, 0 }, { 0, 0 } }, error.text } );
+				continue;
+			}
+
+			// An error near a declaration that has since been edited away belongs to nothing
+			if( auto position = locate( error.near ) ) {
+				DocumentPosition end = *position;
+				if( end.line < lines.size() ) {
+					end.character = lines[ end.line ].size();
+				}
+				result.push_back( DocumentDiagnostic{ { *position, end }, error.text } );
+			}
+		}
+
+		std::stable_sort( result.begin(), result.end(), []( const DocumentDiagnostic& lhs, const DocumentDiagnostic& rhs ) {
+			return std::tie( lhs.range.start.line, lhs.range.start.character ) < std::tie( rhs.range.start.line, rhs.range.start.character );
+		} );
+
+		return result;
+	}
+
+	std::optional< std::string > Document::hover( DocumentPosition position ) {
+		if( !checked ) {
+			return {};
+		}
+
+		for( const Block& block : blocks ) {
+			if( position.line < block.firstLine || position.line >= block.firstLine + block.lineCount ) {
+				continue;
+			}
+
+			for( const Token& token : block.tokens ) {
+				if( token.type != TokenType::TOKEN_IDENTIFIER || !token.value ) {
+					continue;
+				}
+
+				// A token's span ends up just past it, so the name runs back from there
+				auto end = locate( token.span );
+				const std::string& name = std::get< std::string >( *token.value );
+				if( !end || end->line != position.line || end->character < name.size() || position.character < end->character - name.size() || position.character > end->character ) {
+					continue;
+				}
+
+				Primary primary{ token };
+				SymbolTypeResult type = getType( primary, SymbolTypeSettings{ fileId, symbols } );
+				if( !type ) {
+					return {};
+				}
+
+				auto symbol = symbols.findSymbol( fileId, name );
+				if( symbol ) {
+					if( auto function = std::get_if< FunctionSymbol >( &symbol->symbol ) ) {
+						std::string signature = "function " + name + "(";
+						for( size_t i = 0; i != function->arguments.size(); i++ ) {
+							signature += std::string( i ? ", " : " " ) + function->arguments[ i ].id + " as " + getSymbolTypeId( function->arguments[ i ].type );
+						}
+						signature += function->arguments.empty() ? ")" : " )";
+						if( function->functionReturnType ) {
+							signature += " as " + getSymbolTypeId( *function->functionReturnType );
+						}
+
+						return signature;
+					}
+				}
+
+				if( symbol && std::holds_alternative< UdtSymbol >( symbol->symbol ) ) {
+					return "type " + name;
+				}
+
+				std::string keyword = symbol && std::holds_alternative< ConstantSymbol >( symbol->symbol ) ? "const " : "def ";
+				return keyword + name + " as " + getSymbolTypeId( *type );
+			}
+		}
+
+		return {};
+	}
+
+}
\ No newline at end of file
@@ -1,16 +1,40 @@
 #include "error.hpp"
-#include <exception>
+#include <algorithm>
 
 namespace GoldScorpion {
 
 	std::string Error::toString() const {
-		return near ?
-			( std::string( "At " ) + std::to_string( near->line ) + ", " + std::to_string( near->column ) + ": " + text )
+		auto location = SourceMap::resolve( near );
+		return location ?
+			( std::string( "At " ) + std::to_string( location->line ) + ", " + std::to_string( location->column ) + ": " + text )
 		  	: text;
 	}
 
-	void Error::throwException() const {
-		throw std::runtime_error( toString() );
+	void Diagnostics::report( Error error ) {
+		errors.push_back( std::move( error ) );
+	}
+
+	void Diagnostics::append( const Diagnostics& other ) {
+		errors.insert( errors.end(), other.errors.begin(), other.errors.end() );
+	}
+
+	void Diagnostics::sortByPosition() {
+		// Spans within a file are ordered by offset, so comparing ids is enough
+		std::stable_sort( errors.begin(), errors.end(), []( const Error& lhs, const Error& rhs ) {
+			if( !lhs.near || !rhs.near ) {
+				return lhs.near && !rhs.near;
+			}
+
+			return lhs.near < rhs.near;
+		} );
+	}
+
+	bool Diagnostics::empty() const {
+		return errors.empty();
+	}
+
+	const std::vector< Error >& Diagnostics::getErrors() const {
+		return errors;
 	}
 
 }
\ No newline at end of file
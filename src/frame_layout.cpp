@@ -0,0 +1,392 @@
+#include "frame_layout.hpp"
+#include "arch/m68k/md/verifier_annotation.hpp"
+#include "tree_tools.hpp"
+#include "type_tools.hpp"
+#include "variant_visitor.hpp"
+#include <algorithm>
+#include <stack>
+#include <vector>
+
+namespace GoldScorpion {
+
+	/**
+	 * A local with the program points between which it holds a value. Points are handed out in the order the
+	 * body runs, once per statement and once per reference to a local.
+	 */
+	struct FrameLocal {
+		const VarDeclaration* declaration;
+		const ForStatement* index;
+		SymbolTypeLayout layout;
+		long start;
+		long end;
+		std::vector< long > uses;
+		// Start of the innermost loop around a local declared without a value, which it has to outlive
+		std::optional< long > carriedFrom;
+	};
+
+	struct FrameLoop {
+		long start;
+		long end;
+	};
+
+	struct LivenessState {
+		std::string fileId;
+		SymbolResolver symbols;
+		std::vector< FrameLocal > locals;
+		std::vector< FrameLoop > loops;
+		// Local name to position in locals, innermost scope last
+		std::vector< std::map< std::string, size_t > > scopes;
+		long point = 0;
+		// Starts of the loops being walked, innermost last
+		std::vector< long > openLoops;
+		bool padNext = false;
+		bool failed = false;
+	};
+
+	static void walkDeclarations( const std::vector< std::unique_ptr< Declaration > >& body, LivenessState& state );
+
+	static void use( const std::string& name, LivenessState& state ) {
+		for( auto scope = state.scopes.rbegin(); scope != state.scopes.rend(); ++scope ) {
+			auto local = scope->find( name );
+			if( local != scope->end() ) {
+				FrameLocal& frameLocal = state.locals[ local->second ];
+				frameLocal.end = ++state.point;
+				frameLocal.uses.push_back( state.point );
+				return;
+			}
+		}
+
+		// Arguments, "this" and globals live outside the frame
+	}
+
+	// A field names no local, though calls and indices reached through it may use some
+	static void walkExpression( const Expression& node, LivenessState& state, bool field = false ) {
+		std::visit( overloaded {
+
+			[ &state ]( const std::unique_ptr< AssignmentExpression >& expression ) {
+				walkExpression( *expression->expression, state );
+				walkExpression( *expression->identifier, state );
+			},
+			[ &state, field ]( const std::unique_ptr< BinaryExpression >& expression ) {
+				auto op = std::get_if< Token >( &expression->op->value );
+				bool dot = op && op->type == TokenType::TOKEN_DOT;
+				walkExpression( *expression->lhsValue, state, dot && field );
+				walkExpression( *expression->rhsValue, state, dot );
+			},
+			[ &state ]( const std::unique_ptr< UnaryExpression >& expression ) {
+				walkExpression( *expression->value, state );
+			},
+			[ &state, field ]( const std::unique_ptr< CallExpression >& expression ) {
+				for( const auto& argument : expression->arguments ) {
+					walkExpression( *argument, state );
+				}
+				walkExpression( *expression->identifier, state, field );
+			},
+			[ &state, field ]( const std::unique_ptr< ArrayExpression >& expression ) {
+				for( const auto& index : expression->indices ) {
+					walkExpression( *index, state );
+				}
+				walkExpression( *expression->identifier, state, field );
+			},
+			[ &state, field ]( const std::unique_ptr< Primary >& primary ) {
+				if( auto subexpression = std::get_if< std::unique_ptr< Expression > >( &primary->value ) ) {
+					walkExpression( **subexpression, state, field );
+					return;
+				}
+
+				if( field ) {
+					return;
+				}
+
+				if( auto name = getIdentifierName( std::get< Token >( primary->value ) ) ) {
+					use( *name, state );
+				}
+			}
+
+		}, node.value );
+	}
+
+	static std::optional< SymbolType > getLocalType( const DataType& type, LivenessState& state ) {
+		SymbolType symbolType = SymbolNativeType{ type.type.type };
+		if( auto typeId = getIdentifierName( type.type ) ) {
+			symbolType = SymbolUdtType{ *typeId };
+		}
+
+		if( type.arrayDimensions.size() ) {
+			auto base = toArrayIntermediateType( symbolType );
+			if( !base ) {
+				return {};
+			}
+
+			// Dimensions were checked by the verifier, so they are known to be constant
+			std::vector< long > dimensions;
+			for( const Token& dimension : type.arrayDimensions ) {
+				Expression primary{ std::make_unique< Primary >( Primary{ dimension } ), {} };
+				std::stack< ConstantExpressionValue > stack;
+				auto value = evaluateConst( primary, ConstEvaluationSettings{ state.fileId, stack, state.symbols, dimension.span } );
+				const long* dimensionLong = value ? std::get_if< long >( &*value ) : nullptr;
+				if( !dimensionLong ) {
+					return {};
+				}
+
+				dimensions.push_back( *dimensionLong );
+			}
+
+			symbolType = makeArrayType( std::move( dimensions ), *base, state.padNext );
+		}
+
+		return symbolType;
+	}
+
+	// Arguments and locals go in the table as the verifier had them, so that expressions naming them have types
+	static void addVariable( const Token& name, const std::optional< SymbolType >& type, LivenessState& state ) {
+		auto variableName = getIdentifierName( name );
+		if( variableName && type ) {
+			state.symbols.addSymbol( state.fileId, Symbol{ VariableSymbol{ *variableName, *type }, false } );
+		}
+	}
+
+	static size_t addLocal( const Token& name, const std::optional< SymbolType >& type, const VarDeclaration* declaration, const ForStatement* index, LivenessState& state ) {
+		auto layout = type ? getTypeLayout( *type, SymbolTypeSettings{ state.fileId, state.symbols } ) : std::optional< SymbolTypeLayout >{};
+		if( !layout ) {
+			state.failed = true;
+			layout = SymbolTypeLayout{ 0, 1 };
+		}
+
+		long start = ++state.point;
+		state.locals.push_back( FrameLocal{ declaration, index, *layout, start, start, {}, {} } );
+		if( auto localName = getIdentifierName( name ) ) {
+			state.scopes.back()[ *localName ] = state.locals.size() - 1;
+		}
+		addVariable( name, type, state );
+
+		return state.locals.size() - 1;
+	}
+
+	// The index is as wide as the verifier made it, which is wide enough to hold both ends of the range
+	static std::optional< SymbolType > getIndexType( const ForStatement& node, LivenessState& state ) {
+		auto fromType = getType( *node.from, SymbolTypeSettings{ state.fileId, state.symbols } );
+		auto toType = getType( *node.to, SymbolTypeSettings{ state.fileId, state.symbols } );
+		auto fromNative = fromType ? std::get_if< SymbolNativeType >( &*fromType ) : nullptr;
+		auto toNative = toType ? std::get_if< SymbolNativeType >( &*toType ) : nullptr;
+		if( !fromNative || !toNative ) {
+			return {};
+		}
+
+		return promotePrimitiveTypes( *fromNative, *toNative );
+	}
+
+	static void walkScope( const std::vector< std::unique_ptr< Declaration > >& body, LivenessState& state ) {
+		state.scopes.emplace_back();
+		state.symbols.openScope( state.fileId );
+
+		walkDeclarations( body, state );
+
+		// A local declared without a value in a loop may be read before it is written, and so still hold the
+		// value from the previous iteration
+		state.point++;
+		for( const auto& [ name, position ] : state.scopes.back() ) {
+			FrameLocal& local = state.locals[ position ];
+			if( state.openLoops.size() && local.declaration && !local.declaration->value ) {
+				local.carriedFrom = state.openLoops.back();
+			}
+		}
+
+		state.symbols.closeScope( state.fileId );
+		state.scopes.pop_back();
+	}
+
+	static void walkLoop( const std::vector< std::unique_ptr< Declaration > >& body, const Expression* condition, LivenessState& state ) {
+		long start = ++state.point;
+		state.openLoops.push_back( start );
+
+		if( condition ) {
+			walkExpression( *condition, state );
+		}
+		walkScope( body, state );
+
+		state.openLoops.pop_back();
+		state.loops.push_back( FrameLoop{ start, ++state.point } );
+	}
+
+	static void walkStatement( const Statement& node, LivenessState& state ) {
+		std::visit( overloaded {
+
+			[ &state ]( const std::unique_ptr< ExpressionStatement >& statement ) { walkExpression( *statement->value, state ); },
+			[ &state ]( const std::unique_ptr< ForStatement >& statement ) {
+				walkExpression( *statement->from, state );
+
+				// The index holds its value for the whole loop, and the bounds are read on every iteration
+				state.scopes.emplace_back();
+				state.symbols.openScope( state.fileId );
+				size_t index = addLocal( statement->index, getIndexType( *statement, state ), nullptr, statement.get(), state );
+				long start = state.point;
+				state.openLoops.push_back( start );
+
+				walkExpression( *statement->to, state );
+				if( statement->every ) {
+					walkExpression( **statement->every, state );
+				}
+				walkScope( statement->body, state );
+
+				state.openLoops.pop_back();
+				long end = ++state.point;
+				state.loops.push_back( FrameLoop{ start, end } );
+				state.locals[ index ].end = end;
+				state.symbols.closeScope( state.fileId );
+				state.scopes.pop_back();
+			},
+			[ &state ]( const std::unique_ptr< IfStatement >& statement ) {
+				for( const auto& condition : statement->conditions ) {
+					walkExpression( *condition, state );
+				}
+				for( const auto& body : statement->bodies ) {
+					walkScope( body, state );
+				}
+			},
+			[ &state ]( const std::unique_ptr< ReturnStatement >& statement ) {
+				if( statement->expression ) {
+					walkExpression( **statement->expression, state );
+				}
+			},
+			[ &state ]( const std::unique_ptr< AsmStatement >& ) {
+				// Inline assembly may touch any local in scope
+				for( const auto& scope : state.scopes ) {
+					for( const auto& [ name, position ] : scope ) {
+						use( name, state );
+					}
+				}
+			},
+			[ &state ]( const std::unique_ptr< WhileStatement >& statement ) {
+				walkLoop( statement->body, statement->condition.get(), state );
+			}
+
+		}, node.value );
+	}
+
+	static void walkDeclaration( const Declaration& node, LivenessState& state ) {
+		bool padNext = false;
+
+		std::visit( overloaded {
+
+			[ &state, &padNext ]( const std::unique_ptr< Annotation >& annotation ) {
+				auto packages = m68k::md::getAnnotationPackageList( *annotation, m68k::md::AnnotationSettings{ state.symbols, {} } );
+				padNext = packages && m68k::md::padsArrays( *packages );
+			},
+			[ &state ]( const std::unique_ptr< VarDeclaration >& declaration ) {
+				if( declaration->value ) {
+					walkExpression( **declaration->value, state );
+				}
+
+				addLocal( declaration->variable.name, getLocalType( declaration->variable.type, state ), declaration.get(), nullptr, state );
+			},
+			[ &state ]( const std::unique_ptr< ConstDeclaration >& declaration ) {
+				// Kept in the table only so that later array dimensions can name it
+				auto name = getIdentifierName( declaration->variable.name );
+				std::stack< ConstantExpressionValue > stack;
+				auto value = evaluateConst( *declaration->value, ConstEvaluationSettings{ state.fileId, stack, state.symbols, declaration->value->nearestSpan } );
+				if( name && value && !declaration->variable.type.arrayDimensions.size() ) {
+					state.symbols.addSymbol( state.fileId, Symbol{ ConstantSymbol{ *name, SymbolNativeType{ declaration->variable.type.type.type }, *value }, false } );
+				}
+			},
+			[]( const std::unique_ptr< FunctionDeclaration >& ) {},
+			[]( const std::unique_ptr< TypeDeclaration >& ) {},
+			[]( const std::unique_ptr< ImportDeclaration >& ) {},
+			[ &state ]( const std::unique_ptr< Statement >& statement ) {
+				state.point++;
+				walkStatement( *statement, state );
+			}
+
+		}, node.value );
+
+		state.padNext = padNext;
+	}
+
+	static void walkDeclarations( const std::vector< std::unique_ptr< Declaration > >& body, LivenessState& state ) {
+		for( const auto& declaration : body ) {
+			walkDeclaration( *declaration, state );
+		}
+	}
+
+	static long alignTo( long offset, long alignment ) {
+		return ( offset + alignment - 1 ) / alignment * alignment;
+	}
+
+	std::optional< FrameLayout > layoutFrame( const std::string& fileId, const FunctionDeclaration& function, const SymbolResolver& symbols, const std::optional< std::string >& contextTypeId ) {
+		LivenessState state{ fileId, symbols.fork(), {}, {}, {}, 0, {}, false, false };
+		state.symbols.openScope( fileId );
+		for( const Parameter& argument : function.arguments ) {
+			addVariable( argument.name, getLocalType( argument.type, state ), state );
+		}
+		if( contextTypeId ) {
+			state.symbols.addSymbol( fileId, Symbol{ VariableSymbol{ "this", SymbolUdtType{ *contextTypeId } }, false } );
+		}
+		walkScope( function.body, state );
+		state.symbols.closeScope( fileId );
+		if( state.failed ) {
+			return {};
+		}
+
+		for( FrameLocal& local : state.locals ) {
+			// Whatever a local without a value holds at the end of one iteration is still there at the start
+			// of the next, so nothing else in the loop can have its bytes
+			for( const FrameLoop& loop : state.loops ) {
+				if( local.carriedFrom && *local.carriedFrom == loop.start ) {
+					local.start = loop.start;
+					local.end = std::max( local.end, loop.end );
+				}
+			}
+
+			// A local set before a loop and read inside it is needed again on the next iteration
+			for( const FrameLoop& loop : state.loops ) {
+				bool usedInLoop = std::any_of( local.uses.begin(), local.uses.end(), [ &loop ]( long point ) {
+					return point >= loop.start && point <= loop.end;
+				} );
+				if( local.start < loop.start && usedInLoop ) {
+					local.end = std::max( local.end, loop.end );
+				}
+			}
+		}
+
+		// Each local only has to fit around the ones placed before it that are live at the same time
+		FrameLayout layout{ {}, {}, 0, 0 };
+		std::vector< FrameSlot > slots;
+		for( size_t i = 0; i != state.locals.size(); i++ ) {
+			const FrameLocal& local = state.locals[ i ];
+			layout.unsharedSize = alignTo( layout.unsharedSize, local.layout.alignment ) + local.layout.size;
+
+			std::vector< FrameSlot > taken;
+			for( size_t j = 0; j != i; j++ ) {
+				const FrameLocal& other = state.locals[ j ];
+				if( other.end >= local.start && other.start <= local.end && other.layout.size ) {
+					taken.push_back( slots[ j ] );
+				}
+			}
+			std::sort( taken.begin(), taken.end(), []( const FrameSlot& lhs, const FrameSlot& rhs ) { return lhs.offset < rhs.offset; } );
+
+			long offset = 0;
+			for( const FrameSlot& slot : taken ) {
+				if( alignTo( offset, local.layout.alignment ) + local.layout.size <= slot.offset ) {
+					break;
+				}
+				offset = std::max( offset, slot.offset + slot.size );
+			}
+			offset = alignTo( offset, local.layout.alignment );
+
+			FrameSlot slot{ offset, local.layout.size };
+			slots.push_back( slot );
+			layout.size = std::max( layout.size, offset + local.layout.size );
+			if( local.declaration ) {
+				layout.locals[ local.declaration ] = slot;
+			} else {
+				layout.indices[ local.index ] = slot;
+			}
+		}
+
+		// The stack pointer has to stay even
+		layout.size = alignTo( layout.size, 2 );
+		layout.unsharedSize = alignTo( layout.unsharedSize, 2 );
+		return layout;
+	}
+
+}
\ No newline at end of file
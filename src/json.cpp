@@ -0,0 +1,327 @@
+#include "json.hpp"
+#include "variant_visitor.hpp"
+#include "utility.hpp"
+#include <sstream>
+#include <cctype>
+#include <cmath>
+
+namespace GoldScorpion::Json {
+
+	const Value* Value::get( const std::string& key ) const {
+		if( auto object = getObject() ) {
+			auto member = object->find( key );
+			if( member != object->end() ) {
+				return &member->second;
+			}
+		}
+
+		return nullptr;
+	}
+
+	std::optional< double > Value::getNumber() const {
+		if( auto number = std::get_if< double >( &value ) ) {
+			return *number;
+		}
+
+		return {};
+	}
+
+	std::optional< std::string > Value::getString() const {
+		if( auto string = std::get_if< std::string >( &value ) ) {
+			return *string;
+		}
+
+		return {};
+	}
+
+	const Array* Value::getArray() const {
+		return std::get_if< Array >( &value );
+	}
+
+	const Object* Value::getObject() const {
+		return std::get_if< Object >( &value );
+	}
+
+	bool Value::isNull() const {
+		return std::holds_alternative< std::nullptr_t >( value );
+	}
+
+	struct Reader {
+		const std::string& text;
+		size_t position = 0;
+
+		void skipWhitespace() {
+			while( position < text.size() && std::isspace( ( unsigned char ) text[ position ] ) ) {
+				position++;
+			}
+		}
+
+		bool consume( const std::string& expected ) {
+			if( text.compare( position, expected.size(), expected ) == 0 ) {
+				position += expected.size();
+				return true;
+			}
+
+			return false;
+		}
+
+		static void appendUtf8( std::string& out, unsigned int codepoint ) {
+			if( codepoint < 0x80 ) {
+				out += ( char ) codepoint;
+			} else if( codepoint < 0x800 ) {
+				out += ( char ) ( 0xC0 | ( codepoint >> 6 ) );
+				out += ( char ) ( 0x80 | ( codepoint & 0x3F ) );
+			} else if( codepoint < 0x10000 ) {
+				out += ( char ) ( 0xE0 | ( codepoint >> 12 ) );
+				out += ( char ) ( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+				out += ( char ) ( 0x80 | ( codepoint & 0x3F ) );
+			} else {
+				out += ( char ) ( 0xF0 | ( codepoint >> 18 ) );
+				out += ( char ) ( 0x80 | ( ( codepoint >> 12 ) & 0x3F ) );
+				out += ( char ) ( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+				out += ( char ) ( 0x80 | ( codepoint & 0x3F ) );
+			}
+		}
+
+		std::optional< unsigned int > readHex4() {
+			if( position + 4 > text.size() ) {
+				return {};
+			}
+
+			unsigned int result = 0;
+			for( int i = 0; i != 4; i++ ) {
+				char digit = text[ position++ ];
+				result <<= 4;
+				if( digit >= '0' && digit <= '9' ) {
+					result |= digit - '0';
+				} else if( digit >= 'a' && digit <= 'f' ) {
+					result |= digit - 'a' + 10;
+				} else if( digit >= 'A' && digit <= 'F' ) {
+					result |= digit - 'A' + 10;
+				} else {
+					return {};
+				}
+			}
+
+			return result;
+		}
+
+		std::optional< std::string > readString() {
+			if( !consume( "\"" ) ) {
+				return {};
+			}
+
+			std::string result;
+			while( position < text.size() ) {
+				char character = text[ position++ ];
+				if( character == '"' ) {
+					return result;
+				}
+
+				if( character != '\\' ) {
+					result += character;
+					continue;
+				}
+
+				if( position >= text.size() ) {
+					return {};
+				}
+
+				switch( text[ position++ ] ) {
+					case '"': result += '"'; break;
+					case '\\': result += '\\'; break;
+					case '/': result += '/'; break;
+					case 'b': result += '\b'; break;
+					case 'f': result += '\f'; break;
+					case 'n': result += '\n'; break;
+					case 'r': result += '\r'; break;
+					case 't': result += '\t'; break;
+					case 'u': {
+						auto codepoint = readHex4();
+						if( !codepoint ) {
+							return {};
+						}
+
+						// Characters outside the basic plane come as a surrogate pair
+						if( *codepoint >= 0xD800 && *codepoint < 0xDC00 && consume( "\\u" ) ) {
+							auto low = readHex4();
+							if( !low ) {
+								return {};
+							}
+
+							*codepoint = 0x10000 + ( ( *codepoint - 0xD800 ) << 10 ) + ( *low - 0xDC00 );
+						}
+
+						appendUtf8( result, *codepoint );
+						break;
+					}
+					default:
+						return {};
+				}
+			}
+
+			return {};
+		}
+
+		std::optional< Value > readValue() {
+			skipWhitespace();
+			if( position >= text.size() ) {
+				return {};
+			}
+
+			char next = text[ position ];
+			if( next == '{' ) {
+				position++;
+				Object object;
+
+				skipWhitespace();
+				if( consume( "}" ) ) {
+					return Value( std::move( object ) );
+				}
+
+				while( true ) {
+					skipWhitespace();
+					auto key = readString();
+					skipWhitespace();
+					if( !key || !consume( ":" ) ) {
+						return {};
+					}
+
+					auto member = readValue();
+					if( !member ) {
+						return {};
+					}
+					object[ *key ] = std::move( *member );
+
+					skipWhitespace();
+					if( consume( "}" ) ) {
+						return Value( std::move( object ) );
+					}
+					if( !consume( "," ) ) {
+						return {};
+					}
+				}
+			}
+
+			if( next == '[' ) {
+				position++;
+				Array array;
+
+				skipWhitespace();
+				if( consume( "]" ) ) {
+					return Value( std::move( array ) );
+				}
+
+				while( true ) {
+					auto element = readValue();
+					if( !element ) {
+						return {};
+					}
+					array.push_back( std::move( *element ) );
+
+					skipWhitespace();
+					if( consume( "]" ) ) {
+						return Value( std::move( array ) );
+					}
+					if( !consume( "," ) ) {
+						return {};
+					}
+				}
+			}
+
+			if( next == '"' ) {
+				if( auto string = readString() ) {
+					return Value( std::move( *string ) );
+				}
+
+				return {};
+			}
+
+			if( consume( "true" ) ) {
+				return Value( true );
+			}
+
+			if( consume( "false" ) ) {
+				return Value( false );
+			}
+
+			if( consume( "null" ) ) {
+				return Value();
+			}
+
+			size_t start = position;
+			while( position < text.size() && ( std::isdigit( ( unsigned char ) text[ position ] ) || std::string( "+-.eE" ).find( text[ position ] ) != std::string::npos ) ) {
+				position++;
+			}
+
+			if( start == position ) {
+				return {};
+			}
+
+			try {
+				return Value( std::stod( text.substr( start, position - start ) ) );
+			} catch( const std::exception& ) {
+				return {};
+			}
+		}
+	};
+
+	std::optional< Value > parse( const std::string& text ) {
+		Reader reader{ text };
+		auto value = reader.readValue();
+
+		reader.skipWhitespace();
+		if( reader.position != text.size() ) {
+			return {};
+		}
+
+		return value;
+	}
+
+	static void write( std::ostream& out, const Value& value ) {
+		std::visit( overloaded {
+			[ &out ]( std::nullptr_t ) { out << "null"; },
+			[ &out ]( bool boolean ) { out << ( boolean ? "true" : "false" ); },
+			[ &out ]( double number ) {
+				// Positions and ids are integers, and must be written as such
+				if( std::floor( number ) == number && std::fabs( number ) < 1e15 ) {
+					out << ( long long ) number;
+				} else {
+					out << number;
+				}
+			},
+			[ &out ]( const std::string& string ) { out << "\"" << Utility::jsonEscape( string ) << "\""; },
+			[ &out ]( const Array& array ) {
+				out << "[";
+				for( size_t i = 0; i != array.size(); i++ ) {
+					if( i ) {
+						out << ",";
+					}
+					write( out, array[ i ] );
+				}
+				out << "]";
+			},
+			[ &out ]( const Object& object ) {
+				out << "{";
+				bool first = true;
+				for( const auto& [ key, member ] : object ) {
+					if( !first ) {
+						out << ",";
+					}
+					first = false;
+
+					out << "\"" << Utility::jsonEscape( key ) << "\":";
+					write( out, member );
+				}
+				out << "}";
+			}
+		}, value.value );
+	}
+
+	std::string serialize( const Value& value ) {
+		std::ostringstream out;
+		write( out, value );
+		return out.str();
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "language_server.hpp"
+#include "document.hpp"
+#include "json.hpp"
+#include "utility.hpp"
+#include <map>
+#include <memory>
+#include <string>
+
+namespace GoldScorpion {
+
+	static const int METHOD_NOT_FOUND = -32601;
+	static const int INVALID_PARAMS = -32602;
+
+	static std::optional< Json::Value > readMessage( std::istream& input ) {
+		std::optional< size_t > contentLength;
+		std::string header;
+		while( std::getline( input, header ) ) {
+			if( !header.empty() && header.back() == '\r' ) {
+				header.pop_back();
+			}
+
+			if( header.empty() ) {
+				if( !contentLength ) {
+					continue;
+				}
+
+				std::string body( *contentLength, '\0' );
+				if( !input.read( body.data(), body.size() ) ) {
+					return {};
+				}
+
+				// A message that will not parse is skipped; the client gets no reply it could match anyway
+				if( auto message = Json::parse( body ) ) {
+					return message;
+				}
+				contentLength.reset();
+				continue;
+			}
+
+			const std::string name = "Content-Length:";
+			if( header.compare( 0, name.size(), name ) == 0 ) {
+				// Without a length the body cannot be found, so the message is skipped
+				try {
+					contentLength = std::stoul( Utility::stringTrim( header.substr( name.size() ) ) );
+				} catch( const std::exception& ) {
+					contentLength.reset();
+				}
+			}
+		}
+
+		return {};
+	}
+
+	static void writeMessage( std::ostream& output, Json::Object message ) {
+		message[ "jsonrpc" ] = "2.0";
+		std::string body = Json::serialize( message );
+		output << "Content-Length: " << body.size() << "\r\n\r\n" << body << std::flush;
+	}
+
+	static std::string uriToFileId( const std::string& uri ) {
+		const std::string scheme = "file://";
+		return uri.compare( 0, scheme.size(), scheme ) == 0 ? uri.substr( scheme.size() ) : uri;
+	}
+
+	static Json::Value toJson( DocumentPosition position ) {
+		return Json::Object{ { "line", position.line }, { "character", position.character } };
+	}
+
+	static std::optional< DocumentPosition > toPosition( const Json::Value* value ) {
+		if( value ) {
+			auto line = value->get( "line" );
+			auto character = value->get( "character" );
+			if( line && character && line->getNumber() && character->getNumber() ) {
+				return DocumentPosition{ ( uint32_t ) *line->getNumber(), ( uint32_t ) *character->getNumber() };
+			}
+		}
+
+		return {};
+	}
+
+	class LanguageServer {
+		std::ostream& output;
+		std::map< std::string, std::unique_ptr< Document > > documents;
+		bool shutdownRequested = false;
+
+		void publishDiagnostics( const std::string& uri, const Document* document ) {
+			Json::Array diagnostics;
+			if( document ) {
+				for( const DocumentDiagnostic& diagnostic : document->getDiagnostics() ) {
+					diagnostics.push_back( Json::Object{
+						{ "range", Json::Object{ { "start", toJson( diagnostic.range.start ) }, { "end", toJson( diagnostic.range.end ) } } },
+						{ "severity", 1 },
+						{ "source", "goldscorpion" },
+						{ "message", diagnostic.message }
+					} );
+				}
+			}
+
+			writeMessage( output, Json::Object{
+				{ "method", "textDocument/publishDiagnostics" },
+				{ "params", Json::Object{ { "uri", uri }, { "diagnostics", diagnostics } } }
+			} );
+		}
+
+		Document* findDocument( const Json::Value& params, std::string& uri ) {
+			auto textDocument = params.get( "textDocument" );
+			auto uriValue = textDocument ? textDocument->get( "uri" ) : nullptr;
+			if( !uriValue || !uriValue->getString() ) {
+				return nullptr;
+			}
+
+			uri = *uriValue->getString();
+			auto document = documents.find( uri );
+			return document == documents.end() ? nullptr : document->second.get();
+		}
+
+		void didOpen( const Json::Value& params ) {
+			auto textDocument = params.get( "textDocument" );
+			auto uri = textDocument ? textDocument->get( "uri" ) : nullptr;
+			auto text = textDocument ? textDocument->get( "text" ) : nullptr;
+			if( !uri || !uri->getString() || !text || !text->getString() ) {
+				return;
+			}
+
+			auto& document = documents[ *uri->getString() ];
+			document = std::make_unique< Document >( uriToFileId( *uri->getString() ), *text->getString() );
+			document->check();
+			publishDiagnostics( *uri->getString(), document.get() );
+		}
+
+		void didChange( const Json::Value& params ) {
+			std::string uri;
+			Document* document = findDocument( params, uri );
+			auto changes = params.get( "contentChanges" );
+			if( !document || !changes || !changes->getArray() ) {
+				return;
+			}
+
+			// Changes apply one after another, each against the text the previous one left
+			for( const Json::Value& change : *changes->getArray() ) {
+				auto text = change.get( "text" );
+				if( !text || !text->getString() ) {
+					continue;
+				}
+
+				std::optional< DocumentRange > range;
+				if( auto rangeValue = change.get( "range" ) ) {
+					auto start = toPosition( rangeValue->get( "start" ) );
+					auto end = toPosition( rangeValue->get( "end" ) );
+					if( start && end ) {
+						range = DocumentRange{ *start, *end };
+					}
+				}
+
+				document->edit( range, *text->getString() );
+			}
+
+			document->check();
+			publishDiagnostics( uri, document );
+		}
+
+		void didClose( const Json::Value& params ) {
+			std::string uri;
+			if( findDocument( params, uri ) ) {
+				documents.erase( uri );
+				publishDiagnostics( uri, nullptr );
+			}
+		}
+
+		Json::Value hover( const Json::Value& params ) {
+			std::string uri;
+			Document* document = findDocument( params, uri );
+			auto position = toPosition( params.get( "position" ) );
+			if( !document || !position ) {
+				return nullptr;
+			}
+
+			if( auto description = document->hover( *position ) ) {
+				return Json::Object{ { "contents", Json::Object{ { "kind", "plaintext" }, { "value", *description } } } };
+			}
+
+			return nullptr;
+		}
+
+	public:
+		LanguageServer( std::ostream& output ) : output( output ) {}
+
+		/**
+		 * Handle one message. Returns the process exit code once the client asks to exit.
+		 */
+		std::optional< int > handle( const Json::Value& message ) {
+			auto methodValue = message.get( "method" );
+			if( !methodValue || !methodValue->getString() ) {
+				// A response to something we never sent
+				return {};
+			}
+
+			std::string method = *methodValue->getString();
+			const Json::Value* id = message.get( "id" );
+			static const Json::Value noParams = Json::Object{};
+			const Json::Value* params = message.get( "params" ) ? message.get( "params" ) : &noParams;
+
+			if( method == "exit" ) {
+				return shutdownRequested ? 0 : 1;
+			}
+
+			// Notifications get no reply, even unknown ones
+			if( !id ) {
+				if( method == "textDocument/didOpen" ) {
+					didOpen( *params );
+				} else if( method == "textDocument/didChange" ) {
+					didChange( *params );
+				} else if( method == "textDocument/didClose" ) {
+					didClose( *params );
+				}
+
+				return {};
+			}
+
+			Json::Object response{ { "id", *id } };
+			if( method == "initialize" ) {
+				response[ "result" ] = Json::Object{
+					{ "capabilities", Json::Object{
+						// Incremental sync, so each edit arrives as a range and its replacement
+						{ "textDocumentSync", Json::Object{ { "openClose", true }, { "change", 2 } } },
+						{ "hoverProvider", true }
+					} },
+					{ "serverInfo", Json::Object{ { "name", "goldscorpion" } } }
+				};
+			} else if( method == "shutdown" ) {
+				shutdownRequested = true;
+				response[ "result" ] = nullptr;
+			} else if( method == "textDocument/hover" ) {
+				if( !params->getObject() ) {
+					response[ "error" ] = Json::Object{ { "code", INVALID_PARAMS }, { "message", "Expected params object" } };
+				} else {
+					response[ "result" ] = hover( *params );
+				}
+			} else {
+				response[ "error" ] = Json::Object{ { "code", METHOD_NOT_FOUND }, { "message", "Unsupported method " + method } };
+			}
+
+			writeMessage( output, response );
+			return {};
+		}
+	};
+
+	int runLanguageServer( std::istream& input, std::ostream& output ) {
+		LanguageServer server( output );
+		while( auto message = readMessage( input ) ) {
+			if( auto exitCode = server.handle( *message ) ) {
+				return *exitCode;
+			}
+		}
+
+		// The client went away without saying goodbye
+		return 1;
+	}
+
+}
\ No newline at end of file
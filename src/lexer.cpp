@@ -1,6 +1,7 @@
 #include "lexer.hpp"
 #include "variant_visitor.hpp"
 #include "error.hpp"
+#include "stats.hpp"
 #include <circular_buffer.hpp>
 #include <unordered_map>
 #include <vector>
@@ -8,10 +9,11 @@
 
 namespace GoldScorpion {
 
-	struct Line {
-		unsigned int line = 1;
-		unsigned int column = 0;
-		bool nextResets = false;
+	struct Position {
+		// Span of the first character in the file
+		SourceSpan start;
+		// Characters read so far, including the current one
+		uint32_t consumed = 0;
 	};
 
 	static const std::unordered_map< std::string, TokenType > TOKEN_MAP = {
@@ -74,7 +76,12 @@ namespace GoldScorpion {
 		{ "const", TokenType::TOKEN_CONST }
 	};
 
-	static Token interpretToken( std::string segment, const Line& line ) {
+	// Span of the character most recently read
+	static SourceSpan spanOf( const Position& position ) {
+		return position.start ? SourceSpan{ position.start.id + position.consumed - 1 } : SourceSpan{};
+	}
+
+	static Token interpretToken( std::string segment, const Position& position ) {
 		Token result;
 
 		// Otherwise we must verify token is one of the following multipart tokens
@@ -88,8 +95,7 @@ namespace GoldScorpion {
 			result.value = segment;
 		}
 
-		result.line = line.line;
-		result.column = line.column;
+		result.span = spanOf( position );
 
 		return result;
 	}
@@ -181,27 +187,16 @@ namespace GoldScorpion {
 		return TOKEN_MAP.find( component ) != TOKEN_MAP.end();
 	}
 
-	static void bookkeep( char character, Line& currentLine ) {
-		// Bookkeep line
-		if( currentLine.nextResets ) {
-			currentLine.nextResets = false;
-
-			currentLine.line++;
-			currentLine.column = 1;
-		} else {
-			currentLine.column++;
-		}
-
-		if( character == '\n' ) {
-			currentLine.nextResets = true;
-		}
+	static void bookkeep( Position& currentPosition ) {
+		// Lines and columns are worked out from the offset by the SourceMap, only when needed
+		currentPosition.consumed++;
 	}
 
-	VariantResult< std::vector< Token > > getTokens( std::string body ) {
+	Result< std::vector< Token >, Error > getTokens( std::string body, SourceSpan start ) {
 		// Append an extra character to force-flush the buffer
 		body += '\t';
 
-		Line currentLine;
+		Position currentPosition{ start };
 
 		std::vector< Token > tokens;
 
@@ -234,7 +229,7 @@ namespace GoldScorpion {
 		for( const char& character : body ) {
 
 			// New character taken, bookkeep
-			bookkeep( character, currentLine );
+			bookkeep( currentPosition );
 
 			if( bodyState ) {
 				// Body state exits when 4-item ring buffer reads "\nend" - whitespace is never added to ring buffer
@@ -251,8 +246,8 @@ namespace GoldScorpion {
 				if( sequence == "\nend" ) {
 					// Process component without the last three chars and add as text token
 					// Additionally, add the end token
-					tokens.push_back( Token{ TokenType::TOKEN_TEXT, component.substr( 0, component.size() - 3 ), currentLine.line, currentLine.column } );
-					tokens.push_back( Token{ TokenType::TOKEN_END, {}, currentLine.line, currentLine.column } );
+					tokens.push_back( Token{ TokenType::TOKEN_TEXT, component.substr( 0, component.size() - 3 ), spanOf( currentPosition ) } );
+					tokens.push_back( Token{ TokenType::TOKEN_END, {}, spanOf( currentPosition ) } );
 
 					component = "";
 					bodyState = false;
@@ -265,8 +260,8 @@ namespace GoldScorpion {
 
 				if( character == '\n' ) {
 					// Process text token and exit linestate
-					tokens.push_back( Token{ TokenType::TOKEN_TEXT, component, currentLine.line, currentLine.column } );
-					tokens.push_back( Token{ TokenType::TOKEN_NEWLINE, {}, currentLine.line, currentLine.column } );
+					tokens.push_back( Token{ TokenType::TOKEN_TEXT, component, spanOf( currentPosition ) } );
+					tokens.push_back( Token{ TokenType::TOKEN_NEWLINE, {}, spanOf( currentPosition ) } );
 
 					component = "";
 					lineState = false;
@@ -279,12 +274,12 @@ namespace GoldScorpion {
 			} else if( stringState ) {
 				// Newlines are invalid in string state
 				if( character == '\n' ) {
-					return Error{ "Unexpected newline encountered", Token{ TokenType::TOKEN_NONE, {}, currentLine.line, currentLine.column } }.toString();
+					return Result< std::vector< Token >, Error >::err( Error{ "Unexpected newline encountered", spanOf( currentPosition ) } );
 				}
 
 				if( character == '"' ) {
 					// Exit string state and append string literal token
-					tokens.push_back( Token{ TokenType::TOKEN_LITERAL_STRING, component, currentLine.line, currentLine.column } );
+					tokens.push_back( Token{ TokenType::TOKEN_LITERAL_STRING, component, spanOf( currentPosition ) } );
 
 					// Reset state
 					component = "";
@@ -308,7 +303,7 @@ namespace GoldScorpion {
 					component += character;
 					continue;
 				} else {
-					tokens.push_back( Token{ TokenType::TOKEN_LITERAL_INTEGER, std::stol( component ), currentLine.line, currentLine.column } );
+					tokens.push_back( Token{ TokenType::TOKEN_LITERAL_INTEGER, std::stol( component ), spanOf( currentPosition ) } );
 					numericState = false;
 					component = "";
 				}
@@ -319,7 +314,7 @@ namespace GoldScorpion {
 					component += character;
 					continue;
 				} else {
-					tokens.push_back( Token{ TokenType::TOKEN_LITERAL_INTEGER, std::strtol( component.c_str(), NULL, 16 ), currentLine.line, currentLine.column } );
+					tokens.push_back( Token{ TokenType::TOKEN_LITERAL_INTEGER, std::strtol( component.c_str(), NULL, 16 ), spanOf( currentPosition ) } );
 					hexaNumericState = false;
 					component = "";
 				}
@@ -331,7 +326,7 @@ namespace GoldScorpion {
 					component += character;
 					continue;
 				} else {
-					tokens.push_back( interpretToken( component, currentLine ) );
+					tokens.push_back( interpretToken( component, currentPosition ) );
 					symbolicState = false;
 					component = "";
 				}
@@ -342,7 +337,7 @@ namespace GoldScorpion {
 					component += character;
 					continue;
 				} else {
-					tokens.push_back( interpretToken( component, currentLine ) );
+					tokens.push_back( interpretToken( component, currentPosition ) );
 					alphanumericState = false;
 					component = "";
 
@@ -371,7 +366,7 @@ namespace GoldScorpion {
 						// Then eat the newline instead of adding it to the token stream
 						lineContinuation = false;
 					} else {
-						tokens.push_back( Token{ TokenType::TOKEN_NEWLINE, {}, currentLine.line, currentLine.column } );
+						tokens.push_back( Token{ TokenType::TOKEN_NEWLINE, {}, spanOf( currentPosition ) } );
 					}
 
 					continue;
@@ -411,22 +406,23 @@ namespace GoldScorpion {
 					} else if( isSingleSymbol( character ) ) {
 						// Skip symbolic state and flush immediately
 						// Fix the awful bookkeeping with this deplorable hack
-						Line copy = currentLine;
-						copy.column++;
+						Position copy = currentPosition;
+						copy.consumed++;
 						tokens.push_back( interpretToken( std::string( 1, character ), copy ) );
 						component = "";
 					} else if( isValidSymbol( character ) ){
 						symbolicState = true;
 						component += character;
 					} else {
-						return Error{ std::string( "Unexpected character: " ) + character, Token{ TokenType::TOKEN_NONE, {}, currentLine.line, currentLine.column } }.toString();
+						return Result< std::vector< Token >, Error >::err( Error{ std::string( "Unexpected character: " ) + character, spanOf( currentPosition ) } );
 					}
 				}
 			}
 		}
 
 		// Last token is always eof
-		tokens.push_back( Token{ TokenType::TOKEN_NONE, {}, currentLine.line, currentLine.column } );
-		return tokens;
+		tokens.push_back( Token{ TokenType::TOKEN_NONE, {}, spanOf( currentPosition ) } );
+		GS_COUNT_BY( TOKENS, tokens.size() );
+		return Result< std::vector< Token >, Error >::good( std::move( tokens ) );
 	}
 }
\ No newline at end of file
@@ -12,4 +12,8 @@ namespace GoldScorpion {
         std::cout << rang::fgB::green << "success: " << rang::style::reset << message << std::endl;
     }
 
+    void printInfo( const std::string& message ) {
+        std::cout << rang::fgB::cyan << "info: " << rang::style::reset << message << std::endl;
+    }
+
 }
\ No newline at end of file
@@ -1,8 +1,34 @@
 #include "log.hpp"
 #include "compiler.hpp"
 #include "utility.hpp"
+#include "time_report.hpp"
+#include "trace.hpp"
+#include "stats.hpp"
+#include "language_server.hpp"
 #include <rang.hpp>
 #include <CLI11.hpp>
+#include <filesystem>
+#include <cstdlib>
+#include <new>
+
+// Every allocation in the process is counted so that --time-report can say how many each phase made
+void* operator new( std::size_t size ) {
+	GoldScorpion::TimeReport::countAllocation();
+
+	if( void* pointer = std::malloc( size ? size : 1 ) ) {
+		return pointer;
+	}
+
+	throw std::bad_alloc();
+}
+
+void operator delete( void* pointer ) noexcept {
+	std::free( pointer );
+}
+
+void operator delete( void* pointer, std::size_t ) noexcept {
+	std::free( pointer );
+}
 
 void info() {
 	std::cout << rang::fg::yellow << "GoldScorpion " << rang::style::reset << "Embedded Software Development Kit" << std::endl;
@@ -13,26 +39,129 @@ void info() {
 	std::cout << std::endl;
 }
 
+/**
+ * A project manifest lists one entry file per line. Blank lines and lines starting with # are ignored.
+ */
+static bool readProject( const std::string& path, std::vector< std::string >& entryFiles ) {
+	auto fileResult = GoldScorpion::Utility::fileToString( path );
+	if( auto file = std::get_if< GoldScorpion::Utility::File >( &fileResult ) ) {
+		for( std::string line : GoldScorpion::Utility::split( file->contents, '\n' ) ) {
+			line = GoldScorpion::Utility::stringTrim( line );
+			if( !line.empty() && line[ 0 ] != '#' ) {
+				entryFiles.push_back( line );
+			}
+		}
+
+		return true;
+	}
+
+	GoldScorpion::printError( "could not open project " + path + ": " + std::get< std::string >( fileResult ) );
+	return false;
+}
+
 int main( int argc, char** argv ) {
-	std::string parseFilename;
-	bool printLex = false;
-	bool printAst = false;
+	// -MD, -MF and -MP are spelled the way make users expect from other compilers, which CLI11 would read as
+	// bundles of single-letter flags
+	std::vector< std::string > arguments( argv, argv + argc );
+	for( std::string& argument : arguments ) {
+		if( argument == "-MD" || argument == "-MF" || argument == "-MP" ) {
+			argument = "-" + argument;
+		}
+	}
+
+	std::vector< std::string > parseFilenames;
+	std::string projectFilename;
+	bool writeDepfile = false;
+	GoldScorpion::CompileOptions options;
+	std::string debugParse;
+	std::string timeReport;
+	std::string tracePath;
+	bool printStats = false;
+	bool languageServer = false;
 
 	CLI::App application{ "GoldScorpion Embedded SDK v0.0.1 [m68k-md]" };
 
 	application.add_flag_callback( "-i,--info", info, "Print info about this build" );
-	application.add_flag( "--debug-lex", printLex, "Print lexer output for file" );
-	application.add_flag( "--debug-parse", printAst, "Print parse tree output for file" );
-	application.add_option( "-f,--file", parseFilename, "Specify input file" );
-	application.add_option( "-o,--output", "Specify output ROM" );
+	application.add_flag( "--debug-lex", options.printLex, "Print lexer output for file" );
+	application.add_flag( "--debug-strings", options.printStrings, "Print the pooled string literals of each target as dc.b directives" );
+	application.add_option( "--debug-parse", debugParse, "Print parse tree output for file, or with \"memory\", the memory the tree holds" )
+		->expected( 0, 1 )
+		->check( CLI::IsMember( { "", "memory" } ) );
+	application.add_option( "--time-report", timeReport, "Print time and memory used by each phase of each module, as \"table\" (default) or \"json\"" )
+		->expected( 0, 1 )
+		->check( CLI::IsMember( { "", "table", "json" } ) );
+	application.add_option( "--trace", tracePath, "Write a Chrome trace-event file of each phase of each module" );
+	application.add_flag( "--stats", printStats, "Print counters from the compiler's hot paths" );
+	application.add_flag( "--ram-map", options.printRamMap, "Print where each global is placed in RAM" );
+	application.add_flag( "--static-frames", options.staticFrames, "Give functions that are never active twice at once overlaid frames at fixed addresses" );
+	application.add_option( "-f,--file", parseFilenames, "Specify input file; give several to build each as its own target" );
+	application.add_option( "-I,--include", options.searchPaths, "Add a directory to search for imports" );
+	application.add_option( "-p,--project", projectFilename, "Build every target listed in a project manifest" );
+	application.add_option( "-o,--output", options.outputPath, "Specify output ROM" );
+	application.add_flag( "--MD", writeDepfile, "Write a make dependency file listing every module each target imports" );
+	application.add_option( "--MF", options.depfilePath, "Name the dependency file written by -MD" );
+	application.add_flag( "--MP", options.depfilePhonyTargets, "Add an empty rule for each module in the dependency file" );
 	application.add_option( "-a,--assembler-path", "Specify path to target assembler" );
+	application.add_flag( "--lsp", languageServer, "Run as a language server on stdin and stdout" );
 
-	CLI11_PARSE( application, argc, argv );
+	std::vector< char* > argumentPointers;
+	for( std::string& argument : arguments ) {
+		argumentPointers.push_back( argument.data() );
+	}
+
+	CLI11_PARSE( application, ( int ) argumentPointers.size(), argumentPointers.data() );
 
-	if( parseFilename.empty() ) {
+	// Standard output belongs to the protocol from here on
+	if( languageServer ) {
+		return GoldScorpion::runLanguageServer( std::cin, std::cout );
+	}
+
+	std::vector< std::string > entryFiles;
+	for( const std::string& parseFilename : parseFilenames ) {
+		entryFiles.push_back( GoldScorpion::Utility::stringTrim( parseFilename ) );
+	}
+
+	if( !projectFilename.empty() && !readProject( projectFilename, entryFiles ) ) {
+		return 1;
+	}
+
+	if( entryFiles.empty() ) {
 		GoldScorpion::printError( "no input files" );
 		return 1;
-	} else {
-		return GoldScorpion::compile( GoldScorpion::Utility::stringTrim( parseFilename ), printLex, printAst );
 	}
+
+	bool reportTime = application.count( "--time-report" );
+	if( reportTime ) {
+		GoldScorpion::TimeReport::enable();
+	}
+
+	if( !tracePath.empty() ) {
+		GoldScorpion::Trace::enable();
+	}
+
+	if( !writeDepfile ) {
+		options.depfilePath.clear();
+	} else if( options.depfilePath.empty() ) {
+		options.depfilePath = std::filesystem::path( options.outputPath.empty() ? entryFiles.front() : options.outputPath ).replace_extension( ".d" ).string();
+	}
+
+	options.printAst = application.count( "--debug-parse" ) && debugParse.empty();
+	options.printAstMemory = debugParse == "memory";
+
+	int result = GoldScorpion::compile( entryFiles, options );
+
+	if( reportTime ) {
+		GoldScorpion::TimeReport::print( timeReport == "json" ? GoldScorpion::TimeReport::Format::JSON : GoldScorpion::TimeReport::Format::TABLE );
+	}
+
+	if( printStats ) {
+		GoldScorpion::Stats::print();
+	}
+
+	if( !tracePath.empty() && !GoldScorpion::Trace::write( tracePath ) ) {
+		GoldScorpion::printError( "could not write trace file " + tracePath );
+		return 1;
+	}
+
+	return result;
 }
\ No newline at end of file
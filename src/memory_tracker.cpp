@@ -1,5 +1,6 @@
 #include "memory_tracker.hpp"
 #include "variant_visitor.hpp"
+#include <utility>
 
 namespace GoldScorpion {
 
@@ -19,16 +20,30 @@ namespace GoldScorpion {
 		}, query );
 	}
 
+	void MemoryTracker::insertSegment( std::vector< SegmentEntry >& segment, std::unordered_map< std::string, size_t >& index, long& size, const MemoryElement& element ) {
+		if( element.id ) {
+			index.emplace( *element.id, segment.size() );
+		}
+
+		segment.push_back( SegmentEntry{ element, size } );
+		size += element.size;
+	}
+
 	void MemoryTracker::insert( MemoryElement element, bool constant ) {
 		if( constant ) {
-			textSegment.push_back( element );
+			insertSegment( textSegment, textIndex, textSize, element );
 		} else {
-			dataSegment.push_back( element );
+			insertSegment( dataSegment, dataIndex, dataSize, element );
 		}
 	}
 
 	void MemoryTracker::push( const MemoryElement& element ) {
-		stack.push_back( element );
+		if( element.id ) {
+			stackIndex[ *element.id ].push_back( stack.size() );
+		}
+
+		stack.push_back( SegmentEntry{ element, stackSize } );
+		stackSize += element.size;
 
 		// Push a pointer to this value onto the most recently opened scope
 		if( !scopes.empty() ) {
@@ -36,10 +51,24 @@ namespace GoldScorpion {
 		}
 	}
 
+	void MemoryTracker::removeStackTop() {
+		const SegmentEntry& top = stack.back();
+		if( top.value.id ) {
+			auto positions = stackIndex.find( *top.value.id );
+			positions->second.pop_back();
+			if( positions->second.empty() ) {
+				stackIndex.erase( positions );
+			}
+		}
+
+		stackSize = top.base;
+		stack.pop_back();
+	}
+
 	std::optional< MemoryElement > MemoryTracker::pop() {
 		if( !stack.empty() ) {
-			MemoryElement result = stack.back();
-			stack.pop_back();
+			MemoryElement result = stack.back().value;
+			removeStackTop();
 
 			if( !scopes.empty() ) {
 				scopes.top().stackItems--;
@@ -56,6 +85,10 @@ namespace GoldScorpion {
 		dataSegment.clear();
 		stack.clear();
 		udts.clear();
+		textIndex.clear();
+		dataIndex.clear();
+		stackIndex.clear();
+		textSize = dataSize = stackSize = 0;
 		while( !scopes.empty() ) {
 			scopes.pop();
 		}
@@ -71,9 +104,9 @@ namespace GoldScorpion {
 		if( !scopes.empty() ) {
 			long offset = 0;
 			for( long i = 0; i != scopes.top().stackItems; i++ ) {
-				elements.push_back( StackMemoryElement{ stack.back(), offset } );
-				offset += stack.back().size;
-				stack.pop_back();
+				elements.push_back( StackMemoryElement{ stack.back().value, offset } );
+				offset += stack.back().value.size;
+				removeStackTop();
 			}
 
 			for( long i = 0; i != scopes.top().udtItems; i++ ) {
@@ -89,25 +122,17 @@ namespace GoldScorpion {
 	std::optional< MemoryQuery > MemoryTracker::find( const std::string& id, bool currentScope ) const {
 		// When asked to find an elment, find from innermost scope to outermost scope
 
-		// Step 1: Stack, from top down
-		long offset = 0;
-		long scopeCount = 0;
-		for( auto entry = stack.crbegin(); entry != stack.crend(); ++entry ) {
-			if( currentScope ) {
-				if( !scopes.empty() && scopeCount < scopes.top().stackItems ) {
-					scopeCount++;
-				} else {
-					break;
-				}
-			}
-
-			if( entry->id && *entry->id == id ) {
+		// Step 1: Stack, where offsets count down from the top of the frame
+		auto stackPositions = stackIndex.find( id );
+		if( stackPositions != stackIndex.end() ) {
+			size_t position = stackPositions->second.back();
+			bool inScope = !currentScope || ( !scopes.empty() && position + scopes.top().stackItems >= stack.size() );
+			if( inScope ) {
+				const SegmentEntry& entry = stack[ position ];
 				return StackMemoryElement {
-					*entry,
-					offset
+					entry.value,
+					stackSize - entry.base - entry.value.size
 				};
-			} else {
-				offset += entry->size;
 			}
 		}
 
@@ -118,44 +143,50 @@ namespace GoldScorpion {
 
 		// The variable wasn't found on the stack
 		// Step 2: Search the application data segment
-		offset = 0;
-		for( const auto& entry : dataSegment ) {
-			if( entry.id && *entry.id == id ) {
-				return GlobalMemoryElement {
-					entry,
-					offset
-				};
-			} else {
-				offset += entry.size;
-			}
+		auto dataPosition = dataIndex.find( id );
+		if( dataPosition != dataIndex.end() ) {
+			const SegmentEntry& entry = dataSegment[ dataPosition->second ];
+			return GlobalMemoryElement {
+				entry.value,
+				entry.base
+			};
 		}
 
 		// The variable wasn't found in the data segment
 		// Step 3: Search the application's read-only text segment
-		offset = 0;
-		for( const auto& entry : textSegment ) {
-			if( entry.id && *entry.id == id ) {
-				return ConstMemoryElement {
-					entry,
-					offset
-				};
-			} else {
-				offset += entry.size;
-			}
+		auto textPosition = textIndex.find( id );
+		if( textPosition != textIndex.end() ) {
+			const SegmentEntry& entry = textSegment[ textPosition->second ];
+			return ConstMemoryElement {
+				entry.value,
+				entry.base
+			};
 		}
 
 		// No result
 		return {};
 	}
 
+	long MemoryTracker::getFrameSize() const {
+		return stackSize;
+	}
+
 	void MemoryTracker::addUdt( const UserDefinedType& udt ) {
 		udts.push_back( udt );
+
+		// Index whatever fields the type arrived with
+		UserDefinedType& added = udts.back();
+		added.fieldIndex.clear();
+		for( size_t i = 0; i != added.fields.size(); i++ ) {
+			added.fieldIndex[ added.fields[ i ].id ] = i;
+		}
+
 		if( !scopes.empty() ) {
 			scopes.top().udtItems++;
 		}
 	}
 
-	std::optional< UserDefinedType > MemoryTracker::findUdt( const std::string& id, bool currentScope ) const {
+	const UserDefinedType* MemoryTracker::getUdt( const std::string& id, bool currentScope ) const {
 		long scopeCount = 0;
 		for( const auto& udt : udts ) {
 			if( currentScope ) {
@@ -167,38 +198,37 @@ namespace GoldScorpion {
 			}
 
 			if( udt.id == id ) {
-				return udt;
+				return &udt;
 			}
 		}
 
+		return nullptr;
+	}
+
+	UserDefinedType* MemoryTracker::getUdt( const std::string& id, bool currentScope ) {
+		return const_cast< UserDefinedType* >( std::as_const( *this ).getUdt( id, currentScope ) );
+	}
+
+	std::optional< UserDefinedType > MemoryTracker::findUdt( const std::string& id, bool currentScope ) const {
+		if( auto udt = getUdt( id, currentScope ) ) {
+			return *udt;
+		}
+
 		return {};
 	}
 
 	void MemoryTracker::addUdtField( const std::string& id, const UdtField& field, bool currentScope ) {
-		long scopeCount = 0;
-		for( auto& udt : udts ) {
-			if( currentScope ) {
-				if( !scopes.empty() && scopeCount < scopes.top().udtItems ) {
-					scopeCount++;
-				} else {
-					break;
-				}
-			}
-
-			if( udt.id == id ) {
-				udt.fields.push_back( field );
-			}
+		if( auto udt = getUdt( id, currentScope ) ) {
+			udt->fieldIndex[ field.id ] = udt->fields.size();
+			udt->fields.push_back( field );
 		}
 	}
 
 	std::optional< UdtField > MemoryTracker::findUdtField( const std::string& id, const std::string& fieldId, bool currentScope ) const {
-		auto udt = findUdt( id, currentScope );
-
-		if( udt ) {
-			for( const auto& udtField : udt->fields ) {
-				if( udtField.id == fieldId ) {
-					return udtField;
-				}
+		if( auto udt = getUdt( id, currentScope ) ) {
+			auto index = udt->fieldIndex.find( fieldId );
+			if( index != udt->fieldIndex.end() ) {
+				return udt->fields[ index->second ];
 			}
 		}
 
@@ -0,0 +1,53 @@
+#include "module_resolver.hpp"
+#include <filesystem>
+
+namespace GoldScorpion {
+
+	ModuleResolver::ModuleResolver( const SourceProvider& sources, std::vector< std::string > searchPaths ) :
+		sources( sources ), searchPaths( std::move( searchPaths ) ) {}
+
+	ModuleId ModuleResolver::resolve( const std::string& importPath ) {
+		if( auto cached = byImportPath.find( importPath ); cached != byImportPath.end() ) {
+			return cached->second;
+		}
+
+		std::vector< std::string > candidates{ importPath };
+		if( std::filesystem::path( importPath ).is_relative() ) {
+			for( const std::string& searchPath : searchPaths ) {
+				candidates.push_back( ( std::filesystem::path( searchPath ) / importPath ).string() );
+			}
+		}
+
+		// A file that can't be found keeps the path as written, so reading it fails with the usual error
+		std::string key = std::filesystem::path( importPath ).lexically_normal().string();
+		std::string name = importPath;
+		for( const std::string& candidate : candidates ) {
+			if( auto identity = sources.identify( candidate ) ) {
+				key = *identity;
+				name = candidate;
+				break;
+			}
+		}
+
+		auto [ existing, added ] = byCanonicalPath.emplace( key, ( ModuleId ) names.size() );
+		if( added ) {
+			names.push_back( name );
+		}
+
+		byImportPath.emplace( importPath, existing->second );
+		return existing->second;
+	}
+
+	const std::string& ModuleResolver::getName( ModuleId id ) const {
+		return names[ id ];
+	}
+
+	std::string ModuleResolver::resolveName( const std::string& importPath ) {
+		return getName( resolve( importPath ) );
+	}
+
+	void ModuleResolver::forgetImportPaths() {
+		byImportPath.clear();
+	}
+
+}
\ No newline at end of file
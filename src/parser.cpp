@@ -3,20 +3,63 @@
 #include "variant_visitor.hpp"
 #include "ast.hpp"
 #include "error.hpp"
-#include <exception>
+#include "stats.hpp"
 #include <optional>
 #include <queue>
 
 namespace GoldScorpion {
 
 	// File-scope vars
-	static std::vector< Token >::iterator end;
+	// Thread-local so that separate modules can be parsed at the same time
+	static thread_local std::vector< Token >::iterator end;
+	static thread_local Diagnostics* currentDiagnostics;
+	// Set by the first error; everything that follows unwinds by returning empty results until getDeclaration recovers
+	static thread_local bool failed;
+	// Where the error that set "failed" was found, so recovery can resume past it
+	static thread_local std::vector< Token >::iterator failedAt;
+	static thread_local size_t errorCount;
+	// Set by recovery from an error and cleared by the next declaration to parse, so that stray tokens in between are
+	// taken as fallout from that error
+	static thread_local bool recovering;
 
 	// Forward declarations
 	static AstResult< Expression > getExpression( std::vector< Token >::iterator current );
-	static AstResult< Declaration > getDeclaration( std::vector< Token >::iterator current );
+	static AstResult< Declaration > getDeclaration( std::vector< Token >::iterator& current );
 	// End forward declarations
 
+	// Which --stats counter an allocation of each AST node kind goes to
+	template< typename NodeType > constexpr Stats::Counter nodeCounter = Stats::Counter::COUNT;
+	template<> constexpr Stats::Counter nodeCounter< Primary > = Stats::Counter::AST_PRIMARY;
+	template<> constexpr Stats::Counter nodeCounter< CallExpression > = Stats::Counter::AST_CALL_EXPRESSION;
+	template<> constexpr Stats::Counter nodeCounter< ArrayExpression > = Stats::Counter::AST_ARRAY_EXPRESSION;
+	template<> constexpr Stats::Counter nodeCounter< UnaryExpression > = Stats::Counter::AST_UNARY_EXPRESSION;
+	template<> constexpr Stats::Counter nodeCounter< BinaryExpression > = Stats::Counter::AST_BINARY_EXPRESSION;
+	template<> constexpr Stats::Counter nodeCounter< AssignmentExpression > = Stats::Counter::AST_ASSIGNMENT_EXPRESSION;
+	template<> constexpr Stats::Counter nodeCounter< Expression > = Stats::Counter::AST_EXPRESSION;
+	template<> constexpr Stats::Counter nodeCounter< ExpressionStatement > = Stats::Counter::AST_EXPRESSION_STATEMENT;
+	template<> constexpr Stats::Counter nodeCounter< ForStatement > = Stats::Counter::AST_FOR_STATEMENT;
+	template<> constexpr Stats::Counter nodeCounter< IfStatement > = Stats::Counter::AST_IF_STATEMENT;
+	template<> constexpr Stats::Counter nodeCounter< ReturnStatement > = Stats::Counter::AST_RETURN_STATEMENT;
+	template<> constexpr Stats::Counter nodeCounter< AsmStatement > = Stats::Counter::AST_ASM_STATEMENT;
+	template<> constexpr Stats::Counter nodeCounter< WhileStatement > = Stats::Counter::AST_WHILE_STATEMENT;
+	template<> constexpr Stats::Counter nodeCounter< Statement > = Stats::Counter::AST_STATEMENT;
+	template<> constexpr Stats::Counter nodeCounter< VarDeclaration > = Stats::Counter::AST_VAR_DECLARATION;
+	template<> constexpr Stats::Counter nodeCounter< ConstDeclaration > = Stats::Counter::AST_CONST_DECLARATION;
+	template<> constexpr Stats::Counter nodeCounter< FunctionDeclaration > = Stats::Counter::AST_FUNCTION_DECLARATION;
+	template<> constexpr Stats::Counter nodeCounter< TypeDeclaration > = Stats::Counter::AST_TYPE_DECLARATION;
+	template<> constexpr Stats::Counter nodeCounter< ImportDeclaration > = Stats::Counter::AST_IMPORT_DECLARATION;
+	template<> constexpr Stats::Counter nodeCounter< Annotation > = Stats::Counter::AST_ANNOTATION;
+	template<> constexpr Stats::Counter nodeCounter< Declaration > = Stats::Counter::AST_DECLARATION;
+
+	template< typename NodeType >
+	static std::unique_ptr< NodeType > makeNode( NodeType node ) {
+		static_assert( nodeCounter< NodeType > != Stats::Counter::COUNT, "AST node kind has no counter" );
+#ifndef GOLDSCORPION_NO_STATS
+		Stats::add( nodeCounter< NodeType >, 1 );
+#endif
+		return std::make_unique< NodeType >( std::move( node ) );
+	}
+
 	// Do not read iterator if it is past the end
 	static std::optional< Token > readToken( std::vector< Token >::iterator iterator ) {
 		if( iterator != end ) {
@@ -26,15 +69,38 @@ namespace GoldScorpion {
 		return {};
 	}
 
-	static std::vector< Token >::iterator expect( TokenType tokenType, std::vector< Token >::iterator iterator, const std::string& throwMessage ) {
+	// Span of the token at iterator, if there is one
+	static SourceSpan spanAt( std::vector< Token >::iterator iterator ) {
+		if( iterator != end ) {
+			return iterator->span;
+		}
+
+		return {};
+	}
+
+	// Report an error at the given position and return an empty result for any of the parser's node types
+	// Only the first error per declaration is reported; anything after it is fallout from the same problem
+	static std::nullopt_t fail( const std::string& message, std::vector< Token >::iterator iterator ) {
+		if( !failed ) {
+			// Recovery can come back over the tokens of the last error, which has already been reported
+			if( !errorCount || iterator != failedAt ) {
+				currentDiagnostics->report( Error{ message, spanAt( iterator ) } );
+				errorCount++;
+			}
+			failed = true;
+			failedAt = iterator;
+		}
+
+		return std::nullopt;
+	}
+
+	static std::optional< std::vector< Token >::iterator > expect( TokenType tokenType, std::vector< Token >::iterator iterator, const std::string& failMessage ) {
 		auto result = readToken( iterator );
 		if( result && result->type == tokenType ) {
 			return ++iterator;
 		}
 
-		Error{ throwMessage, readToken( iterator ) }.throwException();
-		// as good as dead code
-		throw std::runtime_error( "Internal compiler error" );
+		return fail( failMessage, iterator );
 	}
 
 	static std::optional< std::vector< Token >::iterator > attempt( TokenType tokenType, std::vector< Token >::iterator iterator ) {
@@ -62,56 +128,68 @@ namespace GoldScorpion {
 		return isNativeType( token ) || token.type == TokenType::TOKEN_IDENTIFIER;
 	}
 
+	struct DataTypeReturn {
+		DataType type;
+		std::vector< Token >::iterator nextIterator;
+	};
+	static std::optional< DataTypeReturn > getDataType( std::vector< Token >::iterator current ) {
+		// A type takes the form IDENTIFIER (of type form), optionally followed by array dimensions
+		auto typeResult = readToken( current );
+		if( !typeResult || !isType( *typeResult ) ) {
+			return {};
+		}
+		++current;
+
+		// Check if array type
+		std::vector< Token > arrayDimensions;
+		auto leftBracketResult = readToken( current );
+		if( leftBracketResult && leftBracketResult->type == TokenType::TOKEN_LEFT_BRACKET ) {
+			++current;
+
+			while( true ) {
+				auto arrayDimension = readToken( current );
+				if( arrayDimension && ( arrayDimension->type == TokenType::TOKEN_IDENTIFIER || arrayDimension->type == TokenType::TOKEN_LITERAL_INTEGER ) ) {
+					++current;
+
+					arrayDimensions.push_back( *arrayDimension );
+
+					// Keep going if there's a comma
+					if( readToken( current ) && current->type == TokenType::TOKEN_COMMA ) {
+						++current;
+					} else {
+						break;
+					}
+				} else {
+					return fail( "Expected: integer or const identifier for array size", current );
+				}
+			}
+
+			if( readToken( current ) && current->type == TokenType::TOKEN_RIGHT_BRACKET ) {
+				++current;
+			} else {
+				return fail( "Expected: closing \"]\" following an array size", current );
+			}
+		}
+
+		return DataTypeReturn{ DataType{ *typeResult, arrayDimensions }, current };
+	}
+
 	struct ParameterReturn {
 		Parameter parameter;
 		std::vector< Token >::iterator nextIterator;
 	};
 	static std::optional< ParameterReturn > getParameter( std::vector< Token >::iterator current ) {
-		// A parameter takes the form IDENTIFIER "as" IDENTIFIER (of type form)
+		// A parameter takes the form IDENTIFIER "as" type
 		auto nameResult = readToken( current );
 		if( nameResult && nameResult->type == TokenType::TOKEN_IDENTIFIER ) {
 			++current;
 			auto asResult = readToken( current );
 			if( asResult && asResult->type == TokenType::TOKEN_AS ) {
 				++current;
-				auto typeResult = readToken( current );
-				if( typeResult && isType( *typeResult ) ) {
-					++current;
-
-					// Check if array type
-					std::vector< Token > arrayDimensions;
-					auto leftBracketResult = readToken( current );
-					if( leftBracketResult && leftBracketResult->type == TokenType::TOKEN_LEFT_BRACKET ) {
-						++current;
-
-						while( true ) {
-							auto arrayDimension = readToken( current );
-							if( arrayDimension && ( arrayDimension->type == TokenType::TOKEN_IDENTIFIER || arrayDimension->type == TokenType::TOKEN_LITERAL_INTEGER ) ) {
-								++current;
-
-								arrayDimensions.push_back( *arrayDimension );
-
-								// Keep going if there's a comma
-								if( readToken( current ) && current->type == TokenType::TOKEN_COMMA ) {
-									++current;
-								} else {
-									break;
-								}
-							} else {
-								Error{ "Expected: integer or const identifier for array size", readToken( current ) }.throwException();
-							}
-						}
-
-						if( readToken( current ) && current->type == TokenType::TOKEN_RIGHT_BRACKET ) {
-							++current;
-						} else {
-							Error{ "Expected: closing \"]\" following an array size", readToken( current ) }.throwException();
-						}
-					}
-
+				if( auto typeResult = getDataType( current ) ) {
 					return ParameterReturn{
-						Parameter{ *nameResult, DataType{ *typeResult, arrayDimensions } },
-						current
+						Parameter{ *nameResult, typeResult->type },
+						typeResult->nextIterator
 					};
 				}
 			}
@@ -131,8 +209,8 @@ namespace GoldScorpion {
 				case TokenType::TOKEN_IDENTIFIER:
 					return GeneratedAstNode< Expression >{
 						++current,
-						std::make_unique< Expression >( Expression {
-							std::make_unique< Primary >( Primary { currentToken } ),
+						makeNode< Expression >( Expression {
+							makeNode< Primary >( Primary { currentToken } ),
 							{}
 						} )
 					};
@@ -145,8 +223,8 @@ namespace GoldScorpion {
 							// Eat the current param and return the expression wrapped in a primary
 							return GeneratedAstNode< Expression >{
 								++expression->nextIterator,
-								std::make_unique< Expression >( Expression {
-									std::make_unique< Primary >( Primary {
+								makeNode< Expression >( Expression {
+									makeNode< Primary >( Primary {
 										std::move( expression->node )
 									} ),
 									{}
@@ -171,22 +249,22 @@ namespace GoldScorpion {
 
 							if( currentToken.type == TokenType::TOKEN_IDENTIFIER ) {
 								// This is a BinaryExpression with super at left and IDENTIFIER at right
-								std::unique_ptr< Expression > expression = std::make_unique< Expression >( Expression {
-									std::make_unique< BinaryExpression >( BinaryExpression {
+								std::unique_ptr< Expression > expression = makeNode< Expression >( Expression {
+									makeNode< BinaryExpression >( BinaryExpression {
 
-										std::make_unique< Expression >( Expression {
-											std::make_unique< Primary >( Primary{
-												Token{ TokenType::TOKEN_SUPER, {}, 0, 0 }
+										makeNode< Expression >( Expression {
+											makeNode< Primary >( Primary{
+												Token{ TokenType::TOKEN_SUPER, {}, {} }
 											} ),
 											{}
 										} ),
 
-										std::make_unique< Primary >( Primary {
-											Token{ TokenType::TOKEN_DOT, {}, 0, 0 }
+										makeNode< Primary >( Primary {
+											Token{ TokenType::TOKEN_DOT, {}, {} }
 										} ),
 
-										std::make_unique< Expression >( Expression {
-											std::make_unique< Primary >( Primary{
+										makeNode< Expression >( Expression {
+											makeNode< Primary >( Primary{
 												currentToken
 											} ),
 											{}
@@ -238,7 +316,7 @@ namespace GoldScorpion {
 								arguments.emplace_back( std::move( expression->node ) );
 							} else {
 								// Error if an expression doesn't follow a comma
-								Error{ "Expected: Expression following a \",\"", readToken( current ) }.throwException();
+								return fail( "Expected: Expression following a \",\"", current );
 							}
 						}
 					}
@@ -249,15 +327,15 @@ namespace GoldScorpion {
 						current++;
 
 						// Assemble CallExpression from current list of arguments
-						queue.emplace( std::make_unique< Expression >( Expression {
-							std::make_unique< CallExpression >( CallExpression{
+						queue.emplace( makeNode< Expression >( Expression {
+							makeNode< CallExpression >( CallExpression{
 								nullptr,
 								std::move( arguments )
 							} ),
 							{}
 						} ) );
 					} else {
-						Error{ "Expected: closing \")\"", readToken( current ) }.throwException();
+						return fail( "Expected: closing \")\"", current );
 					}
 
 				} else if( readToken( current ) && current->type == TokenType::TOKEN_LEFT_BRACKET ) {
@@ -278,7 +356,7 @@ namespace GoldScorpion {
 								arguments.emplace_back( std::move( expression->node ) );
 							} else {
 								// Error if an expression doesn't follow a comma
-								Error{ "Expected: Expression following a \",\"", readToken( current ) }.throwException();
+								return fail( "Expected: Expression following a \",\"", current );
 							}
 						}
 					}
@@ -287,15 +365,15 @@ namespace GoldScorpion {
 						// Eat current
 						current++;
 
-						queue.emplace( std::make_unique< Expression >( Expression {
-							std::make_unique< ArrayExpression >( ArrayExpression {
+						queue.emplace( makeNode< Expression >( Expression {
+							makeNode< ArrayExpression >( ArrayExpression {
 								nullptr,
 								std::move( arguments )
 							} ),
 							{}
 						} ) );
 					} else {
-						Error{ "Expected: closing \"]\"", readToken( current ) }.throwException();
+						return fail( "Expected: closing \"]\"", current );
 					}
 
 				} else if( readToken( current ) && current->type == TokenType::TOKEN_DOT ) {
@@ -313,16 +391,16 @@ namespace GoldScorpion {
 									// Move nextExpression onto the queue
 									queue.emplace( std::move( nextExpression->node ) );
 								} else {
-									Error{ "Expected: Token of IDENTIFIER type", readToken( current ) }.throwException();
+									return fail( "Expected: Token of IDENTIFIER type", current );
 								}
 							} else {
-								Error{ "Expected: Primary of Token type", readToken( current ) }.throwException();
+								return fail( "Expected: Primary of Token type", current );
 							}
 						} else {
-							Error{ "Expected: Expression of Primary type", readToken( current ) }.throwException();
+							return fail( "Expected: Expression of Primary type", current );
 						}
 					} else {
-						Error{ "Expected: Primary following \".\"", readToken( current ) }.throwException();
+						return fail( "Expected: Primary following \".\"", current );
 					}
 				} else {
 					break;
@@ -336,36 +414,36 @@ namespace GoldScorpion {
 				// When encounering an identifier: primary = dot with lhs primary and rhs identifier
 				if( auto result = std::get_if< std::unique_ptr< CallExpression > >( &queue.front()->value ) ) {
 					(*result)->identifier = std::move( primary->node );
-					primary->node = std::make_unique< Expression >( Expression {
+					primary->node = makeNode< Expression >( Expression {
 						std::move( *result ),
 						{}
 					} );
 				} else if( auto result = std::get_if< std::unique_ptr< ArrayExpression > >( &queue.front()->value ) ) {
 					(*result)->identifier = std::move( primary->node );
-					primary->node = std::make_unique< Expression >( Expression {
+					primary->node = makeNode< Expression >( Expression {
 						std::move( *result ),
 						{}
 					} );
 				} else if( auto result = std::get_if< std::unique_ptr< Primary > >( &queue.front()->value ) ) {
-					std::unique_ptr< BinaryExpression > binary = std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< BinaryExpression > binary = makeNode< BinaryExpression >( BinaryExpression {
 						std::move( primary->node ),
 
-						std::make_unique< Primary >( Primary {
-							Token{ TokenType::TOKEN_DOT, {}, 0, 0 }
+						makeNode< Primary >( Primary {
+							Token{ TokenType::TOKEN_DOT, {}, {} }
 						} ),
 
-						std::make_unique< Expression >( Expression {
+						makeNode< Expression >( Expression {
 							std::move( *result ),
 							{}
 						} )
 					} );
 
-					primary->node = std::make_unique< Expression >( Expression {
+					primary->node = makeNode< Expression >( Expression {
 						std::move( binary ),
 						{}
 					} );
 				} else {
-					Error{ "Internal compiler error (unexpected item in call-expression queue)", readToken( current ) }.throwException();
+					return fail( "Internal compiler error (unexpected item in call-expression queue)", current );
 				}
 
 				queue.pop();
@@ -390,9 +468,9 @@ namespace GoldScorpion {
 			if( unary ) {
 				return GeneratedAstNode< Expression >{
 					unary->nextIterator,
-					std::make_unique< Expression >( Expression {
-						std::make_unique< UnaryExpression >( UnaryExpression {
-							std::make_unique< Primary >( Primary{ operatorToken } ),
+					makeNode< Expression >( Expression {
+						makeNode< UnaryExpression >( UnaryExpression {
+							makeNode< Primary >( Primary{ operatorToken } ),
 
 							std::move( unary->node )
 						} ),
@@ -400,7 +478,7 @@ namespace GoldScorpion {
 					} )
 				};
 			} else {
-				Error{ "Expected: terminal Expression following unary operator", readToken( current ) }.throwException();
+				return fail( "Expected: terminal Expression following unary operator", current );
 			}
 		} else {
 			return getCall( current );
@@ -426,11 +504,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -439,7 +517,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal Unary following operator \"*\" or \"/\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal Unary following operator \"*\" or \"/\"", current );
 				}
 			}
 
@@ -461,11 +539,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -474,7 +552,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal Factor following operator \"-\" or \"+\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal Factor following operator \"-\" or \"+\"", current );
 				}
 			}
 
@@ -498,11 +576,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -511,7 +589,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal Term following operator \">>\" or \"<<\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal Term following operator \">>\" or \"<<\"", current );
 				}
 			}
 
@@ -537,11 +615,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -550,7 +628,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal Bitwise following operator \">\", \">=\", \"<\", or \"<=\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal Bitwise following operator \">\", \">=\", \"<\", or \"<=\"", current );
 				}
 			}
 
@@ -572,11 +650,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -585,7 +663,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal Comparison following operator \"!=\" or \"==\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal Comparison following operator \"!=\" or \"==\"", current );
 				}
 			}
 
@@ -607,11 +685,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -620,7 +698,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal Equality following operator \"&\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal Equality following operator \"&\"", current );
 				}
 			}
 
@@ -642,11 +720,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -655,7 +733,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal BwAnd following operator \"^\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal BwAnd following operator \"^\"", current );
 				}
 			}
 
@@ -677,11 +755,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -690,7 +768,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal BwXor following operator \"|\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal BwXor following operator \"|\"", current );
 				}
 			}
 
@@ -712,11 +790,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -725,7 +803,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal BwOr following operator \"and\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal BwOr following operator \"and\"", current );
 				}
 			}
 
@@ -747,11 +825,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -760,7 +838,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal LogicAnd following operator \"xor\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal LogicAnd following operator \"xor\"", current );
 				}
 			}
 
@@ -782,11 +860,11 @@ namespace GoldScorpion {
 					current = next->nextIterator;
 
 					// Form BinaryExpression
-					std::unique_ptr< Expression > binaryExpression = std::make_unique< Expression >( Expression {
-						std::make_unique< BinaryExpression >( BinaryExpression {
+					std::unique_ptr< Expression > binaryExpression = makeNode< Expression >( Expression {
+						makeNode< BinaryExpression >( BinaryExpression {
 							std::move( result->node ),
 
-							std::make_unique< Primary >( Primary{ op } ),
+							makeNode< Primary >( Primary{ op } ),
 
 							std::move( next->node )
 						} ),
@@ -795,7 +873,7 @@ namespace GoldScorpion {
 
 					result->node = std::move( binaryExpression );
 				} else {
-					Error{ "Expected: terminal LogicXor following operator \"or\"", readToken( current ) }.throwException();
+					return fail( "Expected: terminal LogicXor following operator \"or\"", current );
 				}
 			}
 
@@ -819,8 +897,8 @@ namespace GoldScorpion {
 						// Everything we need
 						return GeneratedAstNode< Expression >{
 							rhs->nextIterator,
-							std::make_unique< Expression >( Expression {
-								std::make_unique< AssignmentExpression >( AssignmentExpression{
+							makeNode< Expression >( Expression {
+								makeNode< AssignmentExpression >( AssignmentExpression{
 									std::move( lhs->node ),
 
 									std::move( rhs->node )
@@ -830,7 +908,7 @@ namespace GoldScorpion {
 						};
 					} else {
 						// If you specify an equals then there must be a successive expression
-						Error{ "Expected: Expression following \"=\" token", readToken( current ) }.throwException();
+						return fail( "Expected: Expression following \"=\" token", current );
 					}
 				}
 			}
@@ -841,12 +919,12 @@ namespace GoldScorpion {
 	}
 
 	static AstResult< Expression > getExpression( std::vector< Token >::iterator current ) {
-		std::optional< Token > nearest = readToken( current );
+		SourceSpan nearest = spanAt( current );
 
 		AstResult< Expression > result = getAssignment( current );
 
 		if( result ) {
-			result->node->nearestToken = nearest;
+			result->node->nearestSpan = nearest;
 		}
 
 		return result;
@@ -857,12 +935,12 @@ namespace GoldScorpion {
 		if( expressionResult ) {
 			current = expressionResult->nextIterator;
 
-			// Validate return with a newline
+			// Validate return with a newline, or the end of the file
 			if( auto result = readToken( current ) ) {
-				if( result->type == TokenType::TOKEN_NEWLINE ) {
+				if( result->type == TokenType::TOKEN_NEWLINE || result->type == TokenType::TOKEN_NONE ) {
 					return GeneratedAstNode< ExpressionStatement >{
-						++current,
-						std::make_unique< ExpressionStatement >( ExpressionStatement{
+						result->type == TokenType::TOKEN_NEWLINE ? ++current : current,
+						makeNode< ExpressionStatement >( ExpressionStatement{
 							std::move( expressionResult->node )
 						} )
 					};
@@ -902,7 +980,7 @@ namespace GoldScorpion {
 										current = everyExpression->nextIterator;
 										every = std::move( everyExpression->node );
 									} else {
-										Error{ "Expected: expression following \"every\" token", readToken( current ) }.throwException();
+										return fail( "Expected: expression following \"every\" token", current );
 									}
 								}
 
@@ -919,7 +997,7 @@ namespace GoldScorpion {
 									if( readToken( current ) && current->type == TokenType::TOKEN_END ) {
 										return GeneratedAstNode< ForStatement >{
 											++current,
-											std::make_unique< ForStatement >( ForStatement{
+											makeNode< ForStatement >( ForStatement{
 												*indexResult,
 												std::move( fromExpression->node ),
 												std::move( toExpression->node ),
@@ -928,26 +1006,26 @@ namespace GoldScorpion {
 											} )
 										};
 									} else {
-										Error{ "Expected: \"end\" token following ForStatement", readToken( current ) }.throwException();
+										return fail( "Expected: \"end\" token following ForStatement", current );
 									}
 								} else {
-									Error{ "Expected: newline following ForStatement header", readToken( current ) }.throwException();
+									return fail( "Expected: newline following ForStatement header", current );
 								}
 
 							} else {
-								Error{ "Expected: expression following \"to\" token", readToken( current ) }.throwException();
+								return fail( "Expected: expression following \"to\" token", current );
 							}
 						} else {
-							Error{ "Expected: \"to\" following expression", readToken( current ) }.throwException();
+							return fail( "Expected: \"to\" following expression", current );
 						}
 					} else {
-						Error{ "Expected: expression following \"=\" token", readToken( current ) }.throwException();
+						return fail( "Expected: expression following \"=\" token", current );
 					}
 				} else {
-					Error{ "Expected: \"=\" following identifier", readToken( current ) }.throwException();
+					return fail( "Expected: \"=\" following identifier", current );
 				}
 			} else {
-				Error{ "Expected: identifier following \"for\" token", readToken( current ) }.throwException();
+				return fail( "Expected: identifier following \"for\" token", current );
 			}
 		}
 
@@ -962,7 +1040,11 @@ namespace GoldScorpion {
 			std::vector< std::vector< std::unique_ptr< Declaration > > > bodies;
 
 			if( AstResult< Expression > baseCondition = getExpression( current ) ) {
-				current = expect( TokenType::TOKEN_THEN, baseCondition->nextIterator, "Expected: \"then\" following if conditional" );
+				if( auto next = expect( TokenType::TOKEN_THEN, baseCondition->nextIterator, "Expected: \"then\" following if conditional" ) ) {
+					current = *next;
+				} else {
+					return {};
+				}
 				conditions.emplace_back( std::move( baseCondition->node ) );
 
 				// Zero or more declarations following "then"
@@ -982,7 +1064,11 @@ namespace GoldScorpion {
 							current = *afterNextIf;
 
 							if( AstResult< Expression > elifCondition = getExpression( current ) ) {
-								current = expect( TokenType::TOKEN_THEN, elifCondition->nextIterator, "Expected: \"then\" following else if expression" );
+								if( auto next = expect( TokenType::TOKEN_THEN, elifCondition->nextIterator, "Expected: \"then\" following else if expression" ) ) {
+									current = *next;
+								} else {
+									return {};
+								}
 								conditions.emplace_back( std::move( elifCondition->node ) );
 
 								// Zero or more declarations following "then"
@@ -995,7 +1081,7 @@ namespace GoldScorpion {
 
 								continue;
 							} else {
-								Error{ "Expected: Expression following \"else\" \"if\" sequence", readToken( current ) }.throwException();
+								return fail( "Expected: Expression following \"else\" \"if\" sequence", current );
 							}
 						}
 					}
@@ -1016,12 +1102,14 @@ namespace GoldScorpion {
 				}
 
 				// Finally a closing end
-				return GeneratedAstNode< IfStatement >{
-					expect( TokenType::TOKEN_END, current, "Expected: \"end\" token following IfStatement" ),
-					std::make_unique< IfStatement >( IfStatement{ std::move( conditions ), std::move( bodies ) } )
-				};
+				if( auto next = expect( TokenType::TOKEN_END, current, "Expected: \"end\" token following IfStatement" ) ) {
+					return GeneratedAstNode< IfStatement >{
+						*next,
+						makeNode< IfStatement >( IfStatement{ std::move( conditions ), std::move( bodies ) } )
+					};
+				}
 			} else {
-				Error{ "Expected: Expression following \"if\"", readToken( current ) }.throwException();
+				return fail( "Expected: Expression following \"if\"", current );
 			}
 		}
 
@@ -1039,12 +1127,14 @@ namespace GoldScorpion {
 				returnExpression = std::move( expression->node );
 			}
 
-			return GeneratedAstNode< ReturnStatement >{
-				expect( TokenType::TOKEN_NEWLINE, current, "Expected: newline after ReturnStatement" ),
-				std::make_unique< ReturnStatement >( ReturnStatement{
-					std::move( returnExpression )
-				} )
-			};
+			if( auto next = expect( TokenType::TOKEN_NEWLINE, current, "Expected: newline after ReturnStatement" ) ) {
+				return GeneratedAstNode< ReturnStatement >{
+					*next,
+					makeNode< ReturnStatement >( ReturnStatement{
+						std::move( returnExpression )
+					} )
+				};
+			}
 		}
 
 		return {};
@@ -1057,14 +1147,20 @@ namespace GoldScorpion {
 
 			auto potentialText = readToken( current );
 			if( potentialText && potentialText->type == TokenType::TOKEN_TEXT ) {
-				current = expect( TokenType::TOKEN_END, ++current, "Expected: \"end\" token following AsmStatement body" );
+				if( auto next = expect( TokenType::TOKEN_END, ++current, "Expected: \"end\" token following AsmStatement body" ) ) {
+					current = *next;
+				} else {
+					return {};
+				}
 
-				return GeneratedAstNode< AsmStatement >{
-					expect( TokenType::TOKEN_NEWLINE, current, "Expected: newline following AsmStatement" ),
-					std::make_unique< AsmStatement >( AsmStatement { *potentialText } )
-				};
+				if( auto next = expect( TokenType::TOKEN_NEWLINE, current, "Expected: newline following AsmStatement" ) ) {
+					return GeneratedAstNode< AsmStatement >{
+						*next,
+						makeNode< AsmStatement >( AsmStatement { *potentialText } )
+					};
+				}
 			} else {
-				Error{ "Expected: inline asm body following \"asm\" token", readToken( current ) }.throwException();
+				return fail( "Expected: inline asm body following \"asm\" token", current );
 			}
 		}
 
@@ -1077,7 +1173,11 @@ namespace GoldScorpion {
 			current = *afterWhile;
 
 			if( AstResult< Expression > expression = getExpression( current ) ) {
-				current = expect( TokenType::TOKEN_NEWLINE, expression->nextIterator, "Expected: newline following Expression" );
+				if( auto next = expect( TokenType::TOKEN_NEWLINE, expression->nextIterator, "Expected: newline following Expression" ) ) {
+					current = *next;
+				} else {
+					return {};
+				}
 
 				std::vector< std::unique_ptr< Declaration > > body;
 				while( AstResult< Declaration > declaration = getDeclaration( current ) ) {
@@ -1085,12 +1185,14 @@ namespace GoldScorpion {
 					body.emplace_back( std::move( declaration->node ) );
 				}
 
-				return GeneratedAstNode< WhileStatement >{
-					expect( TokenType::TOKEN_END, current, "Expected: \"end\" token following WhileStatement body" ),
-					std::make_unique< WhileStatement >( WhileStatement{ std::move( expression->node ), std::move( body ) } )
-				};
+				if( auto next = expect( TokenType::TOKEN_END, current, "Expected: \"end\" token following WhileStatement body" ) ) {
+					return GeneratedAstNode< WhileStatement >{
+						*next,
+						makeNode< WhileStatement >( WhileStatement{ std::move( expression->node ), std::move( body ) } )
+					};
+				}
 			} else {
-				Error{ "Expected: Expression following \"while\" token", readToken( current ) }.throwException();
+				return fail( "Expected: Expression following \"while\" token", current );
 			}
 		}
 
@@ -1098,12 +1200,12 @@ namespace GoldScorpion {
 	}
 
 	static AstResult< Statement > getStatement( std::vector< Token >::iterator current ) {
-		std::optional< Token > nearest = readToken( current );
+		SourceSpan nearest = spanAt( current );
 
 		if( AstResult< ExpressionStatement > expressionStatementResult = getExpressionStatement( current ) ) {
 			return GeneratedAstNode< Statement >{
 				expressionStatementResult->nextIterator,
-				std::make_unique< Statement >( Statement{
+				makeNode< Statement >( Statement{
 					std::move( expressionStatementResult->node ),
 					nearest
 				} )
@@ -1113,7 +1215,7 @@ namespace GoldScorpion {
 		if( AstResult< ForStatement > forStatementResult = getForStatement( current ) ) {
 			return GeneratedAstNode< Statement >{
 				forStatementResult->nextIterator,
-				std::make_unique< Statement >( Statement {
+				makeNode< Statement >( Statement {
 					std::move( forStatementResult->node ),
 					nearest
 				} )
@@ -1123,7 +1225,7 @@ namespace GoldScorpion {
 		if( AstResult< IfStatement > ifStatementResult = getIfStatement( current ) ) {
 			return GeneratedAstNode< Statement >{
 				ifStatementResult->nextIterator,
-				std::make_unique< Statement >( Statement {
+				makeNode< Statement >( Statement {
 					std::move( ifStatementResult->node ),
 					nearest
 				} )
@@ -1133,7 +1235,7 @@ namespace GoldScorpion {
 		if( AstResult< ReturnStatement > returnStatementResult = getReturnStatement( current ) ) {
 			return GeneratedAstNode< Statement >{
 				returnStatementResult->nextIterator,
-				std::make_unique< Statement >( Statement {
+				makeNode< Statement >( Statement {
 					std::move( returnStatementResult->node ),
 					nearest
 				} )
@@ -1143,7 +1245,7 @@ namespace GoldScorpion {
 		if( AstResult< AsmStatement > asmStatementResult = getAsmStatement( current ) ) {
 			return GeneratedAstNode< Statement >{
 				asmStatementResult->nextIterator,
-				std::make_unique< Statement >( Statement {
+				makeNode< Statement >( Statement {
 					std::move( asmStatementResult->node ),
 					nearest
 				} )
@@ -1153,7 +1255,7 @@ namespace GoldScorpion {
 		if( AstResult< WhileStatement > whileStatementResult = getWhileStatement( current ) ) {
 			return GeneratedAstNode< Statement >{
 				whileStatementResult->nextIterator,
-				std::make_unique< Statement >( Statement {
+				makeNode< Statement >( Statement {
 					std::move( whileStatementResult->node ),
 					nearest
 				} )
@@ -1181,7 +1283,7 @@ namespace GoldScorpion {
 			if( leftParenResult && leftParenResult->type == TokenType::TOKEN_LEFT_PAREN ) {
 				++current;
 			} else {
-				Error{ "Expected: \"(\" token following function or function identifier", readToken( current ) }.throwException();
+				return fail( "Expected: \"(\" token following function or function identifier", current );
 			}
 
 			// Optional parameters
@@ -1197,7 +1299,7 @@ namespace GoldScorpion {
 						current = nextArgumentResult->nextIterator;
 						arguments.push_back( nextArgumentResult->parameter );
 					} else {
-						Error{ "Expected: parameter following \",\" token", readToken( current ) }.throwException();
+						return fail( "Expected: parameter following \",\" token", current );
 					}
 				}
 			}
@@ -1207,22 +1309,21 @@ namespace GoldScorpion {
 			if( rightParenResult && rightParenResult->type == TokenType::TOKEN_RIGHT_PAREN ) {
 				++current;
 			} else {
-				Error{ "Expected: \")\" token following function argument list", readToken( current ) }.throwException();
+				return fail( "Expected: \")\" token following function argument list", current );
 			}
 
 			// Optional "as" return type
-			std::optional< Token > returnType;
+			std::optional< DataType > returnType;
 			auto asResult = readToken( current );
 			if( asResult && asResult->type == TokenType::TOKEN_AS ) {
 				++current;
 
-				// Now expect identifier of type form
-				auto returnTypeResult = readToken( current );
-				if( returnTypeResult && isType( *returnTypeResult ) ) {
-					++current;
-					returnType = *returnTypeResult;
+				// Now expect identifier of type form, with array dimensions if the function returns an array
+				if( auto returnTypeResult = getDataType( current ) ) {
+					current = returnTypeResult->nextIterator;
+					returnType = returnTypeResult->type;
 				} else {
-					Error{ "Expected: identifier following \"as\" token", readToken( current ) }.throwException();
+					return fail( "Expected: identifier following \"as\" token", current );
 				}
 			}
 
@@ -1242,7 +1343,7 @@ namespace GoldScorpion {
 			if( endResult && endResult->type == TokenType::TOKEN_END ) {
 				return GeneratedAstNode< FunctionDeclaration >{
 					++current,
-					std::make_unique< FunctionDeclaration >( FunctionDeclaration{
+					makeNode< FunctionDeclaration >( FunctionDeclaration{
 						name,
 						arguments,
 						returnType,
@@ -1250,7 +1351,7 @@ namespace GoldScorpion {
 					} )
 				};
 			} else {
-				Error{ "Expected: \"end\" token following function body", readToken( current ) }.throwException();
+				return fail( "Expected: \"end\" token following function body", current );
 			}
 		}
 
@@ -1288,7 +1389,7 @@ namespace GoldScorpion {
 					}
 
 					if( fields.empty() ) {
-						Error{ "Expected: at least one field in TypeDeclaration", readToken( current ) }.throwException();
+						return fail( "Expected: at least one field in TypeDeclaration", current );
 					}
 
 					// Zero or more functions
@@ -1307,20 +1408,20 @@ namespace GoldScorpion {
 					if( endResult && endResult->type == TokenType::TOKEN_END ) {
 						return GeneratedAstNode< TypeDeclaration >{
 							++current,
-							std::make_unique< TypeDeclaration >( TypeDeclaration{
+							makeNode< TypeDeclaration >( TypeDeclaration{
 								*nameResult,
 								fields,
 								std::move( functions )
 							} )
 						};
 					} else {
-						Error{ "Expected: \"end\" token following TypeDeclaration", readToken( current ) }.throwException();
+						return fail( "Expected: \"end\" token following TypeDeclaration", current );
 					}
 				} else {
-					Error{ "Expected: newline following identifier", readToken( current ) }.throwException();
+					return fail( "Expected: newline following identifier", current );
 				}
 			} else {
-				Error{ "Expected: identifier following \"type\" token", readToken( current ) }.throwException();
+				return fail( "Expected: identifier following \"type\" token", current );
 			}
 		}
 
@@ -1347,7 +1448,7 @@ namespace GoldScorpion {
 						current = expression->nextIterator;
 						assignment = std::move( expression->node );
 					} else {
-						Error{ "Expected: Expression following \"=\" token", readToken( current ) }.throwException();
+						return fail( "Expected: Expression following \"=\" token", current );
 					}
 				}
 
@@ -1357,16 +1458,16 @@ namespace GoldScorpion {
 					// Return result
 					return GeneratedAstNode< VarDeclaration >{
 						++current,
-						std::make_unique< VarDeclaration >( VarDeclaration{
+						makeNode< VarDeclaration >( VarDeclaration{
 							parameterResult->parameter,
 							std::move( assignment )
 						} )
 					};
 				} else {
-					Error{ "Expected: newline following VarDeclaration", readToken( current ) }.throwException();
+					return fail( "Expected: newline following VarDeclaration", current );
 				}
 			} else {
-				Error{ "Expected: parameter following \"def\" token", readToken( current ) }.throwException();
+				return fail( "Expected: parameter following \"def\" token", current );
 			}
 		}
 
@@ -1380,21 +1481,27 @@ namespace GoldScorpion {
 
 			auto parameter = getParameter( current );
 			if( parameter ) {
-				current = expect( TokenType::TOKEN_EQUALS, parameter->nextIterator, "Expected: \"=\" token following parameter" );
+				if( auto next = expect( TokenType::TOKEN_EQUALS, parameter->nextIterator, "Expected: \"=\" token following parameter" ) ) {
+					current = *next;
+				} else {
+					return {};
+				}
 
 				if( AstResult< Expression > expression = getExpression( current ) ) {
-					return GeneratedAstNode< ConstDeclaration >{
-						expect( TokenType::TOKEN_NEWLINE, expression->nextIterator, "Expected: newline following ConstDeclaration" ),
-						std::make_unique< ConstDeclaration >( ConstDeclaration {
-							parameter->parameter,
-							std::move( expression->node )
-						} )
-					};
+					if( auto next = expect( TokenType::TOKEN_NEWLINE, expression->nextIterator, "Expected: newline following ConstDeclaration" ) ) {
+						return GeneratedAstNode< ConstDeclaration >{
+							*next,
+							makeNode< ConstDeclaration >( ConstDeclaration {
+								parameter->parameter,
+								std::move( expression->node )
+							} )
+						};
+					}
 				} else {
-					Error{ "Expected: Expression following \"=\" statement", readToken( current ) }.throwException();
+					return fail( "Expected: Expression following \"=\" statement", current );
 				}
 			} else {
-				Error{ "Expected: parameter after \"const\" token", readToken( current ) }.throwException();
+				return fail( "Expected: parameter after \"const\" token", current );
 			}
 		}
 
@@ -1414,15 +1521,15 @@ namespace GoldScorpion {
 				if( newlineResult && newlineResult->type == TokenType::TOKEN_NEWLINE ) {
 					return GeneratedAstNode< ImportDeclaration >{
 						++current,
-						std::make_unique< ImportDeclaration >( ImportDeclaration{
+						makeNode< ImportDeclaration >( ImportDeclaration{
 							std::get< std::string >( *literalStringResult->value )
 						} )
 					};
 				} else {
-					Error{ "Expected: newline following ImportDeclaration", readToken( current ) }.throwException();
+					return fail( "Expected: newline following ImportDeclaration", current );
 				}
 			} else {
-				Error{ "Expected: Literal string following \"import\" statement", readToken( current ) }.throwException();
+				return fail( "Expected: Literal string following \"import\" statement", current );
 			}
 		}
 
@@ -1432,7 +1539,11 @@ namespace GoldScorpion {
 	static AstResult< Annotation > getAnnotation( std::vector< Token >::iterator current ) {
 		auto afterAt = attempt( TokenType::TOKEN_AT_SYMBOL, current );
 		if( afterAt ) {
-			current = expect( TokenType::TOKEN_LEFT_BRACKET, *afterAt, "Expected: \"[\" after annotation symbol" );
+			if( auto next = expect( TokenType::TOKEN_LEFT_BRACKET, *afterAt, "Expected: \"[\" after annotation symbol" ) ) {
+				current = *next;
+			} else {
+				return {};
+			}
 
 			std::vector< std::unique_ptr< Expression > > directives;
 
@@ -1441,7 +1552,7 @@ namespace GoldScorpion {
 				current = expression->nextIterator;
 				directives.emplace_back( std::move( expression->node ) );
 			} else {
-				Error{ "Expected: expression following annotation declaration", readToken( current ) }.throwException();
+				return fail( "Expected: expression following annotation declaration", current );
 			}
 
 			// Zero or more additional expressions each following a comma
@@ -1452,131 +1563,138 @@ namespace GoldScorpion {
 					current = expression->nextIterator;
 					directives.emplace_back( std::move( expression->node ) );
 				} else {
-					Error{ "Expected: expression following \",\" token", readToken( current ) }.throwException();
+					return fail( "Expected: expression following \",\" token", current );
 				}
 			}
 
-			current = expect( TokenType::TOKEN_RIGHT_BRACKET, current, "Expected: \"]\" following expression list" );
+			if( auto next = expect( TokenType::TOKEN_RIGHT_BRACKET, current, "Expected: \"]\" following expression list" ) ) {
+				current = *next;
+			} else {
+				return {};
+			}
 
-			return GeneratedAstNode< Annotation >{
-				expect( TokenType::TOKEN_NEWLINE, current, "Expected: newline following annotation declaration" ),
-				std::make_unique< Annotation >( Annotation { std::move( directives ) } )
-			};
+			if( auto next = expect( TokenType::TOKEN_NEWLINE, current, "Expected: newline following annotation declaration" ) ) {
+				return GeneratedAstNode< Annotation >{
+					*next,
+					makeNode< Annotation >( Annotation { std::move( directives ) } )
+				};
+			}
 		}
 
 		return {};
 	}
 
-	static AstResult< Declaration > getDeclaration( std::vector< Token >::iterator current ) {
+	template< typename NodeType >
+	static AstResult< Declaration > toDeclaration( AstResult< NodeType > result, SourceSpan nearest ) {
+		if( !result ) {
+			return {};
+		}
+
+		return GeneratedAstNode< Declaration >{
+			result->nextIterator,
+			makeNode< Declaration >( Declaration{
+				std::move( result->node ),
+				nearest
+			} )
+		};
+	}
+
+	static AstResult< Declaration > getSingleDeclaration( std::vector< Token >::iterator current ) {
 		// Burn newlines before
 		while( readToken( current ) && current->type == TokenType::TOKEN_NEWLINE ) {
 			current++;
 		}
 
-		std::optional< Token > nearest = readToken( current );
-		AstResult< Declaration > result = {};
+		SourceSpan nearest = spanAt( current );
 
 		// Must return one of: annotation, typeDecl, funDecl, varDecl, constDecl, importDecl, statement
-		if( auto annotation = getAnnotation( current ) ) {
-			current = annotation->nextIterator;
-
-			result = GeneratedAstNode< Declaration >{
-				current,
-				std::make_unique< Declaration >( Declaration{
-					std::move( annotation->node ),
-					nearest
-				})
-			};
-		} else if( auto typeDecl = getTypeDeclaration( current ) ) {
-			current = typeDecl->nextIterator;
-
-			result = GeneratedAstNode< Declaration >{
-				current,
-				std::make_unique< Declaration >( Declaration{
-					std::move( typeDecl->node ),
-					nearest
-				} )
-			};
-		} else if( auto funDecl = getFunctionDeclaration( current ) ) {
-			current = funDecl->nextIterator;
-
-			result = GeneratedAstNode< Declaration > {
-				current,
-				std::make_unique< Declaration >( Declaration {
-					std::move( funDecl->node ),
-					nearest
-				} )
-			};
-		} else if( auto varDecl = getVarDeclaration( current ) ) {
-			current = varDecl->nextIterator;
-
-			result = GeneratedAstNode< Declaration > {
-				current,
-				std::make_unique< Declaration >( Declaration {
-					std::move( varDecl->node ),
-					nearest
-				} )
-			};
-		} else if( auto constDecl = getConstDeclaration( current ) ) {
-			current = constDecl->nextIterator;
+		// The leading token commits to one of them, so a broken declaration is never tried again as anything else
+		auto leading = readToken( current );
+		switch( leading ? leading->type : TokenType::TOKEN_NONE ) {
+			case TokenType::TOKEN_AT_SYMBOL:
+				return toDeclaration( getAnnotation( current ), nearest );
+			case TokenType::TOKEN_TYPE:
+				return toDeclaration( getTypeDeclaration( current ), nearest );
+			case TokenType::TOKEN_FUNCTION:
+				return toDeclaration( getFunctionDeclaration( current ), nearest );
+			case TokenType::TOKEN_DEF:
+				return toDeclaration( getVarDeclaration( current ), nearest );
+			case TokenType::TOKEN_CONST:
+				return toDeclaration( getConstDeclaration( current ), nearest );
+			case TokenType::TOKEN_IMPORT:
+				return toDeclaration( getImportDeclaration( current ), nearest );
+			default:
+				return toDeclaration( getStatement( current ), nearest );
+		}
+	}
 
-			result = GeneratedAstNode< Declaration > {
-				current,
-				std::make_unique< Declaration >( Declaration {
-					std::move( constDecl->node ),
-					nearest
-				} )
-			};
-		} else if( auto importDecl = getImportDeclaration( current ) ) {
-			current = importDecl->nextIterator;
+	// Panic mode: skip the rest of the line the error was found on. An "end" is left in place so that it can still
+	// close the block around the broken declaration.
+	static std::vector< Token >::iterator synchronise( std::vector< Token >::iterator current ) {
+		while( current != end && current->type != TokenType::TOKEN_NONE && current->type != TokenType::TOKEN_END ) {
+			if( ( current++ )->type == TokenType::TOKEN_NEWLINE ) {
+				break;
+			}
+		}
 
-			result = GeneratedAstNode< Declaration > {
-				current,
-				std::make_unique< Declaration >( Declaration {
-					std::move( importDecl->node ),
-					nearest
-				} )
-			};
-		} else if( auto statement = getStatement( current ) ) {
-			current = statement->nextIterator;
+		return current;
+	}
 
-			result = GeneratedAstNode< Declaration >{
-				current,
-				std::make_unique< Declaration >( Declaration {
-					std::move( statement->node ),
-					nearest
-				} )
-			};
+	// On error, current is moved past what recovery skipped, so that a caller with no declaration to take still
+	// carries on from there rather than parsing the broken lines again
+	static AstResult< Declaration > getDeclaration( std::vector< Token >::iterator& current ) {
+		AstResult< Declaration > result = getSingleDeclaration( current );
+
+		// On error, resume with the next line and keep going so that later errors are reported in the same pass
+		while( failed ) {
+			current = synchronise( failedAt );
+			failed = false;
+			recovering = true;
+			result = getSingleDeclaration( current );
 		}
 
-		// Burn newlines after
-		while( readToken( current ) && current->type == TokenType::TOKEN_NEWLINE ) {
-			current++;
+		if( result ) {
+			recovering = false;
 		}
 
 		return result;
 	}
 
-	VariantResult< Program > getProgram( std::vector< Token > tokens ) {
+	std::optional< Program > getProgram( std::vector< Token > tokens, Diagnostics& diagnostics ) {
 		end = tokens.end();
+		currentDiagnostics = &diagnostics;
+		failed = false;
+		errorCount = 0;
+		recovering = false;
+
+		Program program;
+
+		std::vector< Token >::iterator current = tokens.begin();
+		while( current != tokens.end() && current->type != TokenType::TOKEN_NONE ) {
+			std::vector< Token >::iterator start = current;
+			if( AstResult< Declaration > declaration = getDeclaration( current ) ) {
+				program.statements.emplace_back( std::move( declaration->node ) );
+				current = declaration->nextIterator;
+			} else if( current == start ) {
+				// Nothing starts with this token. Other than trailing newlines, while recovering from an error this is
+				// usually the "end" of a block whose header could not be parsed, so only report it outside of recovery.
+				if( current->type != TokenType::TOKEN_NEWLINE && !recovering ) {
+					fail( "Expected: Declaration or statement", current );
+					failed = false;
+				}
 
-		// Just a test for now
-		try {
-			Program program;
-
-			std::vector< Token >::iterator current = tokens.begin();
-			while( current != tokens.end() || current->type != TokenType::TOKEN_NONE ) {
-				if( AstResult< Declaration > declaration = getDeclaration( current ) ) {
-					program.statements.emplace_back( std::move( declaration->node ) );
-					current = declaration->nextIterator;
-				} else {
-					break;
+				// The rest of a run of stray tokens is part of the same error
+				if( current->type != TokenType::TOKEN_NEWLINE ) {
+					recovering = true;
 				}
+				current++;
 			}
+		}
 
-			return std::move( program );
-		} catch( std::runtime_error e ) {
-			return e.what();
+		if( errorCount ) {
+			return {};
 		}
+
+		return program;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,32 @@
+#include "phase.hpp"
+#include "trace.hpp"
+
+namespace GoldScorpion {
+
+	Phase::Phase( const std::string& module, const char* name, const std::string& detail ) :
+		timing( TimeReport::enabled() ), tracing( Trace::enabled() ), name( name ) {
+		if( timing || tracing ) {
+			this->module = module;
+		}
+
+		if( timing ) {
+			start = TimeReport::sample();
+		}
+
+		if( tracing ) {
+			this->detail = detail;
+			traceStart = Trace::now();
+		}
+	}
+
+	Phase::~Phase() {
+		if( tracing ) {
+			Trace::record( name, module, detail, traceStart, Trace::now() );
+		}
+
+		if( timing ) {
+			TimeReport::record( module, name, start, TimeReport::sample() );
+		}
+	}
+
+}
\ No newline at end of file
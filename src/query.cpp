@@ -0,0 +1,29 @@
+#include "query.hpp"
+#include <algorithm>
+
+namespace GoldScorpion::Query {
+
+	// One list of reads per query running on this thread, innermost last
+	static thread_local std::vector< std::vector< QueryKey > > frames;
+
+	void record( const QueryKey& key ) {
+		if( frames.empty() ) {
+			return;
+		}
+
+		std::vector< QueryKey >& reads = frames.back();
+		if( std::find( reads.begin(), reads.end(), key ) == reads.end() ) {
+			reads.push_back( key );
+		}
+	}
+
+	std::vector< QueryKey > collect( const std::function< void() >& body ) {
+		frames.emplace_back();
+		body();
+
+		std::vector< QueryKey > reads = std::move( frames.back() );
+		frames.pop_back();
+		return reads;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "source_map.hpp"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+
+namespace GoldScorpion::SourceMap {
+
+	struct SourceFile {
+		std::string name;
+		uint32_t base;
+		uint32_t size;
+		// Offset of the first character of each line
+		std::vector< uint32_t > lineStarts;
+	};
+
+	static std::shared_mutex filesMutex;
+	// Ordered by base
+	static std::vector< SourceFile > files;
+	// Ranges below nextBase that removed files gave back, by base, with adjacent ranges merged
+	static std::map< uint32_t, uint64_t > freeRanges;
+	// Zero is reserved for "no position"
+	static uint64_t nextBase = 1;
+
+	// One past the end is a valid position too (end of file)
+	static uint64_t rangeLength( const SourceFile& file ) {
+		return ( uint64_t ) file.size + 1;
+	}
+
+	std::optional< SourceSpan > addFile( const std::string& name, const std::string& contents ) {
+		SourceFile file{ name, 0, ( uint32_t ) contents.size(), { 0 } };
+		for( uint32_t offset = 0; offset != file.size; offset++ ) {
+			if( contents[ offset ] == '\n' ) {
+				file.lineStarts.push_back( offset + 1 );
+			}
+		}
+
+		std::unique_lock< std::shared_mutex > lock( filesMutex );
+
+		// Take the first range given back that is large enough, and only grow the space when none is
+		auto range = freeRanges.begin();
+		while( range != freeRanges.end() && range->second < rangeLength( file ) ) {
+			++range;
+		}
+
+		if( range != freeRanges.end() ) {
+			file.base = range->first;
+			if( range->second > rangeLength( file ) ) {
+				freeRanges[ range->first + rangeLength( file ) ] = range->second - rangeLength( file );
+			}
+			freeRanges.erase( range );
+		} else {
+			if( nextBase + rangeLength( file ) > UINT32_MAX ) {
+				return {};
+			}
+
+			file.base = ( uint32_t ) nextBase;
+			nextBase += rangeLength( file );
+		}
+
+		auto position = std::lower_bound( files.begin(), files.end(), file.base, []( const SourceFile& file, uint32_t id ) {
+			return file.base < id;
+		} );
+		return SourceSpan{ files.insert( position, std::move( file ) )->base };
+	}
+
+	void removeFile( SourceSpan base ) {
+		std::unique_lock< std::shared_mutex > lock( filesMutex );
+
+		auto file = std::lower_bound( files.begin(), files.end(), base.id, []( const SourceFile& file, uint32_t id ) {
+			return file.base < id;
+		} );
+		if( file == files.end() || file->base != base.id ) {
+			return;
+		}
+
+		uint64_t start = file->base;
+		uint64_t length = rangeLength( *file );
+		files.erase( file );
+
+		// Merge with the free ranges on either side, and hand the top of the space back to nextBase
+		auto next = freeRanges.find( start + length );
+		if( next != freeRanges.end() ) {
+			length += next->second;
+			freeRanges.erase( next );
+		}
+
+		auto previous = freeRanges.lower_bound( start );
+		if( previous != freeRanges.begin() ) {
+			--previous;
+			if( previous->first + previous->second == start ) {
+				start = previous->first;
+				length += previous->second;
+				freeRanges.erase( previous );
+			}
+		}
+
+		if( start + length == nextBase ) {
+			nextBase = start;
+		} else {
+			freeRanges[ start ] = length;
+		}
+	}
+
+	std::optional< SourceLocation > resolve( SourceSpan span ) {
+		if( !span ) {
+			return {};
+		}
+
+		std::shared_lock< std::shared_mutex > lock( filesMutex );
+
+		auto file = std::upper_bound( files.begin(), files.end(), span.id, []( uint32_t id, const SourceFile& file ) {
+			return id < file.base;
+		} );
+		if( file == files.begin() ) {
+			return {};
+		}
+		--file;
+
+		uint32_t offset = span.id - file->base;
+		if( offset > file->size ) {
+			return {};
+		}
+
+		auto lineStart = std::upper_bound( file->lineStarts.begin(), file->lineStarts.end(), offset ) - 1;
+		return SourceLocation{
+			file->name,
+			( unsigned int ) ( lineStart - file->lineStarts.begin() ) + 1,
+			offset - *lineStart + 1
+		};
+	}
+
+	RegisteredFile::~RegisteredFile() {
+		if( base ) {
+			removeFile( base );
+		}
+	}
+
+	RegisteredFile::RegisteredFile( RegisteredFile&& other ) noexcept : base( other.base ) {
+		other.base = SourceSpan{};
+	}
+
+	RegisteredFile& RegisteredFile::operator=( RegisteredFile&& other ) noexcept {
+		if( this != &other ) {
+			if( base ) {
+				removeFile( base );
+			}
+			base = other.base;
+			other.base = SourceSpan{};
+		}
+
+		return *this;
+	}
+
+}
\ No newline at end of file
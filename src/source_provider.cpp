@@ -0,0 +1,47 @@
+#include "source_provider.hpp"
+#include <filesystem>
+#include <system_error>
+
+namespace GoldScorpion {
+
+	std::optional< std::string > DiskSourceProvider::identify( const std::string& path ) const {
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::canonical( path, error );
+		if( error || !std::filesystem::is_regular_file( canonical, error ) ) {
+			return {};
+		}
+
+		return canonical.string();
+	}
+
+	VariantResult< Utility::File > DiskSourceProvider::read( const std::string& path ) const {
+		return Utility::fileToString( path );
+	}
+
+	static std::string normalise( const std::string& path ) {
+		return std::filesystem::path( path ).lexically_normal().string();
+	}
+
+	void MemorySourceProvider::add( const std::string& path, std::string contents ) {
+		files[ normalise( path ) ] = std::move( contents );
+	}
+
+	std::optional< std::string > MemorySourceProvider::identify( const std::string& path ) const {
+		std::string key = normalise( path );
+		if( !files.count( key ) ) {
+			return {};
+		}
+
+		return key;
+	}
+
+	VariantResult< Utility::File > MemorySourceProvider::read( const std::string& path ) const {
+		auto file = files.find( normalise( path ) );
+		if( file == files.end() ) {
+			return "Unable to open file: no source was provided for this path";
+		}
+
+		return Utility::File{ file->second };
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "stats.hpp"
+#include <set>
+#include <mutex>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+
+namespace GoldScorpion::Stats {
+
+	static const char* names[] = {
+		"tokens",
+		"ast: Primary",
+		"ast: CallExpression",
+		"ast: ArrayExpression",
+		"ast: UnaryExpression",
+		"ast: BinaryExpression",
+		"ast: AssignmentExpression",
+		"ast: Expression",
+		"ast: ExpressionStatement",
+		"ast: ForStatement",
+		"ast: IfStatement",
+		"ast: ReturnStatement",
+		"ast: AsmStatement",
+		"ast: WhileStatement",
+		"ast: Statement",
+		"ast: VarDeclaration",
+		"ast: ConstDeclaration",
+		"ast: FunctionDeclaration",
+		"ast: TypeDeclaration",
+		"ast: ImportDeclaration",
+		"ast: Annotation",
+		"ast: Declaration",
+		"getSymbol calls",
+		"getSymbol symbols scanned",
+		"getType calls",
+		"addSymbolType calls",
+		"addSymbolType types scanned",
+		"evaluateConst calls",
+		"expressions folded",
+		"frame bytes",
+		"frame bytes saved by sharing",
+		"string literal bytes",
+		"string pool bytes"
+	};
+	static_assert( sizeof( names ) / sizeof( names[ 0 ] ) == ( size_t ) Counter::COUNT, "Every counter needs a name" );
+
+	static std::mutex blocksMutex;
+	static std::set< Block* > liveBlocks;
+	static uint64_t finished[ ( size_t ) Counter::COUNT ] = {};
+
+	Block::Block() {
+		std::lock_guard< std::mutex > lock( blocksMutex );
+		liveBlocks.insert( this );
+	}
+
+	Block::~Block() {
+		std::lock_guard< std::mutex > lock( blocksMutex );
+		for( size_t i = 0; i != ( size_t ) Counter::COUNT; i++ ) {
+			finished[ i ] += values[ i ];
+		}
+		liveBlocks.erase( this );
+	}
+
+	void print() {
+#ifdef GOLDSCORPION_NO_STATS
+		std::cout << "Statistics were compiled out of this build" << std::endl;
+#else
+		uint64_t totals[ ( size_t ) Counter::COUNT ];
+		{
+			std::lock_guard< std::mutex > lock( blocksMutex );
+			for( size_t i = 0; i != ( size_t ) Counter::COUNT; i++ ) {
+				totals[ i ] = finished[ i ];
+				for( const Block* block : liveBlocks ) {
+					totals[ i ] += block->values[ i ];
+				}
+			}
+		}
+
+		auto printLine = []( const std::string& name, const std::string& value ) {
+			std::cout << std::left << std::setw( 32 ) << name << std::right << std::setw( 16 ) << value << std::endl;
+		};
+
+		uint64_t astNodes = 0;
+		for( size_t i = 0; i != ( size_t ) Counter::COUNT; i++ ) {
+			if( i >= ( size_t ) Counter::AST_PRIMARY && i <= ( size_t ) Counter::AST_DECLARATION ) {
+				astNodes += totals[ i ];
+			}
+
+			printLine( names[ i ], std::to_string( totals[ i ] ) );
+		}
+
+		// Average scan lengths are what give away quadratic behaviour
+		auto average = []( uint64_t total, uint64_t calls ) {
+			std::ostringstream out;
+			out << std::fixed << std::setprecision( 2 ) << ( calls ? ( double ) total / calls : 0.0 );
+			return out.str();
+		};
+
+		std::cout << std::endl;
+		printLine( "ast: all nodes", std::to_string( astNodes ) );
+		printLine( "getSymbol average scan", average( totals[ ( size_t ) Counter::GET_SYMBOL_SCANNED ], totals[ ( size_t ) Counter::GET_SYMBOL_CALLS ] ) );
+		printLine( "addSymbolType average scan", average( totals[ ( size_t ) Counter::ADD_SYMBOL_TYPE_SCANNED ], totals[ ( size_t ) Counter::ADD_SYMBOL_TYPE_CALLS ] ) );
+#endif
+	}
+
+}
\ No newline at end of file
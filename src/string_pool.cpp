@@ -0,0 +1,173 @@
+#include "string_pool.hpp"
+#include "variant_visitor.hpp"
+#include <algorithm>
+#include <set>
+
+namespace GoldScorpion {
+
+	struct StringSettings {
+		// In order of first appearance, so that the pool reads in source order
+		std::vector< std::string >& literals;
+		std::set< std::string >& seen;
+		long& unpooledSize;
+	};
+
+	static void findStrings( const std::vector< std::unique_ptr< Declaration > >& body, StringSettings settings );
+
+	static void findStrings( const Expression& node, StringSettings settings ) {
+		std::visit( overloaded {
+
+			[ &settings ]( const std::unique_ptr< AssignmentExpression >& expression ) {
+				findStrings( *expression->identifier, settings );
+				findStrings( *expression->expression, settings );
+			},
+			[ &settings ]( const std::unique_ptr< BinaryExpression >& expression ) {
+				findStrings( *expression->lhsValue, settings );
+				findStrings( *expression->rhsValue, settings );
+			},
+			[ &settings ]( const std::unique_ptr< UnaryExpression >& expression ) {
+				findStrings( *expression->value, settings );
+			},
+			[ &settings ]( const std::unique_ptr< CallExpression >& expression ) {
+				findStrings( *expression->identifier, settings );
+				for( const auto& argument : expression->arguments ) {
+					findStrings( *argument, settings );
+				}
+			},
+			[ &settings ]( const std::unique_ptr< ArrayExpression >& expression ) {
+				findStrings( *expression->identifier, settings );
+				for( const auto& index : expression->indices ) {
+					findStrings( *index, settings );
+				}
+			},
+			[ &settings ]( const std::unique_ptr< Primary >& primary ) {
+				if( auto subexpression = std::get_if< std::unique_ptr< Expression > >( &primary->value ) ) {
+					findStrings( **subexpression, settings );
+					return;
+				}
+
+				const Token& token = std::get< Token >( primary->value );
+				const std::string* literal = token.type == TokenType::TOKEN_LITERAL_STRING && token.value ? std::get_if< std::string >( &*token.value ) : nullptr;
+				if( !literal ) {
+					return;
+				}
+
+				settings.unpooledSize += literal->size() + 1;
+				if( settings.seen.insert( *literal ).second ) {
+					settings.literals.push_back( *literal );
+				}
+			}
+
+		}, node.value );
+	}
+
+	static void findStrings( const Statement& node, StringSettings settings ) {
+		std::visit( overloaded {
+
+			[ &settings ]( const std::unique_ptr< ExpressionStatement >& statement ) { findStrings( *statement->value, settings ); },
+			[ &settings ]( const std::unique_ptr< ForStatement >& statement ) {
+				findStrings( *statement->from, settings );
+				findStrings( *statement->to, settings );
+				if( statement->every ) {
+					findStrings( **statement->every, settings );
+				}
+				findStrings( statement->body, settings );
+			},
+			[ &settings ]( const std::unique_ptr< IfStatement >& statement ) {
+				for( const auto& condition : statement->conditions ) {
+					findStrings( *condition, settings );
+				}
+				for( const auto& body : statement->bodies ) {
+					findStrings( body, settings );
+				}
+			},
+			[ &settings ]( const std::unique_ptr< ReturnStatement >& statement ) {
+				if( statement->expression ) {
+					findStrings( **statement->expression, settings );
+				}
+			},
+			[]( const std::unique_ptr< AsmStatement >& ) {},
+			[ &settings ]( const std::unique_ptr< WhileStatement >& statement ) {
+				findStrings( *statement->condition, settings );
+				findStrings( statement->body, settings );
+			}
+
+		}, node.value );
+	}
+
+	static void findStrings( const std::vector< std::unique_ptr< Declaration > >& body, StringSettings settings ) {
+		for( const auto& declaration : body ) {
+			std::visit( overloaded {
+
+				// Directives are read by the compiler, and never stored
+				[]( const std::unique_ptr< Annotation >& ) {},
+				[ &settings ]( const std::unique_ptr< VarDeclaration >& declaration ) {
+					if( declaration->value ) {
+						findStrings( **declaration->value, settings );
+					}
+				},
+				[ &settings ]( const std::unique_ptr< ConstDeclaration >& declaration ) {
+					// Every use of a scalar constant has been folded into a literal of its own
+					if( declaration->variable.type.arrayDimensions.size() ) {
+						findStrings( *declaration->value, settings );
+					}
+				},
+				[ &settings ]( const std::unique_ptr< FunctionDeclaration >& declaration ) { findStrings( declaration->body, settings ); },
+				[ &settings ]( const std::unique_ptr< TypeDeclaration >& declaration ) {
+					for( const auto& function : declaration->functions ) {
+						findStrings( function->body, settings );
+					}
+				},
+				[]( const std::unique_ptr< ImportDeclaration >& ) {},
+				[ &settings ]( const std::unique_ptr< Statement >& statement ) { findStrings( *statement, settings ); }
+
+			}, declaration->value );
+		}
+	}
+
+	StringPool buildStringPool( const std::vector< const Program* >& programs ) {
+		StringPool pool{ "", {}, 0 };
+		std::vector< std::string > literals;
+		std::set< std::string > seen;
+		for( const Program* program : programs ) {
+			findStrings( program->statements, StringSettings{ literals, seen, pool.unpooledSize } );
+		}
+
+		// Sorted back to front, every literal that ends another comes directly before one that it ends, and so
+		// can take the tail of whatever that one is stored in
+		std::vector< std::string > reversed;
+		std::vector< size_t > order;
+		for( size_t i = 0; i != literals.size(); i++ ) {
+			reversed.emplace_back( literals[ i ].rbegin(), literals[ i ].rend() );
+			order.push_back( i );
+		}
+		std::sort( order.begin(), order.end(), [ &reversed ]( size_t lhs, size_t rhs ) { return reversed[ lhs ] < reversed[ rhs ]; } );
+
+		std::vector< size_t > owner( literals.size() );
+		for( size_t i = order.size(); i-- != 0; ) {
+			size_t literal = order[ i ];
+			owner[ literal ] = literal;
+			if( i + 1 != order.size() ) {
+				const std::string& next = reversed[ order[ i + 1 ] ];
+				if( next.compare( 0, reversed[ literal ].size(), reversed[ literal ] ) == 0 ) {
+					owner[ literal ] = owner[ order[ i + 1 ] ];
+				}
+			}
+		}
+
+		for( size_t i = 0; i != literals.size(); i++ ) {
+			if( owner[ i ] == i ) {
+				pool.offsets[ literals[ i ] ] = pool.data.size();
+				pool.data += literals[ i ];
+				pool.data += '\0';
+			}
+		}
+		for( size_t i = 0; i != literals.size(); i++ ) {
+			const std::string& longer = literals[ owner[ i ] ];
+			pool.offsets[ literals[ i ] ] = pool.offsets[ longer ] + ( long ) ( longer.size() - literals[ i ].size() );
+		}
+
+		return pool;
+	}
+
+}
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "symbol.hpp"
 #include "variant_visitor.hpp"
 #include "type_tools.hpp"
+#include "stats.hpp"
+#include <utility>
+#include <algorithm>
 
 namespace GoldScorpion {
 
@@ -11,20 +14,90 @@ namespace GoldScorpion {
     }
 
     SymbolTypeHandle SymbolResolver::addSymbolType( SymbolType incoming ) {
+        GS_COUNT( ADD_SYMBOL_TYPE_CALLS );
+
         for( size_t i = 0; i != handles.size(); i++ ) {
             const SymbolType& type = handles[ i ];
             if( incoming.index() == type.index() ) {
                 // Cheap way to do this is to just compare the type id which will be equal for equivalent types
                 if( getSymbolTypeId( incoming ) == getSymbolTypeId( type ) ) {
+                    GS_COUNT_BY( ADD_SYMBOL_TYPE_SCANNED, i + 1 );
                     return i;
                 }
             }
         }
 
+        GS_COUNT_BY( ADD_SYMBOL_TYPE_SCANNED, handles.size() );
         handles.push_back( incoming );
         return handles.size() - 1;
     }
 
+    template< typename Element >
+    static std::shared_ptr< const std::vector< Element > > packElements( const std::vector< long >& values ) {
+        auto elements = std::make_shared< std::vector< Element > >();
+        elements->reserve( values.size() );
+        for( long value : values ) {
+            elements->push_back( ( Element ) value );
+        }
+
+        return elements;
+    }
+
+    ConstantIntegerArray ConstantIntegerArray::pack( const std::vector< long >& values, TokenType elementType ) {
+        ConstantIntegerArray result;
+        switch( elementType ) {
+            case TokenType::TOKEN_S8:
+                result.isSigned = true;
+                [[fallthrough]];
+            case TokenType::TOKEN_U8:
+                result.elements = packElements< uint8_t >( values );
+                break;
+            case TokenType::TOKEN_S16:
+                result.isSigned = true;
+                [[fallthrough]];
+            case TokenType::TOKEN_U16:
+                result.elements = packElements< uint16_t >( values );
+                break;
+            case TokenType::TOKEN_S32:
+                result.isSigned = true;
+                [[fallthrough]];
+            default:
+                result.elements = packElements< uint32_t >( values );
+                break;
+        }
+
+        return result;
+    }
+
+    size_t ConstantIntegerArray::size() const {
+        return std::visit( []( const auto& elements ) { return elements->size(); }, elements );
+    }
+
+    long ConstantIntegerArray::at( size_t index ) const {
+        return std::visit( overloaded {
+            [ & ]( const std::shared_ptr< const std::vector< uint8_t > >& elements ) {
+                return isSigned ? ( long ) ( int8_t ) ( *elements )[ index ] : ( long ) ( *elements )[ index ];
+            },
+            [ & ]( const std::shared_ptr< const std::vector< uint16_t > >& elements ) {
+                return isSigned ? ( long ) ( int16_t ) ( *elements )[ index ] : ( long ) ( *elements )[ index ];
+            },
+            [ & ]( const std::shared_ptr< const std::vector< uint32_t > >& elements ) {
+                return isSigned ? ( long ) ( int32_t ) ( *elements )[ index ] : ( long ) ( *elements )[ index ];
+            }
+        }, elements );
+    }
+
+    ConstantStringArray::ConstantStringArray( std::vector< std::string > values ) :
+        elements( std::make_shared< const std::vector< std::string > >( std::move( values ) ) ) {}
+
+    size_t ConstantStringArray::size() const {
+        return elements->size();
+    }
+
+    const std::string& ConstantStringArray::at( size_t index ) const {
+        return ( *elements )[ index ];
+    }
+
     std::string getSymbolId( const Symbol& symbol ) {
         return std::visit( overloaded {
             []( const VariableSymbol& symbol ) {
@@ -64,19 +137,60 @@ namespace GoldScorpion {
                 }
                 dimensionString += "]";
 
+                // Laid out differently, so never the same type as the unpadded array
+                if( type.padded ) {
+                    dimensionString += " (padded)";
+                }
+
                 return dimensionString;
             }
         }, symbolType );
     }
 
     bool fieldPresent( const std::string& fieldId, const UdtSymbol& symbol ) {
-        for( const SymbolField& field : symbol.fields ) {
-            if( field.id == fieldId ) {
-                return true;
+        return symbol.slots.count( fieldId );
+    }
+
+    const SymbolField* findField( const std::string& fieldId, const UdtSymbol& symbol ) {
+        auto slot = symbol.slots.find( fieldId );
+        if( slot == symbol.slots.end() ) {
+            return nullptr;
+        }
+
+        return &symbol.fields[ slot->second.field ];
+    }
+
+    std::optional< SymbolFieldSlot > findFieldSlot( const std::string& fieldId, const UdtSymbol& symbol ) {
+        auto slot = symbol.slots.find( fieldId );
+        if( slot == symbol.slots.end() ) {
+            return {};
+        }
+
+        return slot->second;
+    }
+
+    void addUdtField( UdtSymbol& symbol, SymbolField field, std::optional< SymbolTypeLayout > layout ) {
+        SymbolFieldSlot slot{ symbol.fields.size(), 0, 0, 1 };
+
+        // Variable fields are laid out in declaration order, each padded up to its own alignment
+        // The total size is rounded up to the largest alignment so that arrays of this type stay aligned
+        if( layout ) {
+            long offset = symbol.layout.size;
+            if( offset % layout->alignment ) {
+                offset += layout->alignment - ( offset % layout->alignment );
+            }
+
+            slot = SymbolFieldSlot{ symbol.fields.size(), offset, layout->size, layout->alignment };
+            symbol.layout.alignment = std::max( symbol.layout.alignment, layout->alignment );
+            symbol.layout.size = offset + layout->size;
+            if( symbol.layout.size % symbol.layout.alignment ) {
+                symbol.layout.size += symbol.layout.alignment - ( symbol.layout.size % symbol.layout.alignment );
             }
         }
 
-        return false;
+        // A later member with the same name stays unreachable by name, as it was when fields were searched in order
+        symbol.slots.emplace( field.id, slot );
+        symbol.fields.push_back( std::move( field ) );
     }
 
     SymbolTable* SymbolResolver::getByFileId( const std::string& id ) {
@@ -89,6 +203,23 @@ namespace GoldScorpion {
         return nullptr;
     }
 
+    const SymbolTable* SymbolResolver::getByFileId( const std::string& id ) const {
+        for( const SymbolTable& symbolTable : symbolTables ) {
+            if( symbolTable.fileId == id ) {
+                return &symbolTable;
+            }
+        }
+
+        return nullptr;
+    }
+
+    SymbolResolver SymbolResolver::fork() const {
+        SymbolResolver child;
+        child.parent = this;
+
+        return child;
+    }
+
     void SymbolResolver::addFile( const std::string& id ) {
         if( getByFileId( id ) ) {
             // Cannot double-add a file - did you do something wrong?
@@ -107,46 +238,88 @@ namespace GoldScorpion {
         }
     }
 
-    Symbol* SymbolResolver::getSymbol( const std::string& fileId, const std::string& symbolId ) {
-        SymbolTable* symbolTable = getByFileId( fileId );
-        if( !symbolTable ) {
-            return nullptr;
-        }
+    const Symbol* SymbolResolver::findInTable( const SymbolTable& symbolTable, const std::string& symbolId ) const {
+        // Symbols compared along the way, for --stats
+        size_t scanned = 0;
 
         // Step 1: Search scopes from top of stack down
-        for( auto it = symbolTable->scopes.rbegin(); it != symbolTable->scopes.rend(); ++it ) {
-            std::vector< Symbol >& scope = *it;
-            for( Symbol& symbol : scope ) {
+        for( auto it = symbolTable.scopes.rbegin(); it != symbolTable.scopes.rend(); ++it ) {
+            const std::vector< Symbol >& scope = *it;
+            for( const Symbol& symbol : scope ) {
+                scanned++;
                 if( getSymbolId( symbol ) == symbolId ) {
+                    GS_COUNT_BY( GET_SYMBOL_SCANNED, scanned );
                     return &symbol;
                 }
             }
         }
 
         // Step 2: Search symbols in own file
-        for( Symbol& symbol : symbolTable->symbols ) {
+        for( const Symbol& symbol : symbolTable.symbols ) {
+            scanned++;
             if( getSymbolId( symbol ) == symbolId ) {
+                GS_COUNT_BY( GET_SYMBOL_SCANNED, scanned );
                 return &symbol;
             }
         }
 
         // Step 3: Search public symbols in all outer scopes (files)
-        for( const std::string& outerScope : symbolTable->outerScopes ) {
+        for( const std::string& outerScope : symbolTable.outerScopes ) {
             if( auto externalSymbolTable = getByFileId( outerScope ) ) {
-                for( Symbol& symbol : externalSymbolTable->symbols ) {
+                for( const Symbol& symbol : externalSymbolTable->symbols ) {
+                    scanned++;
                     if( symbol.external && getSymbolId( symbol ) == symbolId ) {
+                        GS_COUNT_BY( GET_SYMBOL_SCANNED, scanned );
                         return &symbol;
                     }
                 }
             }
         }
 
+        GS_COUNT_BY( GET_SYMBOL_SCANNED, scanned );
+        return nullptr;
+    }
+
+    Symbol* SymbolResolver::getSymbol( const std::string& fileId, const std::string& symbolId ) {
+        GS_COUNT( GET_SYMBOL_CALLS );
+
+        // Mutable lookups never reach into the parent, which may be shared with other forks
+        SymbolTable* symbolTable = getByFileId( fileId );
+        if( !symbolTable ) {
+            return nullptr;
+        }
+
+        return const_cast< Symbol* >( findInTable( *symbolTable, symbolId ) );
+    }
+
+    const Symbol* SymbolResolver::getSymbol( const std::string& fileId, const std::string& symbolId ) const {
+        GS_COUNT( GET_SYMBOL_CALLS );
+
+        if( const SymbolTable* symbolTable = getByFileId( fileId ) ) {
+            if( const Symbol* symbol = findInTable( *symbolTable, symbolId ) ) {
+                return symbol;
+            }
+        }
+
+        // Step 4: If this is a fork, whatever it doesn't have is in the parent
+        if( parent ) {
+            return parent->getSymbol( fileId, symbolId );
+        }
+
         // The symbol wasn't found in the given context
         return nullptr;
     }
 
+    const ConstantSymbol* SymbolResolver::findConstant( const std::string& fileId, const std::string& constantId ) const {
+        if( const Symbol* symbol = getSymbol( fileId, constantId ) ) {
+            return std::get_if< ConstantSymbol >( &symbol->symbol );
+        }
+
+        return nullptr;
+    }
+
     std::optional< Symbol > SymbolResolver::findSymbol( const std::string& fileId, const std::string& symbolId ) {
-        Symbol* symbol = getSymbol( fileId, symbolId );
+        const Symbol* symbol = std::as_const( *this ).getSymbol( fileId, symbolId );
 
         if( symbol ) {
             // Copy
@@ -156,6 +329,14 @@ namespace GoldScorpion {
         }
     }
 
+    const UdtSymbol* SymbolResolver::findUdt( const std::string& fileId, const std::string& udtId ) const {
+        if( const Symbol* symbol = getSymbol( fileId, udtId ) ) {
+            return std::get_if< UdtSymbol >( &symbol->symbol );
+        }
+
+        return nullptr;
+    }
+
     void SymbolResolver::addSymbol( const std::string& fileId, Symbol symbol ) {
         if( auto symbolTable = getByFileId( fileId ) ) {
             // If there are any scopes open, add to the scope
@@ -171,12 +352,17 @@ namespace GoldScorpion {
     void SymbolResolver::addFieldToSymbol( const std::string& fileId, const std::string& symbolId, SymbolField field ) {
         if( auto query = getSymbol( fileId, symbolId ) ) {
             if( auto asUdt = std::get_if< UdtSymbol >( &( query->symbol ) ) ) {
-                asUdt->fields.push_back( field );
+                addUdtField( *asUdt, field );
             }
         }
     }
 
     void SymbolResolver::openScope( const std::string& fileId ) {
+        // Forks keep their own scope stack for files held by the parent
+        if( parent && !getByFileId( fileId ) && parent->getByFileId( fileId ) ) {
+            addFile( fileId );
+        }
+
         if( auto symbolTable = getByFileId( fileId ) ) {
             symbolTable->scopes.push_back( std::vector< Symbol >{} );
         }
@@ -195,29 +381,40 @@ namespace GoldScorpion {
     }
 
     SymbolType toSymbolType( const ArrayIntermediateType& type ) {
-       if( auto unwrap = std::get_if< SymbolNativeType >( &type ) ) {
-           return *unwrap;
-       } else if( auto unwrap = std::get_if< SymbolUdtType >( &type ) ) {
-           return *unwrap;
-       } else if( auto unwrap = std::get_if< SymbolFunctionType >( &type ) ) {
-           return *unwrap;
-       } else {
-           Error{ "Internal compiler error (unknown type in ArrayIntermediateType)", {} }.throwException();
-           throw "";
-       }
-    }
-
-    ArrayIntermediateType toArrayIntermediateType( const SymbolType& type ) {
-        ArrayIntermediateType arrayType;
-
-        std::visit( overloaded {
-            [ &arrayType ]( const SymbolNativeType& type ) { arrayType = type; },
-            [ &arrayType ]( const SymbolFunctionType& type ) { arrayType = type; },
-            [ &arrayType ]( const SymbolUdtType& type ) { arrayType = type; },
-            []( const SymbolArrayType& ) { Error{ "Internal compiler error (cannot wrap an array in an array intermediate type)", {} }.throwException(); }
+        return std::visit( []( const auto& unwrap ) { return SymbolType{ unwrap }; }, type );
+    }
+
+    std::optional< ArrayIntermediateType > toArrayIntermediateType( const SymbolType& type ) {
+        // An array cannot be wrapped in an array intermediate type
+        return std::visit( overloaded {
+            []( const SymbolNativeType& type ) -> std::optional< ArrayIntermediateType > { return type; },
+            []( const SymbolFunctionType& type ) -> std::optional< ArrayIntermediateType > { return type; },
+            []( const SymbolUdtType& type ) -> std::optional< ArrayIntermediateType > { return type; },
+            []( const SymbolArrayType& ) -> std::optional< ArrayIntermediateType > { return {}; }
         }, type );
+    }
+
+    SymbolArrayType makeArrayType( std::vector< long > dimensions, ArrayIntermediateType base, bool padded ) {
+        // Worked out once here so that indexing is a multiply-add per index
+        std::vector< long > strides;
+        long stride = 1;
+        for( size_t i = 0; i != dimensions.size(); i++ ) {
+            strides.push_back( stride );
+
+            // The last dimension is never padded, as nothing is indexed past it
+            long dimension = dimensions[ i ];
+            if( padded && i + 1 != dimensions.size() ) {
+                long rounded = 1;
+                while( rounded < dimension ) {
+                    rounded <<= 1;
+                }
+                dimension = rounded;
+            }
+
+            stride *= dimension;
+        }
 
-        return arrayType;
+        return SymbolArrayType{ std::move( dimensions ), std::move( base ), std::move( strides ), padded };
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "time_report.hpp"
+#include "utility.hpp"
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+
+namespace GoldScorpion::TimeReport {
+
+	struct Totals {
+		double wallMs = 0;
+		double cpuMs = 0;
+		uint64_t allocations = 0;
+		long peakRssKb = 0;
+		uint64_t calls = 0;
+	};
+
+	struct Row {
+		std::string module;
+		std::string phase;
+		Totals totals;
+	};
+
+	static std::atomic< bool > active{ false };
+	static std::atomic< uint64_t > allocationCount{ 0 };
+	static std::mutex totalsMutex;
+	static std::map< std::pair< std::string, std::string >, Totals > totals;
+
+	void enable() {
+		active = true;
+	}
+
+	bool enabled() {
+		return active.load( std::memory_order_relaxed );
+	}
+
+	void countAllocation() {
+		allocationCount.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	Sample sample() {
+		rusage usage;
+		getrusage( RUSAGE_SELF, &usage );
+
+		auto toMs = []( const timeval& time ) { return time.tv_sec * 1000.0 + time.tv_usec / 1000.0; };
+
+		return Sample{
+			std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now().time_since_epoch() ).count(),
+			toMs( usage.ru_utime ) + toMs( usage.ru_stime ),
+			allocationCount.load( std::memory_order_relaxed ),
+			// Kilobytes on Linux
+			usage.ru_maxrss
+		};
+	}
+
+	void record( const std::string& module, const std::string& phase, const Sample& start, const Sample& end ) {
+		std::lock_guard< std::mutex > lock( totalsMutex );
+
+		Totals& entry = totals[ { module, phase } ];
+		entry.wallMs += end.wallMs - start.wallMs;
+		entry.cpuMs += end.cpuMs - start.cpuMs;
+		entry.allocations += end.allocations - start.allocations;
+		entry.peakRssKb = std::max( entry.peakRssKb, end.peakRssKb );
+		entry.calls++;
+	}
+
+	static void accumulate( Totals& into, const Totals& from ) {
+		into.wallMs += from.wallMs;
+		into.cpuMs += from.cpuMs;
+		into.allocations += from.allocations;
+		into.peakRssKb = std::max( into.peakRssKb, from.peakRssKb );
+		into.calls += from.calls;
+	}
+
+	static void printJsonRow( std::ostream& out, const Row& row ) {
+		out << "{ \"module\": \"" << Utility::jsonEscape( row.module ) << "\", \"phase\": \"" << Utility::jsonEscape( row.phase ) << "\", "
+			<< "\"wallMs\": " << row.totals.wallMs << ", \"cpuMs\": " << row.totals.cpuMs << ", "
+			<< "\"allocations\": " << row.totals.allocations << ", \"peakRssKb\": " << row.totals.peakRssKb << ", "
+			<< "\"calls\": " << row.totals.calls << " }";
+	}
+
+	void print( Format format ) {
+		std::vector< Row > modules;
+		std::map< std::string, Totals > phases;
+		{
+			std::lock_guard< std::mutex > lock( totalsMutex );
+			for( const auto& [ key, entry ] : totals ) {
+				modules.push_back( Row{ key.first, key.second, entry } );
+				accumulate( phases[ key.second ], entry );
+			}
+		}
+
+		// Most expensive first
+		auto byWall = []( const Row& lhs, const Row& rhs ) { return lhs.totals.wallMs > rhs.totals.wallMs; };
+		std::stable_sort( modules.begin(), modules.end(), byWall );
+
+		std::vector< Row > phaseRows;
+		for( const auto& [ phase, entry ] : phases ) {
+			phaseRows.push_back( Row{ "(all)", phase, entry } );
+		}
+		std::stable_sort( phaseRows.begin(), phaseRows.end(), byWall );
+
+		if( format == Format::JSON ) {
+			std::cout << "{ \"modules\": [";
+			for( size_t i = 0; i != modules.size(); i++ ) {
+				std::cout << ( i ? ", " : " " );
+				printJsonRow( std::cout, modules[ i ] );
+			}
+			std::cout << " ], \"phases\": [";
+			for( size_t i = 0; i != phaseRows.size(); i++ ) {
+				std::cout << ( i ? ", " : " " );
+				printJsonRow( std::cout, phaseRows[ i ] );
+			}
+			std::cout << " ] }" << std::endl;
+			return;
+		}
+
+		size_t moduleWidth = 6;
+		for( const Row& row : modules ) {
+			moduleWidth = std::max( moduleWidth, row.module.size() );
+		}
+
+		auto printRow = [ moduleWidth ]( const Row& row ) {
+			std::cout << std::left << std::setw( moduleWidth + 2 ) << row.module << std::setw( 12 ) << row.phase << std::right
+				<< std::fixed << std::setprecision( 3 )
+				<< std::setw( 12 ) << row.totals.wallMs
+				<< std::setw( 12 ) << row.totals.cpuMs
+				<< std::setw( 12 ) << row.totals.allocations
+				<< std::setw( 16 ) << row.totals.peakRssKb
+				<< std::setw( 8 ) << row.totals.calls << std::endl;
+		};
+
+		std::cout << std::left << std::setw( moduleWidth + 2 ) << "Module" << std::setw( 12 ) << "Phase" << std::right
+			<< std::setw( 12 ) << "Wall (ms)"
+			<< std::setw( 12 ) << "CPU (ms)"
+			<< std::setw( 12 ) << "Allocs"
+			<< std::setw( 16 ) << "Peak RSS (KiB)"
+			<< std::setw( 8 ) << "Calls" << std::endl;
+
+		for( const Row& row : modules ) {
+			printRow( row );
+		}
+
+		std::cout << std::endl;
+		for( const Row& row : phaseRows ) {
+			printRow( row );
+		}
+
+		std::cout << std::defaultfloat;
+	}
+
+}
\ No newline at end of file
@@ -5,7 +5,8 @@ namespace GoldScorpion {
 	std::string Token::toString() const {
 		std::string result = "Token(TokenType::";
 
-		std::string occurrence = " " + std::to_string( line ) + ", " + std::to_string( column );
+		auto location = SourceMap::resolve( span );
+		std::string occurrence = location ? " " + std::to_string( location->line ) + ", " + std::to_string( location->column ) : " (unknown)";
 
 		switch( type ) {
 			case TokenType::TOKEN_NONE:
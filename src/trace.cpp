@@ -0,0 +1,90 @@
+#include "trace.hpp"
+#include "utility.hpp"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+
+namespace GoldScorpion::Trace {
+
+	struct Event {
+		std::string name;
+		std::string module;
+		std::string detail;
+		double startUs;
+		double durationUs;
+		unsigned int thread;
+	};
+
+	static std::atomic< bool > active{ false };
+	static std::chrono::steady_clock::time_point epoch;
+	static std::mutex eventsMutex;
+	static std::vector< Event > events;
+
+	// Threads get small sequential ids in the order they first record, after the thread that enables tracing, which is
+	// the main thread and track 1 even if a worker records first
+	static std::atomic< unsigned int > nextThread{ 1 };
+
+	static unsigned int currentThread() {
+		thread_local unsigned int thread = nextThread++;
+		return thread;
+	}
+
+	void enable() {
+		epoch = std::chrono::steady_clock::now();
+		currentThread();
+		active = true;
+	}
+
+	bool enabled() {
+		return active.load( std::memory_order_relaxed );
+	}
+
+	double now() {
+		return std::chrono::duration< double, std::micro >( std::chrono::steady_clock::now() - epoch ).count();
+	}
+
+	void record( const std::string& name, const std::string& module, const std::string& detail, double startUs, double endUs ) {
+		unsigned int thread = currentThread();
+
+		std::lock_guard< std::mutex > lock( eventsMutex );
+		events.push_back( Event{ name, module, detail, startUs, endUs - startUs, thread } );
+	}
+
+	bool write( const std::string& path ) {
+		std::ofstream out( path );
+		if( !out ) {
+			return false;
+		}
+
+		std::lock_guard< std::mutex > lock( eventsMutex );
+
+		out << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+		// Name each track so workers are told apart from the thread that started them
+		unsigned int threadCount = nextThread;
+		for( unsigned int thread = 1; thread != threadCount; thread++ ) {
+			out << ( thread == 1 ? "\n" : ",\n" )
+				<< "{ \"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << thread << ", "
+				<< "\"args\": { \"name\": \"" << ( thread == 1 ? "main" : "worker " + std::to_string( thread - 1 ) ) << "\" } }";
+		}
+
+		for( const Event& event : events ) {
+			out << ",\n{ \"ph\": \"X\", \"cat\": \"compiler\", \"name\": \"" << Utility::jsonEscape( event.name ) << "\", "
+				<< "\"pid\": 1, \"tid\": " << event.thread << ", \"ts\": " << std::fixed << event.startUs << ", \"dur\": " << event.durationUs << ", "
+				<< "\"args\": { \"module\": \"" << Utility::jsonEscape( event.module ) << "\"";
+
+			if( !event.detail.empty() ) {
+				out << ", \"detail\": \"" << Utility::jsonEscape( event.detail ) << "\"";
+			}
+
+			out << " } }";
+		}
+
+		out << "\n] }" << std::endl;
+
+		return bool( out );
+	}
+
+}
\ No newline at end of file
@@ -1,36 +1,45 @@
 #include "tree_tools.hpp"
 #include "type_tools.hpp"
 #include "error.hpp"
+#include "phase.hpp"
+#include "stats.hpp"
+#include "utility.hpp"
+#include "variant_visitor.hpp"
 #include <variant>
 
 namespace GoldScorpion {
 
-    static void evaluateConstantExpression( const Expression& node, ConstEvaluationSettings settings );
+    static std::optional< Error > evaluateConstantExpression( const Expression& node, ConstEvaluationSettings settings );
+    static ConstantExpressionValue packArray( const ConstantLocal& local );
 
-    long flattenArrayIndex( const std::vector< long >& dimensions, const std::vector< long >& indices ) {
-        // x + y * width + z * width * height + w * width * depth * height + ...
-
-        // There should be as many indices as there are dimensions
+    // Integer arithmetic is done on unsigned values, which wrap where a long would overflow, and the result brought
+    // back to a long; whatever the value is stored in narrows it to its own type
+    static long wrapping( unsigned long value ) {
+        return ( long ) value;
+    }
 
+    long flattenArrayIndex( const SymbolArrayType& type, const std::vector< long >& indices ) {
+        // x + y * width + z * width * height + ..., with each product already in the strides
         long index = 0;
-        for( long i = 0; i != ( long )indices.size(); i++ ) {
-            long addValue = indices[ i ];
+        for( size_t i = 0; i != indices.size(); i++ ) {
+            index += indices[ i ] * type.strides[ i ];
+        }
 
-            if( i != 0 ) {
-                for( long j = 0; j != i; j++ ) {
-                    addValue *= dimensions[ j ];
-                }
-            }
+        return index;
+    }
 
-            index += addValue;
+    std::optional< long > getElementOffset( const SymbolArrayType& type, const std::vector< long >& indices, SymbolTypeSettings settings ) {
+        auto element = getTypeLayout( toSymbolType( type.base ), settings );
+        if( !element || indices.size() != type.dimensions.size() ) {
+            return {};
         }
 
-        return index;
+        return flattenArrayIndex( type, indices ) * element->size;
     }
 
     bool constantIsArray( const ConstantExpressionValue& value ) {
-        return std::holds_alternative< std::vector< long > >( value ) ||
-               std::holds_alternative< std::vector< std::string > >( value );
+        return std::holds_alternative< ConstantIntegerArray >( value ) ||
+               std::holds_alternative< ConstantStringArray >( value );
     }
 
     std::optional< std::string > getIdentifierName( const Token& token ) {
@@ -213,7 +222,7 @@ namespace GoldScorpion {
         return false;
     }
 
-    static void evaluateConstantExpression( const Primary& node, ConstEvaluationSettings settings ) {
+    static std::optional< Error > evaluateConstantExpression( const Primary& node, ConstEvaluationSettings settings ) {
         // The only acceptable types here are subexpressions, or tokens of either literal integer, literal string, or identifier type
         if( auto subexpression = std::get_if< std::unique_ptr< Expression > > ( &node.value ) ) {
             return evaluateConstantExpression( **subexpression, settings );
@@ -223,40 +232,56 @@ namespace GoldScorpion {
         switch( token.type ) {
             case TokenType::TOKEN_LITERAL_INTEGER: {
                 settings.stack.push( std::get< long >( *( token.value ) ) );
-                return;
+                return {};
             }
             case TokenType::TOKEN_LITERAL_STRING: {
                 settings.stack.push( std::get< std::string >( *( token.value ) ) );
-                return;
+                return {};
             }
             case TokenType::TOKEN_IDENTIFIER: {
                 // Get identifier, then get type. Must return a constant symbol.
                 std::string identifier = std::get< std::string >( *( token.value ) );
-                auto symbolQuery = settings.symbols.findSymbol( settings.fileId, identifier );
-                if( !symbolQuery ) {
-                    Error{ "Cannot find symbol: " + identifier, token }.throwException();
+                if( settings.locals ) {
+                    auto local = settings.locals->find( identifier );
+                    if( local != settings.locals->end() ) {
+                        settings.stack.push( local->second.arrayType ? packArray( local->second ) : local->second.value );
+                        return {};
+                    }
                 }
 
-                if( !std::holds_alternative< ConstantSymbol >( symbolQuery->symbol ) ) {
-                    Error{ "Symbol \"" + std::get< std::string >( *( token.value ) ) + "\" is a non-constant symbol", token }.throwException();
+                // Looked up in place rather than copied out; an array value only shares its elements
+                if( const ConstantSymbol* constant = settings.symbols.findConstant( settings.fileId, identifier ) ) {
+                    settings.stack.push( constant->value );
+                    return {};
                 }
 
-                settings.stack.push( std::get< ConstantSymbol >( symbolQuery->symbol ).value );
-                return;
+                if( !settings.symbols.findSymbol( settings.fileId, identifier ) ) {
+                    return Error{ "Cannot find symbol: " + identifier, token.span };
+                }
+
+                if( settings.locals ) {
+                    return Error{ "Global \"" + identifier + "\" is not known at compile time", token.span };
+                }
+
+                return Error{ "Symbol \"" + identifier + "\" is a non-constant symbol", token.span };
             }
             default:
-                Error{ "Internal compiler error (Token of unexpected type encountered while trying to evaluate constant expression", token }.throwException();
+                return Error{ "Internal compiler error (Token of unexpected type encountered while trying to evaluate constant expression", token.span };
         }
     }
 
-    static void evaluateConstantExpression( const BinaryExpression& node, ConstEvaluationSettings settings ) {
+    static std::optional< Error > evaluateConstantExpression( const BinaryExpression& node, ConstEvaluationSettings settings ) {
         // Push both sides onto the stack - beginning with the right
-        evaluateConstantExpression( *node.rhsValue, settings );
-        evaluateConstantExpression( *node.lhsValue, settings );
+        if( auto error = evaluateConstantExpression( *node.rhsValue, settings ) ) {
+            return error;
+        }
+        if( auto error = evaluateConstantExpression( *node.lhsValue, settings ) ) {
+            return error;
+        }
 
-        ConstantExpressionValue left = settings.stack.top();
+        ConstantExpressionValue left = std::move( settings.stack.top() );
         settings.stack.pop();
-        ConstantExpressionValue right = settings.stack.top();
+        ConstantExpressionValue right = std::move( settings.stack.top() );
         settings.stack.pop();
 
         // Attempt to extract operator
@@ -264,152 +289,783 @@ namespace GoldScorpion {
         if( auto token = std::get_if< Token >( &node.op->value ) ) {
             operatorToken = *token;
         } else {
-            Error{ "Internal compiler error (BinaryExpression operator not of token type)", settings.nearestToken }.throwException();
+            return Error{ "Internal compiler error (BinaryExpression operator not of token type)", settings.nearestSpan };
         }
 
 
         if( constantIsArray( left ) || constantIsArray( right ) ) {
             // Cannot apply a binaryexpression operation to an array
-            Error{ "Array type invalid as operand in constant BinaryExpression", operatorToken }.throwException();
+            return Error{ "Array type invalid as operand in constant BinaryExpression", operatorToken.span };
+        } else if( std::holds_alternative< std::string >( left ) && std::holds_alternative< std::string >( right ) && ( operatorToken.type == TokenType::TOKEN_DOUBLE_EQUALS || operatorToken.type == TokenType::TOKEN_NOT_EQUALS ) ) {
+            // Two strings can also be compared
+            bool equal = std::get< std::string >( left ) == std::get< std::string >( right );
+            settings.stack.push( ( long ) ( operatorToken.type == TokenType::TOKEN_DOUBLE_EQUALS ? equal : !equal ) );
+            return {};
         } else if( std::holds_alternative< std::string >( left ) || std::holds_alternative< std::string >( right ) ) {
             // If either side contains a string then the total value will be coerced to string, and the "+" operator is the only valid operator.
             if( operatorToken.type != TokenType::TOKEN_PLUS ) {
-                Error{ "Only the concatenation \"+\" operator is valid for an expression combining a numeric and a string type", operatorToken }.throwException();
+                return Error{ "Only the concatenation \"+\" operator is valid for an expression combining a numeric and a string type", operatorToken.span };
             }
 
             std::string result;
             if( auto leftString = std::get_if< std::string >( &left ) ) {
                 result = *leftString;
-                result += std::to_string( std::get< long >( right ) );
+                if( auto rightString = std::get_if< std::string >( &right ) ) {
+                    result += *rightString;
+                } else {
+                    result += std::to_string( std::get< long >( right ) );
+                }
             } else {
                 result = std::to_string( std::get< long >( left ) );
                 result += std::get< std::string >( right );
             }
 
             settings.stack.push( result );
+            return {};
         } else {
             // Both sides are long and can be operated on directly
+            long lhs = std::get< long >( left );
+            long rhs = std::get< long >( right );
             switch( operatorToken.type ) {
                 case TokenType::TOKEN_PLUS: {
-                    settings.stack.push( std::get< long >( left ) + std::get< long >( right ) );
-                    return;
+                    settings.stack.push( wrapping( ( unsigned long ) lhs + ( unsigned long ) rhs ) );
+                    return {};
                 }
                 case TokenType::TOKEN_MINUS: {
-                    settings.stack.push( std::get< long >( left ) - std::get< long >( right ) );
-                    return;
+                    settings.stack.push( wrapping( ( unsigned long ) lhs - ( unsigned long ) rhs ) );
+                    return {};
                 }
                 case TokenType::TOKEN_ASTERISK: {
-                    settings.stack.push( std::get< long >( left ) * std::get< long >( right ) );
-                    return;
+                    settings.stack.push( wrapping( ( unsigned long ) lhs * ( unsigned long ) rhs ) );
+                    return {};
                 }
                 case TokenType::TOKEN_FORWARD_SLASH: {
-                    settings.stack.push( std::get< long >( left ) / std::get< long >( right ) );
-                    return;
+                    if( rhs == 0 ) {
+                        return Error{ "Division by zero in constant expression", operatorToken.span };
+                    }
+
+                    // The one quotient that does not fit a long
+                    settings.stack.push( rhs == -1 ? wrapping( 0UL - ( unsigned long ) lhs ) : lhs / rhs );
+                    return {};
+                }
+                case TokenType::TOKEN_MODULO: {
+                    if( rhs == 0 ) {
+                        return Error{ "Division by zero in constant expression", operatorToken.span };
+                    }
+
+                    settings.stack.push( rhs == -1 ? 0L : lhs % rhs );
+                    return {};
+                }
+                case TokenType::TOKEN_SHIFT_LEFT:
+                case TokenType::TOKEN_SHIFT_RIGHT: {
+                    // Nothing on the target is wider than 32 bits
+                    if( rhs < 0 || rhs > 32 ) {
+                        return Error{ "Shift count out of range in constant expression", operatorToken.span };
+                    }
+
+                    settings.stack.push( operatorToken.type == TokenType::TOKEN_SHIFT_LEFT ? wrapping( ( unsigned long ) lhs << rhs ) : lhs >> rhs );
+                    return {};
+                }
+                case TokenType::TOKEN_AMPERSAND: {
+                    settings.stack.push( lhs & rhs );
+                    return {};
+                }
+                case TokenType::TOKEN_PIPE: {
+                    settings.stack.push( lhs | rhs );
+                    return {};
+                }
+                case TokenType::TOKEN_CARET: {
+                    settings.stack.push( lhs ^ rhs );
+                    return {};
+                }
+                case TokenType::TOKEN_DOUBLE_EQUALS: {
+                    settings.stack.push( ( long ) ( lhs == rhs ) );
+                    return {};
+                }
+                case TokenType::TOKEN_NOT_EQUALS: {
+                    settings.stack.push( ( long ) ( lhs != rhs ) );
+                    return {};
+                }
+                case TokenType::TOKEN_LESS_THAN: {
+                    settings.stack.push( ( long ) ( lhs < rhs ) );
+                    return {};
+                }
+                case TokenType::TOKEN_LESS_THAN_EQUAL: {
+                    settings.stack.push( ( long ) ( lhs <= rhs ) );
+                    return {};
+                }
+                case TokenType::TOKEN_GREATER_THAN: {
+                    settings.stack.push( ( long ) ( lhs > rhs ) );
+                    return {};
+                }
+                case TokenType::TOKEN_GREATER_THAN_EQUAL: {
+                    settings.stack.push( ( long ) ( lhs >= rhs ) );
+                    return {};
+                }
+                case TokenType::TOKEN_AND: {
+                    settings.stack.push( ( long ) ( lhs && rhs ) );
+                    return {};
+                }
+                case TokenType::TOKEN_OR: {
+                    settings.stack.push( ( long ) ( lhs || rhs ) );
+                    return {};
+                }
+                case TokenType::TOKEN_XOR: {
+                    settings.stack.push( ( long ) ( !lhs != !rhs ) );
+                    return {};
                 }
                 default:
-                    Error{ "Invalid operator in constant expression", operatorToken }.throwException();
+                    return Error{ "Invalid operator in constant expression", operatorToken.span };
             }
         }
     }
 
-    static void evaluateConstantExpression( const UnaryExpression& node, ConstEvaluationSettings settings ) {
-        evaluateConstantExpression( *node.value, settings );
+    static std::optional< Error > evaluateConstantExpression( const UnaryExpression& node, ConstEvaluationSettings settings ) {
+        if( auto error = evaluateConstantExpression( *node.value, settings ) ) {
+            return error;
+        }
 
-        ConstantExpressionValue operand = settings.stack.top();
+        ConstantExpressionValue operand = std::move( settings.stack.top() );
         settings.stack.pop();
 
         Token operatorToken;
         if( auto token = std::get_if< Token >( &node.op->value ) ) {
             operatorToken = *token;
         } else {
-            Error{ "Internal compiler error (UnaryExpression operator not of token type)", settings.nearestToken }.throwException();
+            return Error{ "Internal compiler error (UnaryExpression operator not of token type)", settings.nearestSpan };
         }
 
         if( constantIsArray( operand ) ) {
             // Cannot apply a unaryexpression operation to an array
-            Error{ "Array type invalid as operand in constant UnaryExpression", operatorToken }.throwException();
+            return Error{ "Array type invalid as operand in constant UnaryExpression", operatorToken.span };
         }
 
         // Strings not valid for unary expression
         if( std::holds_alternative< std::string >( operand ) ) {
-            Error{ "String operand not valid for unary expression in constant", operatorToken }.throwException();
+            return Error{ "String operand not valid for unary expression in constant", operatorToken.span };
         }
 
         switch( operatorToken.type ) {
             case TokenType::TOKEN_MINUS: {
-                settings.stack.push( std::get< long >( operand ) * -1 );
-                return;
+                settings.stack.push( wrapping( 0UL - ( unsigned long ) std::get< long >( operand ) ) );
+                return {};
             }
             case TokenType::TOKEN_NOT: {
                 settings.stack.push( !std::get< long >( operand ) );
-                return;
+                return {};
             }
             default:
-                Error{ "Invalid operator in constant expression", operatorToken }.throwException();
+                return Error{ "Invalid operator in constant expression", operatorToken.span };
         }
     }
 
-    static void evaluateConstantExpression( const ArrayExpression& node, ConstEvaluationSettings settings ) {
-        evaluateConstantExpression( *node.identifier, settings );
-        ConstantExpressionValue array = settings.stack.top();
-        settings.stack.pop();
+    /**
+     * Evaluate the indices of an array expression, each of which must fall within its dimension
+     */
+    static std::optional< Error > evaluateIndices( const ArrayExpression& node, const std::vector< long >& dimensions, ConstEvaluationSettings settings, std::vector< long >& indices ) {
+        for( const auto& expression : node.indices ) {
+            if( auto error = evaluateConstantExpression( *expression, settings ) ) {
+                return error;
+            }
+            ConstantExpressionValue index = std::move( settings.stack.top() );
+            settings.stack.pop();
 
-        if( !constantIsArray( array ) ) {
-            Error{ "Array notation invalid on non-array operand", settings.nearestToken }.throwException();
+            if( auto asIndex = std::get_if< long >( &index ) ) {
+                indices.push_back( *asIndex );
+            } else {
+                return Error{ "Expected numeric constant expression for array index", settings.nearestSpan };
+            }
+        }
+
+        if( indices.size() != dimensions.size() ) {
+            return Error{ "Expected " + std::to_string( dimensions.size() ) + " indices for constant array", settings.nearestSpan };
         }
 
+        for( size_t i = 0; i != indices.size(); i++ ) {
+            if( indices[ i ] < 0 || indices[ i ] >= dimensions[ i ] ) {
+                return Error{ "Constant array index out of bounds", settings.nearestSpan };
+            }
+        }
+
+        return {};
+    }
+
+    static std::optional< Error > evaluateConstantExpression( const ArrayExpression& node, ConstEvaluationSettings settings ) {
         // Using the node identifier, retrieve its name and type
         std::optional< std::string > arrayIdentifier = getIdentifierName( *node.identifier );
+
+        // An array local is indexed where it is, rather than packed first
+        if( arrayIdentifier && settings.locals ) {
+            auto local = settings.locals->find( *arrayIdentifier );
+            if( local != settings.locals->end() ) {
+                if( !local->second.arrayType ) {
+                    return Error{ "Array notation invalid on non-array operand", settings.nearestSpan };
+                }
+
+                std::vector< long > indices;
+                if( auto error = evaluateIndices( node, local->second.arrayType->dimensions, settings, indices ) ) {
+                    return error;
+                }
+
+                settings.stack.push( local->second.elements[ flattenArrayIndex( *local->second.arrayType, indices ) ] );
+                return {};
+            }
+        }
+
+        if( auto error = evaluateConstantExpression( *node.identifier, settings ) ) {
+            return error;
+        }
+        ConstantExpressionValue array = std::move( settings.stack.top() );
+        settings.stack.pop();
+
+        if( !constantIsArray( array ) ) {
+            return Error{ "Array notation invalid on non-array operand", settings.nearestSpan };
+        }
+
         if( !arrayIdentifier ) {
-            Error{ "Internal compiler error (unable to retrieve identifier name for array type)", settings.nearestToken }.throwException();
+            return Error{ "Internal compiler error (unable to retrieve identifier name for array type)", settings.nearestSpan };
         }
 
         // Get the symbol so we can get the dimensions
-        ConstantSymbol symbol;
-        if( auto query = settings.symbols.findSymbol( settings.fileId, *arrayIdentifier ) ) {
-            if( auto constant = std::get_if< ConstantSymbol >( &query->symbol ) ) {
-                symbol = *constant;
-            } else {
-                Error{ "Internal compiler error (symbol not constant symbol as expected)", settings.nearestToken }.throwException();
-            }
-        } else {
-            Error{ "Internal compiler error (cannot find expected symbol)", settings.nearestToken }.throwException();
+        const ConstantSymbol* symbol = settings.symbols.findConstant( settings.fileId, *arrayIdentifier );
+        if( !symbol ) {
+            return Error{ "Internal compiler error (cannot find expected constant symbol)", settings.nearestSpan };
         }
 
         // Get the dimensions out of the symbol type
-        std::vector< long > dimensions;
-        if( auto asArrayType = std::get_if< SymbolArrayType >( &symbol.type ) ) {
-            dimensions = asArrayType->dimensions;
-        } else {
-            Error{ "Internal compiler error (expected constant type to be array)", settings.nearestToken }.throwException();
+        const SymbolArrayType* asArrayType = std::get_if< SymbolArrayType >( &symbol->type );
+        if( !asArrayType ) {
+            return Error{ "Internal compiler error (expected constant type to be array)", settings.nearestSpan };
         }
 
         // Convert the ArrayExpression index expressions to actual indices
         std::vector< long > indices;
-        for( const auto& expression : node.indices ) {
-            evaluateConstantExpression( *expression, settings );
-            ConstantExpressionValue index = settings.stack.top();
+        if( auto error = evaluateIndices( node, asArrayType->dimensions, settings, indices ) ) {
+            return error;
+        }
+
+        if( auto integerArray = std::get_if< ConstantIntegerArray >( &array ) ) {
+            settings.stack.push( integerArray->at( flattenArrayIndex( *asArrayType, indices ) ) );
+        } else if( auto stringArray = std::get_if< ConstantStringArray >( &array ) ) {
+            settings.stack.push( stringArray->at( flattenArrayIndex( *asArrayType, indices ) ) );
+        } else {
+            return Error{ "Internal compiler error (unexpected ConstantExpressionValue array encountered)", settings.nearestSpan };
+        }
+
+        return {};
+    }
+
+    // Limits on interpreting calls for a single constant, so a runaway loop or recursion fails the build instead of hanging it
+    static const long CONST_CALL_STEPS = 1000000;
+    static const size_t CONST_CALL_DEPTH = 256;
+
+    struct ConstReturn {
+        bool returned = false;
+        std::optional< ConstantExpressionValue > value;
+    };
+
+    static std::optional< Error > interpret( const std::vector< std::unique_ptr< Declaration > >& body, ConstEvaluationSettings settings, ConstReturn& result );
+
+    ConstantExpressionValue narrowToType( ConstantExpressionValue value, TokenType type ) {
+        long* integer = std::get_if< long >( &value );
+        if( !integer ) {
+            return value;
+        }
+
+        switch( type ) {
+            case TokenType::TOKEN_U8: return ( long ) ( uint8_t ) *integer;
+            case TokenType::TOKEN_U16: return ( long ) ( uint16_t ) *integer;
+            case TokenType::TOKEN_U32: return ( long ) ( uint32_t ) *integer;
+            case TokenType::TOKEN_S8: return ( long ) ( int8_t ) *integer;
+            case TokenType::TOKEN_S16: return ( long ) ( int16_t ) *integer;
+            case TokenType::TOKEN_S32: return ( long ) ( int32_t ) *integer;
+            default: return value;
+        }
+    }
+
+    static bool isStorableType( TokenType type ) {
+        switch( type ) {
+            case TokenType::TOKEN_U8:
+            case TokenType::TOKEN_U16:
+            case TokenType::TOKEN_U32:
+            case TokenType::TOKEN_S8:
+            case TokenType::TOKEN_S16:
+            case TokenType::TOKEN_S32:
+            case TokenType::TOKEN_STRING:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static std::optional< Error > evaluateInto( const Expression& node, ConstEvaluationSettings settings, ConstantExpressionValue& value ) {
+        if( auto error = evaluateConstantExpression( node, settings ) ) {
+            return error;
+        }
+
+        value = std::move( settings.stack.top() );
+        settings.stack.pop();
+        return {};
+    }
+
+    static std::optional< Error > evaluateInto( const Expression& node, ConstEvaluationSettings settings, long& value ) {
+        ConstantExpressionValue result;
+        if( auto error = evaluateInto( node, settings, result ) ) {
+            return error;
+        }
+
+        if( auto integer = std::get_if< long >( &result ) ) {
+            value = *integer;
+            return {};
+        }
+
+        return Error{ "Expected integer value in function evaluated at compile time", settings.nearestSpan };
+    }
+
+    static ConstantExpressionValue defaultValue( TokenType type ) {
+        return type == TokenType::TOKEN_STRING ? ConstantExpressionValue{ std::string() } : ConstantExpressionValue{ 0L };
+    }
+
+    // An integer stored in a string element becomes its decimal text, as it would on the target
+    static ConstantExpressionValue storeElement( ConstantExpressionValue value, TokenType type ) {
+        if( type == TokenType::TOKEN_STRING ) {
+            if( auto integer = std::get_if< long >( &value ) ) {
+                return std::to_string( *integer );
+            }
+
+            return value;
+        }
+
+        return narrowToType( std::move( value ), type );
+    }
+
+    /**
+     * Make an array local of type, each element set to the default value of its type
+     */
+    static std::optional< Error > makeArrayLocal( const DataType& type, ConstEvaluationSettings settings, ConstantLocal& local ) {
+        std::vector< long > dimensions;
+        long count = 1;
+        for( const Token& dimension : type.arrayDimensions ) {
+            Primary primary{ dimension };
+            long size;
+            if( auto error = evaluateConstantExpression( primary, settings ) ) {
+                return error;
+            }
+            ConstantExpressionValue value = std::move( settings.stack.top() );
             settings.stack.pop();
 
-            if( auto asIndex = std::get_if< long >( &index ) ) {
-                indices.push_back( *asIndex );
+            if( auto integer = std::get_if< long >( &value ) ) {
+                size = *integer;
             } else {
-                Error{ "Expected numeric constant expression for array index", settings.nearestToken }.throwException();
+                return Error{ "Expected integer array size in function evaluated at compile time", dimension.span };
             }
+
+            if( size <= 0 || size > CONST_CALL_STEPS / count ) {
+                return Error{ "Array size " + std::to_string( size ) + " cannot be evaluated at compile time", dimension.span };
+            }
+
+            dimensions.push_back( size );
+            count *= size;
         }
 
-        if( auto longArray = std::get_if< std::vector< long > >( &array ) ) {
-            const auto& arr = *longArray;
-            settings.stack.push( arr.at( flattenArrayIndex( dimensions, indices ) ) );
-        } else if( auto stringArray = std::get_if< std::vector< std::string > >( &array ) ) {
-            const auto& arr = *stringArray;
-            settings.stack.push( arr.at( flattenArrayIndex( dimensions, indices ) ) );
-        } else {
-            Error{ "Internal compiler error (unexpected ConstantExpressionValue array encountered)", settings.nearestToken }.throwException();
+        local = ConstantLocal{
+            0L,
+            type.type.type,
+            makeArrayType( std::move( dimensions ), SymbolNativeType{ type.type.type } ),
+            std::vector< ConstantExpressionValue >( count, defaultValue( type.type.type ) )
+        };
+        return {};
+    }
+
+    // Fill an array local from a whole array value, which must have as many elements of the same kind
+    static std::optional< Error > unpackArray( const ConstantExpressionValue& value, ConstantLocal& local, SourceSpan span ) {
+        size_t count = local.elements.size();
+        if( auto integers = std::get_if< ConstantIntegerArray >( &value ) ) {
+            if( integers->size() == count && local.type != TokenType::TOKEN_STRING ) {
+                for( size_t i = 0; i != count; i++ ) {
+                    local.elements[ i ] = narrowToType( integers->at( i ), local.type );
+                }
+                return {};
+            }
+        } else if( auto strings = std::get_if< ConstantStringArray >( &value ) ) {
+            if( strings->size() == count && local.type == TokenType::TOKEN_STRING ) {
+                for( size_t i = 0; i != count; i++ ) {
+                    local.elements[ i ] = strings->at( i );
+                }
+                return {};
+            }
+        }
+
+        return Error{ "Expected an array of " + std::to_string( count ) + " elements in function evaluated at compile time", span };
+    }
+
+    // Pack an array local into the shared, width-packed form constants are stored in
+    static ConstantExpressionValue packArray( const ConstantLocal& local ) {
+        if( local.type == TokenType::TOKEN_STRING ) {
+            std::vector< std::string > values;
+            for( const ConstantExpressionValue& element : local.elements ) {
+                values.push_back( std::get< std::string >( element ) );
+            }
+
+            return ConstantStringArray( std::move( values ) );
+        }
+
+        std::vector< long > values;
+        for( const ConstantExpressionValue& element : local.elements ) {
+            values.push_back( std::get< long >( element ) );
+        }
+
+        return ConstantIntegerArray::pack( values, local.type );
+    }
+
+    static std::optional< Error > step( ConstEvaluationSettings settings ) {
+        if( settings.calls->stepsLeft-- <= 0 ) {
+            return Error{ "Compile-time evaluation exceeded its budget of " + std::to_string( CONST_CALL_STEPS ) + " steps", settings.nearestSpan };
         }
+
+        return {};
     }
 
-    static void evaluateConstantExpression( const Expression& node, ConstEvaluationSettings settings ) {
+    static std::optional< Error > declareLocal( const Parameter& variable, std::optional< ConstantExpressionValue > value, ConstEvaluationSettings settings ) {
+        auto name = getIdentifierName( variable.name );
+        TokenType type = variable.type.type.type;
+        if( !name || !isStorableType( type ) ) {
+            return Error{ "Only integer and string locals, and arrays of them, are supported in a function evaluated at compile time", variable.name.span };
+        }
+
+        if( variable.type.arrayDimensions.empty() ) {
+            ( *settings.locals )[ *name ] = ConstantLocal{ value ? narrowToType( std::move( *value ), type ) : defaultValue( type ), type, {}, {} };
+            return {};
+        }
+
+        ConstantLocal local;
+        if( auto error = makeArrayLocal( variable.type, settings, local ) ) {
+            return error;
+        }
+        if( value ) {
+            if( auto error = unpackArray( *value, local, variable.name.span ) ) {
+                return error;
+            }
+        }
+
+        ( *settings.locals )[ *name ] = std::move( local );
+        return {};
+    }
+
+    static std::optional< Error > interpret( const VarDeclaration& node, ConstEvaluationSettings settings ) {
+        std::optional< ConstantExpressionValue > value;
+        if( node.value ) {
+            value.emplace();
+            if( auto error = evaluateInto( **node.value, settings, *value ) ) {
+                return error;
+            }
+        }
+
+        return declareLocal( node.variable, std::move( value ), settings );
+    }
+
+    static std::optional< Error > interpret( const IfStatement& node, ConstEvaluationSettings settings, ConstReturn& result ) {
+        for( size_t i = 0; i != node.conditions.size(); i++ ) {
+            long condition;
+            if( auto error = evaluateInto( *node.conditions[ i ], settings, condition ) ) {
+                return error;
+            }
+
+            if( condition ) {
+                return interpret( node.bodies[ i ], settings, result );
+            }
+        }
+
+        // One more body than conditions means there is an else
+        if( node.bodies.size() > node.conditions.size() ) {
+            return interpret( node.bodies.back(), settings, result );
+        }
+
+        return {};
+    }
+
+    static std::optional< Error > interpret( const WhileStatement& node, ConstEvaluationSettings settings, ConstReturn& result ) {
+        while( !result.returned ) {
+            if( auto error = step( settings ) ) {
+                return error;
+            }
+
+            long condition;
+            if( auto error = evaluateInto( *node.condition, settings, condition ) ) {
+                return error;
+            }
+
+            if( !condition ) {
+                break;
+            }
+
+            if( auto error = interpret( node.body, settings, result ) ) {
+                return error;
+            }
+        }
+
+        return {};
+    }
+
+    static std::optional< Error > interpret( const ForStatement& node, ConstEvaluationSettings settings, ConstReturn& result ) {
+        auto name = getIdentifierName( node.index );
+        if( !name ) {
+            return Error{ "Expected: Identifier as index of ForStatement", node.index.span };
+        }
+
+        // Both ends are inclusive, and the end and step are only evaluated once
+        long from, to, every = 1;
+        if( auto error = evaluateInto( *node.from, settings, from ) ) {
+            return error;
+        }
+        if( auto error = evaluateInto( *node.to, settings, to ) ) {
+            return error;
+        }
+        if( node.every ) {
+            if( auto error = evaluateInto( **node.every, settings, every ) ) {
+                return error;
+            }
+        }
+
+        if( every == 0 ) {
+            return Error{ "For loop with a step of zero never ends", settings.nearestSpan };
+        }
+
+        ConstantLocal& index = ( *settings.locals )[ *name ] = ConstantLocal{ from, TokenType::TOKEN_S32, {}, {} };
+        while( !result.returned ) {
+            if( auto error = step( settings ) ) {
+                return error;
+            }
+
+            // The body may have assigned the index
+            const long* current = std::get_if< long >( &index.value );
+            if( !current ) {
+                return Error{ "Expected integer value for index " + *name + " in function evaluated at compile time", node.index.span };
+            }
+            if( every > 0 ? *current > to : *current < to ) {
+                break;
+            }
+
+            if( auto error = interpret( node.body, settings, result ) ) {
+                return error;
+            }
+
+            current = std::get_if< long >( &index.value );
+            if( !current ) {
+                return Error{ "Expected integer value for index " + *name + " in function evaluated at compile time", node.index.span };
+            }
+            index.value = narrowToType( wrapping( ( unsigned long ) *current + ( unsigned long ) every ), index.type );
+        }
+
+        return {};
+    }
+
+    static std::optional< Error > interpret( const Statement& node, ConstEvaluationSettings settings, ConstReturn& result ) {
+        settings.nearestSpan = node.nearestSpan;
+
+        return std::visit( overloaded {
+
+            [ &settings ]( const std::unique_ptr< ExpressionStatement >& statement ) -> std::optional< Error > {
+                ConstantExpressionValue discarded;
+                return evaluateInto( *statement->value, settings, discarded );
+            },
+            [ &settings, &result ]( const std::unique_ptr< ForStatement >& statement ) { return interpret( *statement, settings, result ); },
+            [ &settings, &result ]( const std::unique_ptr< IfStatement >& statement ) { return interpret( *statement, settings, result ); },
+            [ &settings, &result ]( const std::unique_ptr< ReturnStatement >& statement ) -> std::optional< Error > {
+                if( statement->expression ) {
+                    ConstantExpressionValue value;
+                    if( auto error = evaluateInto( **statement->expression, settings, value ) ) {
+                        return error;
+                    }
+                    result.value = std::move( value );
+                }
+
+                result.returned = true;
+                return {};
+            },
+            [ &settings ]( const std::unique_ptr< AsmStatement >& ) -> std::optional< Error > {
+                return Error{ "Inline asm cannot be evaluated at compile time", settings.nearestSpan };
+            },
+            [ &settings, &result ]( const std::unique_ptr< WhileStatement >& statement ) { return interpret( *statement, settings, result ); }
+
+        }, node.value );
+    }
+
+    static std::optional< Error > interpret( const std::vector< std::unique_ptr< Declaration > >& body, ConstEvaluationSettings settings, ConstReturn& result ) {
+        for( const auto& declaration : body ) {
+            settings.nearestSpan = declaration->nearestSpan;
+            if( auto error = step( settings ) ) {
+                return error;
+            }
+
+            std::optional< Error > error;
+            if( auto statement = std::get_if< std::unique_ptr< Statement > >( &declaration->value ) ) {
+                error = interpret( **statement, settings, result );
+            } else if( auto variable = std::get_if< std::unique_ptr< VarDeclaration > >( &declaration->value ) ) {
+                error = interpret( **variable, settings );
+            } else if( auto constant = std::get_if< std::unique_ptr< ConstDeclaration > >( &declaration->value ) ) {
+                ConstantExpressionValue value;
+                error = evaluateInto( *( *constant )->value, settings, value );
+                if( !error ) {
+                    error = declareLocal( ( *constant )->variable, std::move( value ), settings );
+                }
+            } else {
+                error = Error{ "Only statements, def and const can be evaluated at compile time", settings.nearestSpan };
+            }
+
+            if( error ) {
+                return error;
+            }
+
+            if( result.returned ) {
+                break;
+            }
+        }
+
+        return {};
+    }
+
+    /**
+     * Interpret a call to a top-level function. The function must be pure on the path taken: it may read its
+     * arguments, its locals and constants, and call other such functions, but may not touch globals or use asm.
+     */
+    static std::optional< Error > evaluateConstantExpression( const CallExpression& node, ConstEvaluationSettings settings ) {
+        if( !settings.functions ) {
+            return Error{ "Expression contains non-constant part and cannot be evaluated at compile-time", settings.nearestSpan };
+        }
+
+        std::optional< std::string > name = getIdentifierName( *node.identifier );
+        if( !name ) {
+            return Error{ "Only calls to top-level functions can be evaluated at compile time", settings.nearestSpan };
+        }
+
+        auto function = settings.functions->declarations.find( *name );
+        if( function == settings.functions->declarations.end() ) {
+            return Error{ "Function " + *name + " must be declared before a constant that calls it", settings.nearestSpan };
+        }
+        const FunctionDeclaration& declaration = *function->second;
+
+        if( settings.functions->verify && !settings.functions->verify( declaration ) ) {
+            return Error{ "Function " + *name + " does not verify, so it cannot be evaluated at compile time", settings.nearestSpan };
+        }
+
+        if( !declaration.returnType || !isStorableType( declaration.returnType->type.type ) ) {
+            return Error{ "Function " + *name + " must return an integer or string, or an array of them, to be evaluated at compile time", settings.nearestSpan };
+        }
+
+        if( node.arguments.size() != declaration.arguments.size() ) {
+            return Error{ "Function " + *name + " expects " + std::to_string( declaration.arguments.size() ) + " arguments", settings.nearestSpan };
+        }
+
+        if( settings.calls->depth == CONST_CALL_DEPTH ) {
+            return Error{ "Compile-time evaluation of " + *name + " recursed more than " + std::to_string( CONST_CALL_DEPTH ) + " calls deep", settings.nearestSpan };
+        }
+
+        // Arguments are evaluated in the caller's frame, then bound in the callee's
+        std::map< std::string, ConstantLocal > locals;
+        ConstEvaluationSettings callSettings = settings;
+        callSettings.locals = &locals;
+        for( size_t i = 0; i != node.arguments.size(); i++ ) {
+            ConstantExpressionValue argument;
+            if( auto error = evaluateInto( *node.arguments[ i ], settings, argument ) ) {
+                return error;
+            }
+
+            if( auto error = declareLocal( declaration.arguments[ i ], std::move( argument ), callSettings ) ) {
+                return error;
+            }
+        }
+
+        ConstReturn result;
+        settings.calls->depth++;
+        std::optional< Error > error = interpret( declaration.body, callSettings, result );
+        settings.calls->depth--;
+
+        if( error ) {
+            // Named once, after the call the constant made, however deep the error was
+            if( settings.calls->depth == 0 ) {
+                error->text = "While evaluating " + *name + " at compile time: " + error->text;
+            }
+            return error;
+        }
+
+        if( !result.value ) {
+            return Error{ "Function " + *name + " ended without returning a value at compile time", settings.nearestSpan };
+        }
+
+        if( declaration.returnType->arrayDimensions.empty() ) {
+            settings.stack.push( narrowToType( std::move( *result.value ), declaration.returnType->type.type ) );
+            return {};
+        }
+
+        // An array comes back packed at the width of the declared element type, whatever array was returned
+        ConstantLocal returned;
+        if( auto error = makeArrayLocal( *declaration.returnType, settings, returned ) ) {
+            return error;
+        }
+        if( auto error = unpackArray( *result.value, returned, settings.nearestSpan ) ) {
+            return error;
+        }
+
+        settings.stack.push( packArray( returned ) );
+        return {};
+    }
+
+    static std::optional< Error > evaluateConstantExpression( const AssignmentExpression& node, ConstEvaluationSettings settings ) {
+        if( !settings.locals ) {
+            return Error{ "Expression contains non-constant part and cannot be evaluated at compile-time", settings.nearestSpan };
+        }
+
+        // An element of an array local
+        if( auto element = std::get_if< std::unique_ptr< ArrayExpression > >( &node.identifier->value ) ) {
+            std::optional< std::string > name = getIdentifierName( *( *element )->identifier );
+            auto local = name ? settings.locals->find( *name ) : settings.locals->end();
+            if( local == settings.locals->end() || !local->second.arrayType ) {
+                return Error{ "Only elements of local arrays can be assigned in a function evaluated at compile time", settings.nearestSpan };
+            }
+
+            std::vector< long > indices;
+            if( auto error = evaluateIndices( **element, local->second.arrayType->dimensions, settings, indices ) ) {
+                return error;
+            }
+
+            ConstantExpressionValue value;
+            if( auto error = evaluateInto( *node.expression, settings, value ) ) {
+                return error;
+            }
+
+            ConstantExpressionValue& target = local->second.elements[ flattenArrayIndex( *local->second.arrayType, indices ) ];
+            target = storeElement( std::move( value ), local->second.type );
+            settings.stack.push( target );
+            return {};
+        }
+
+        std::optional< std::string > name = getIdentifierName( *node.identifier );
+        auto local = name ? settings.locals->find( *name ) : settings.locals->end();
+        if( local == settings.locals->end() ) {
+            return Error{ "Only locals can be assigned in a function evaluated at compile time", settings.nearestSpan };
+        }
+
+        ConstantExpressionValue value;
+        if( auto error = evaluateInto( *node.expression, settings, value ) ) {
+            return error;
+        }
+
+        ConstantLocal& target = local->second;
+        if( target.arrayType ) {
+            if( auto error = unpackArray( value, target, settings.nearestSpan ) ) {
+                return error;
+            }
+            settings.stack.push( std::move( value ) );
+            return {};
+        }
+
+        target.value = narrowToType( std::move( value ), target.type );
+        settings.stack.push( target.value );
+        return {};
+    }
+
+    static std::optional< Error > evaluateConstantExpression( const Expression& node, ConstEvaluationSettings settings ) {
         if( auto primary = std::get_if< std::unique_ptr< Primary > >( &node.value ) ) {
             return evaluateConstantExpression( **primary, settings );
         }
@@ -426,12 +1082,507 @@ namespace GoldScorpion {
             return evaluateConstantExpression( **array, settings );
         }
 
-        Error{ "Expression contains non-constant part and cannot be evaluated at compile-time", settings.nearestToken }.throwException();
+        if( auto call = std::get_if< std::unique_ptr< CallExpression > >( &node.value ) ) {
+            return evaluateConstantExpression( **call, settings );
+        }
+
+        if( auto assignment = std::get_if< std::unique_ptr< AssignmentExpression > >( &node.value ) ) {
+            return evaluateConstantExpression( **assignment, settings );
+        }
+
+        return Error{ "Expression contains non-constant part and cannot be evaluated at compile-time", settings.nearestSpan };
+    }
+
+    Result< ConstantExpressionValue, Error > evaluateConst( const Expression& node, ConstEvaluationSettings settings ) {
+        Phase phase( settings.fileId, "const-eval" );
+        GS_COUNT( EVALUATE_CONST_CALLS );
+
+        ConstCallState calls{ CONST_CALL_STEPS, 0 };
+        if( !settings.calls ) {
+            settings.calls = &calls;
+        }
+
+        if( auto error = evaluateConstantExpression( node, settings ) ) {
+            return Result< ConstantExpressionValue, Error >::err( std::move( *error ) );
+        }
+
+        return Result< ConstantExpressionValue, Error >::good( settings.stack.top() );
+    }
+
+    struct FoldSettings {
+        std::string fileId;
+        SymbolResolver& symbols;
+        bool withinFunction;
+    };
+
+    struct FoldFunction {
+        FunctionDeclaration* node;
+        std::optional< std::string > contextTypeId;
+    };
+
+    static bool foldExpression( std::unique_ptr< Expression >& node, FoldSettings settings );
+    static void foldDeclarations( std::vector< std::unique_ptr< Declaration > >& body, FoldSettings settings );
+
+    static SymbolType getDeclaredType( const DataType& type ) {
+        if( auto typeId = getIdentifierName( type.type ) ) {
+            return SymbolUdtType{ *typeId };
+        }
+
+        return SymbolNativeType{ type.type.type };
+    }
+
+    static void addLocal( const Parameter& variable, FoldSettings settings ) {
+        // Only here to shadow any constant of the same name, so array dimensions are not needed
+        if( auto name = getIdentifierName( variable.name ) ) {
+            settings.symbols.addSymbol( settings.fileId, Symbol{ VariableSymbol{ *name, getDeclaredType( variable.type ) }, false } );
+        }
+    }
+
+    // Only whole expressions carry a span from the parser; anything inside one is placed at its first token
+    static SourceSpan getLeadingSpan( const Expression& node ) {
+        if( node.nearestSpan ) {
+            return node.nearestSpan;
+        }
+
+        return std::visit( overloaded {
+
+            []( const std::unique_ptr< AssignmentExpression >& expression ) { return getLeadingSpan( *expression->identifier ); },
+            []( const std::unique_ptr< BinaryExpression >& expression ) { return getLeadingSpan( *expression->lhsValue ); },
+            []( const std::unique_ptr< UnaryExpression >& expression ) {
+                auto op = std::get_if< Token >( &expression->op->value );
+                return op ? op->span : getLeadingSpan( *expression->value );
+            },
+            []( const std::unique_ptr< CallExpression >& expression ) { return getLeadingSpan( *expression->identifier ); },
+            []( const std::unique_ptr< ArrayExpression >& expression ) { return getLeadingSpan( *expression->identifier ); },
+            []( const std::unique_ptr< Primary >& primary ) {
+                if( auto subexpression = std::get_if< std::unique_ptr< Expression > >( &primary->value ) ) {
+                    return getLeadingSpan( **subexpression );
+                }
+
+                return std::get< Token >( primary->value ).span;
+            }
+
+        }, node.value );
+    }
+
+    static void replaceWithLiteral( std::unique_ptr< Expression >& node, ConstantExpressionValue value, FoldSettings settings ) {
+        SourceSpan span = getLeadingSpan( *node );
+        Primary literal{ Token{ TokenType::TOKEN_LITERAL_STRING, {}, span } };
+        if( auto integer = std::get_if< long >( &value ) ) {
+            // The literal keeps the type the expression had, so the folded tree checks exactly as the original did
+            SymbolTypeResult type = getType( *node, SymbolTypeSettings{ settings.fileId, settings.symbols } );
+            const SymbolNativeType* nativeType = type ? std::get_if< SymbolNativeType >( &*type ) : nullptr;
+            if( !nativeType ) {
+                return;
+            }
+
+            long narrowed = std::get< long >( narrowToType( *integer, nativeType->type ) );
+            literal = Primary{ Token{ TokenType::TOKEN_LITERAL_INTEGER, narrowed, span }, nativeType->type };
+        } else if( auto string = std::get_if< std::string >( &value ) ) {
+            std::get< Token >( literal.value ).value = std::move( *string );
+        } else {
+            return;
+        }
+
+        node->value = std::make_unique< Primary >( std::move( literal ) );
+        GS_COUNT( FOLDED_EXPRESSIONS );
+    }
+
+    /**
+     * Replace an expression whose operands are all constant with the literal it evaluates to. Returns whether
+     * the expression is constant; a constant array is, but stays as it is, because only its elements have a
+     * literal form.
+     */
+    static bool foldNode( std::unique_ptr< Expression >& node, FoldSettings settings ) {
+        if( auto primary = std::get_if< std::unique_ptr< Primary > >( &node->value ) ) {
+            if( auto token = std::get_if< Token >( &( *primary )->value ) ) {
+                if( token->type == TokenType::TOKEN_LITERAL_INTEGER || token->type == TokenType::TOKEN_LITERAL_STRING ) {
+                    return true;
+                }
+            }
+        }
+
+        // Operands are already folded, so this only ever looks one level down
+        std::stack< ConstantExpressionValue > stack;
+        if( evaluateConstantExpression( *node, ConstEvaluationSettings{ settings.fileId, stack, settings.symbols, getLeadingSpan( *node ) } ) ) {
+            // Division by zero and the like are left in place to fail the same way at runtime
+            return false;
+        }
+
+        ConstantExpressionValue value = std::move( stack.top() );
+        if( !constantIsArray( value ) ) {
+            replaceWithLiteral( node, std::move( value ), settings );
+        }
+
+        return true;
+    }
+
+    /**
+     * Fold everything below an expression without replacing the expression itself. Returns whether every
+     * operand is constant.
+     */
+    static bool foldOperands( Expression& node, FoldSettings settings ) {
+        return std::visit( overloaded {
+
+            [ &settings ]( std::unique_ptr< AssignmentExpression >& expression ) {
+                // Only the array indices of the target can be folded
+                foldOperands( *expression->identifier, settings );
+                foldExpression( expression->expression, settings );
+                return false;
+            },
+            [ &settings ]( std::unique_ptr< BinaryExpression >& expression ) {
+                auto op = std::get_if< Token >( &expression->op->value );
+                if( op && op->type == TokenType::TOKEN_DOT ) {
+                    // The right hand side names a field, which could collide with a constant
+                    foldOperands( *expression->lhsValue, settings );
+                    foldOperands( *expression->rhsValue, settings );
+                    return false;
+                }
+
+                bool lhsConstant = foldExpression( expression->lhsValue, settings );
+                bool rhsConstant = foldExpression( expression->rhsValue, settings );
+                return lhsConstant && rhsConstant;
+            },
+            [ &settings ]( std::unique_ptr< UnaryExpression >& expression ) {
+                return foldExpression( expression->value, settings );
+            },
+            [ &settings ]( std::unique_ptr< CallExpression >& expression ) {
+                foldOperands( *expression->identifier, settings );
+                for( auto& argument : expression->arguments ) {
+                    foldExpression( argument, settings );
+                }
+                return false;
+            },
+            [ &settings ]( std::unique_ptr< ArrayExpression >& expression ) {
+                bool constant = foldOperands( *expression->identifier, settings );
+                for( auto& index : expression->indices ) {
+                    constant = foldExpression( index, settings ) && constant;
+                }
+                return constant;
+            },
+            [ &settings ]( std::unique_ptr< Primary >& primary ) {
+                if( auto subexpression = std::get_if< std::unique_ptr< Expression > >( &primary->value ) ) {
+                    return foldExpression( *subexpression, settings );
+                }
+
+                const Token& token = std::get< Token >( primary->value );
+                if( auto name = getIdentifierName( token ) ) {
+                    return settings.symbols.findConstant( settings.fileId, *name ) != nullptr;
+                }
+
+                return token.type == TokenType::TOKEN_LITERAL_INTEGER || token.type == TokenType::TOKEN_LITERAL_STRING;
+            }
+
+        }, node.value );
+    }
+
+    static bool foldExpression( std::unique_ptr< Expression >& node, FoldSettings settings ) {
+        return foldOperands( *node, settings ) && foldNode( node, settings );
+    }
+
+    static void foldFunction( FunctionDeclaration& node, const std::optional< std::string >& contextTypeId, FoldSettings settings ) {
+        settings.symbols.openScope( settings.fileId );
+        settings.withinFunction = true;
+
+        for( const Parameter& argument : node.arguments ) {
+            addLocal( argument, settings );
+        }
+        if( contextTypeId ) {
+            settings.symbols.addSymbol( settings.fileId, Symbol{ VariableSymbol{ "this", SymbolUdtType{ *contextTypeId } }, false } );
+        }
+
+        foldDeclarations( node.body, settings );
+        settings.symbols.closeScope( settings.fileId );
+    }
+
+    static void foldScope( std::vector< std::unique_ptr< Declaration > >& body, FoldSettings settings, const std::optional< Token >& index = {} ) {
+        settings.symbols.openScope( settings.fileId );
+        if( index ) {
+            if( auto name = getIdentifierName( *index ) ) {
+                settings.symbols.addSymbol( settings.fileId, Symbol{ VariableSymbol{ *name, SymbolNativeType{ TokenType::TOKEN_S32 } }, false } );
+            }
+        }
+
+        foldDeclarations( body, settings );
+        settings.symbols.closeScope( settings.fileId );
+    }
+
+    static void foldStatement( Statement& node, FoldSettings settings ) {
+        std::visit( overloaded {
+
+            [ &settings ]( std::unique_ptr< ExpressionStatement >& statement ) { foldExpression( statement->value, settings ); },
+            [ &settings ]( std::unique_ptr< ForStatement >& statement ) {
+                foldExpression( statement->from, settings );
+                foldExpression( statement->to, settings );
+                if( statement->every ) {
+                    foldExpression( *statement->every, settings );
+                }
+                foldScope( statement->body, settings, statement->index );
+            },
+            [ &settings ]( std::unique_ptr< IfStatement >& statement ) {
+                for( auto& condition : statement->conditions ) {
+                    foldExpression( condition, settings );
+                }
+                for( auto& body : statement->bodies ) {
+                    foldScope( body, settings );
+                }
+            },
+            [ &settings ]( std::unique_ptr< ReturnStatement >& statement ) {
+                if( statement->expression ) {
+                    foldExpression( *statement->expression, settings );
+                }
+            },
+            []( std::unique_ptr< AsmStatement >& ) {},
+            [ &settings ]( std::unique_ptr< WhileStatement >& statement ) {
+                foldExpression( statement->condition, settings );
+                foldScope( statement->body, settings );
+            }
+
+        }, node.value );
+    }
+
+    static void foldDeclaration( Declaration& node, FoldSettings settings ) {
+        std::visit( overloaded {
+
+            // Directives are read by name by the platform annotation packages
+            []( std::unique_ptr< Annotation >& ) {},
+            [ &settings ]( std::unique_ptr< VarDeclaration >& declaration ) {
+                if( declaration->value ) {
+                    foldExpression( *declaration->value, settings );
+                }
+
+                // Top-level symbols are already in the table
+                if( settings.withinFunction ) {
+                    addLocal( declaration->variable, settings );
+                }
+            },
+            [ &settings ]( std::unique_ptr< ConstDeclaration >& declaration ) {
+                bool constant = foldExpression( declaration->value, settings );
+                auto name = getIdentifierName( declaration->variable.name );
+                if( !settings.withinFunction ) {
+                    // Whatever is left, such as a call evaluated at compile time, has its value in the table already
+                    const ConstantSymbol* symbol = name ? settings.symbols.findConstant( settings.fileId, *name ) : nullptr;
+                    if( !constant && symbol ) {
+                        replaceWithLiteral( declaration->value, symbol->value, settings );
+                    }
+                    return;
+                }
+
+                std::stack< ConstantExpressionValue > stack;
+                if( !name || !constant || declaration->variable.type.arrayDimensions.size() ||
+                    evaluateConstantExpression( *declaration->value, ConstEvaluationSettings{ settings.fileId, stack, settings.symbols, declaration->value->nearestSpan } ) ) {
+                    addLocal( declaration->variable, settings );
+                    return;
+                }
+
+                settings.symbols.addSymbol( settings.fileId, Symbol{ ConstantSymbol{ *name, getDeclaredType( declaration->variable.type ), std::move( stack.top() ) }, false } );
+            },
+            [ &settings ]( std::unique_ptr< FunctionDeclaration >& declaration ) { foldFunction( *declaration, {}, settings ); },
+            [ &settings ]( std::unique_ptr< TypeDeclaration >& declaration ) {
+                auto typeId = getIdentifierName( declaration->name );
+                for( auto& function : declaration->functions ) {
+                    foldFunction( *function, typeId, settings );
+                }
+            },
+            []( std::unique_ptr< ImportDeclaration >& ) {},
+            [ &settings ]( std::unique_ptr< Statement >& declaration ) { foldStatement( *declaration, settings ); }
+
+        }, node.value );
+    }
+
+    static void foldDeclarations( std::vector< std::unique_ptr< Declaration > >& body, FoldSettings settings ) {
+        for( auto& declaration : body ) {
+            foldDeclaration( *declaration, settings );
+        }
+    }
+
+    /**
+     * Replace every constant subexpression in a verified program with a single literal: constant references,
+     * constant array elements, arithmetic on literals and string concatenation. symbols must be the table the
+     * program was verified against. Function bodies are folded in parallel, each against its own fork of it.
+     */
+    void foldConstants( const std::string& fileId, Program& program, const SymbolResolver& symbols ) {
+        SymbolResolver fileSymbols = symbols.fork();
+        FoldSettings settings{ fileId, fileSymbols, false };
+
+        std::vector< FoldFunction > functions;
+        for( auto& declaration : program.statements ) {
+            if( auto function = std::get_if< std::unique_ptr< FunctionDeclaration > >( &declaration->value ) ) {
+                functions.push_back( FoldFunction{ function->get(), {} } );
+            } else if( auto type = std::get_if< std::unique_ptr< TypeDeclaration > >( &declaration->value ) ) {
+                for( auto& function : ( *type )->functions ) {
+                    functions.push_back( FoldFunction{ function.get(), getIdentifierName( ( *type )->name ) } );
+                }
+            } else {
+                foldDeclaration( *declaration, settings );
+            }
+        }
+
+        Utility::parallelFor( functions.size(), [ & ]( size_t i ) {
+            SymbolResolver scopedSymbols = symbols.fork();
+            foldFunction( *functions[ i ].node, functions[ i ].contextTypeId, FoldSettings{ fileId, scopedSymbols, false } );
+        } );
+    }
+
+    static std::unique_ptr< Expression > copyExpression( const Expression& node );
+    static std::unique_ptr< Declaration > copyDeclaration( const Declaration& node );
+
+    static std::vector< std::unique_ptr< Expression > > copyExpressions( const std::vector< std::unique_ptr< Expression > >& nodes ) {
+        std::vector< std::unique_ptr< Expression > > result;
+        for( const auto& node : nodes ) {
+            result.push_back( copyExpression( *node ) );
+        }
+
+        return result;
+    }
+
+    static std::vector< std::unique_ptr< Declaration > > copyDeclarations( const std::vector< std::unique_ptr< Declaration > >& nodes ) {
+        std::vector< std::unique_ptr< Declaration > > result;
+        for( const auto& node : nodes ) {
+            result.push_back( copyDeclaration( *node ) );
+        }
+
+        return result;
+    }
+
+    static std::unique_ptr< Primary > copyPrimary( const Primary& node ) {
+        if( auto token = std::get_if< Token >( &node.value ) ) {
+            return std::make_unique< Primary >( Primary{ *token, node.foldedType } );
+        }
+
+        return std::make_unique< Primary >( Primary{ copyExpression( *std::get< std::unique_ptr< Expression > >( node.value ) ), node.foldedType } );
+    }
+
+    static std::unique_ptr< Expression > copyExpression( const Expression& node ) {
+        return std::visit( overloaded {
+            [ &node ]( const std::unique_ptr< AssignmentExpression >& expression ) {
+                return std::make_unique< Expression >( Expression{ std::make_unique< AssignmentExpression >( AssignmentExpression{
+                    copyExpression( *expression->identifier ), copyExpression( *expression->expression )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< BinaryExpression >& expression ) {
+                return std::make_unique< Expression >( Expression{ std::make_unique< BinaryExpression >( BinaryExpression{
+                    copyExpression( *expression->lhsValue ), copyPrimary( *expression->op ), copyExpression( *expression->rhsValue )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< UnaryExpression >& expression ) {
+                return std::make_unique< Expression >( Expression{ std::make_unique< UnaryExpression >( UnaryExpression{
+                    copyPrimary( *expression->op ), copyExpression( *expression->value )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< CallExpression >& expression ) {
+                return std::make_unique< Expression >( Expression{ std::make_unique< CallExpression >( CallExpression{
+                    copyExpression( *expression->identifier ), copyExpressions( expression->arguments )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< ArrayExpression >& expression ) {
+                return std::make_unique< Expression >( Expression{ std::make_unique< ArrayExpression >( ArrayExpression{
+                    copyExpression( *expression->identifier ), copyExpressions( expression->indices )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< Primary >& expression ) {
+                return std::make_unique< Expression >( Expression{ copyPrimary( *expression ), node.nearestSpan } );
+            }
+        }, node.value );
+    }
+
+    static std::optional< std::unique_ptr< Expression > > copyOptionalExpression( const std::optional< std::unique_ptr< Expression > >& node ) {
+        if( !node ) {
+            return {};
+        }
+
+        return copyExpression( **node );
+    }
+
+    static std::unique_ptr< FunctionDeclaration > copyFunction( const FunctionDeclaration& node ) {
+        return std::make_unique< FunctionDeclaration >( FunctionDeclaration{
+            node.name, node.arguments, node.returnType, copyDeclarations( node.body )
+        } );
+    }
+
+    static std::unique_ptr< Statement > copyStatement( const Statement& node ) {
+        return std::visit( overloaded {
+            [ &node ]( const std::unique_ptr< ExpressionStatement >& statement ) {
+                return std::make_unique< Statement >( Statement{ std::make_unique< ExpressionStatement >( ExpressionStatement{
+                    copyExpression( *statement->value )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< ForStatement >& statement ) {
+                return std::make_unique< Statement >( Statement{ std::make_unique< ForStatement >( ForStatement{
+                    statement->index,
+                    copyExpression( *statement->from ),
+                    copyExpression( *statement->to ),
+                    copyOptionalExpression( statement->every ),
+                    copyDeclarations( statement->body )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< IfStatement >& statement ) {
+                std::vector< std::vector< std::unique_ptr< Declaration > > > bodies;
+                for( const auto& body : statement->bodies ) {
+                    bodies.push_back( copyDeclarations( body ) );
+                }
+
+                return std::make_unique< Statement >( Statement{ std::make_unique< IfStatement >( IfStatement{
+                    copyExpressions( statement->conditions ), std::move( bodies )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< ReturnStatement >& statement ) {
+                return std::make_unique< Statement >( Statement{ std::make_unique< ReturnStatement >( ReturnStatement{
+                    copyOptionalExpression( statement->expression )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< AsmStatement >& statement ) {
+                return std::make_unique< Statement >( Statement{ std::make_unique< AsmStatement >( *statement ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< WhileStatement >& statement ) {
+                return std::make_unique< Statement >( Statement{ std::make_unique< WhileStatement >( WhileStatement{
+                    copyExpression( *statement->condition ), copyDeclarations( statement->body )
+                } ), node.nearestSpan } );
+            }
+        }, node.value );
+    }
+
+    static std::unique_ptr< Declaration > copyDeclaration( const Declaration& node ) {
+        return std::visit( overloaded {
+            [ &node ]( const std::unique_ptr< Annotation >& declaration ) {
+                return std::make_unique< Declaration >( Declaration{ std::make_unique< Annotation >( Annotation{
+                    copyExpressions( declaration->directives )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< VarDeclaration >& declaration ) {
+                return std::make_unique< Declaration >( Declaration{ std::make_unique< VarDeclaration >( VarDeclaration{
+                    declaration->variable, copyOptionalExpression( declaration->value )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< ConstDeclaration >& declaration ) {
+                return std::make_unique< Declaration >( Declaration{ std::make_unique< ConstDeclaration >( ConstDeclaration{
+                    declaration->variable, copyExpression( *declaration->value )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< FunctionDeclaration >& declaration ) {
+                return std::make_unique< Declaration >( Declaration{ copyFunction( *declaration ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< TypeDeclaration >& declaration ) {
+                std::vector< std::unique_ptr< FunctionDeclaration > > functions;
+                for( const auto& function : declaration->functions ) {
+                    functions.push_back( copyFunction( *function ) );
+                }
+
+                return std::make_unique< Declaration >( Declaration{ std::make_unique< TypeDeclaration >( TypeDeclaration{
+                    declaration->name, declaration->fields, std::move( functions )
+                } ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< ImportDeclaration >& declaration ) {
+                return std::make_unique< Declaration >( Declaration{ std::make_unique< ImportDeclaration >( *declaration ), node.nearestSpan } );
+            },
+            [ &node ]( const std::unique_ptr< Statement >& declaration ) {
+                return std::make_unique< Declaration >( Declaration{ copyStatement( *declaration ), node.nearestSpan } );
+            }
+        }, node.value );
     }
 
-    ConstantExpressionValue evaluateConst( const Expression& node, ConstEvaluationSettings settings ) {
-        evaluateConstantExpression( node, settings );
-        return settings.stack.top();
+    Program copyProgram( const Program& program ) {
+        return Program{ copyDeclarations( program.statements ) };
     }
 
 }
\ No newline at end of file
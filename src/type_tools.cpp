@@ -1,8 +1,8 @@
 #include "type_tools.hpp"
 #include "tree_tools.hpp"
 #include "variant_visitor.hpp"
-#include "error.hpp"
 #include "utility.hpp"
+#include "stats.hpp"
 
 namespace GoldScorpion {
 
@@ -34,26 +34,24 @@ namespace GoldScorpion {
 		}
 	}
 
-	static long expectLong( const Token& token ) {
+	static std::optional< long > expectLong( const Token& token ) {
 		if( token.value ) {
 			if( auto longValue = std::get_if< long >( &*( token.value ) ) ) {
 				return *longValue;
 			}
 		}
 
-		Error{ "Internal compiler error", token }.throwException();
-		return 0;
+		return {};
 	}
 
-	static std::string expectString( const Token& token ) {
+	static std::optional< std::string > expectString( const Token& token ) {
 		if( token.value ) {
 			if( auto stringValue = std::get_if< std::string >( &*( token.value ) ) ) {
 				return *stringValue;
 			}
 		}
 
-		Error{ "Internal compiler error", token }.throwException();
-		return "";
+		return {};
 	}
 
     static char getTypeComparison( const SymbolNativeType& symbolType ) {
@@ -200,14 +198,15 @@ namespace GoldScorpion {
 
         if( typeIsFunction( lhs ) ) {
             // Functions are only the same type if they contain the same arguments + return type
+            // A function type naming a symbol that can't be found never matches anything
             auto lhsFunctionQuery = settings.symbols.findSymbol( settings.fileId, getSymbolTypeId( lhs ) );
             if( !lhsFunctionQuery || !std::holds_alternative< FunctionSymbol >( lhsFunctionQuery->symbol ) ) {
-                Error{ "Internal compiler error (unable to find symbol that is claimed to exist)", {} }.throwException();
+                return false;
             }
 
             auto rhsFunctionQuery = settings.symbols.findSymbol( settings.fileId, getSymbolTypeId( rhs ) );
             if( !rhsFunctionQuery || !std::holds_alternative< FunctionSymbol >( rhsFunctionQuery->symbol ) ) {
-                Error{ "Internal compiler error (unable to find symbol that is claimed to exist)", {} }.throwException();
+                return false;
             }
 
             const FunctionSymbol& lhsFunction = std::get< FunctionSymbol >( lhsFunctionQuery->symbol );
@@ -273,8 +272,56 @@ namespace GoldScorpion {
         }
     }
 
+    std::optional< SymbolTypeLayout > getTypeLayout( const SymbolType& type, SymbolTypeSettings settings ) {
+        return std::visit( overloaded {
+            []( const SymbolNativeType& type ) -> std::optional< SymbolTypeLayout > {
+                // The 68000 faults on word or long access at an odd address, so anything wider than a byte is word-aligned
+                switch( type.type ) {
+                    case TokenType::TOKEN_U8:
+                    case TokenType::TOKEN_S8:
+                        return SymbolTypeLayout{ 1, 1 };
+                    case TokenType::TOKEN_U16:
+                    case TokenType::TOKEN_S16:
+                        return SymbolTypeLayout{ 2, 2 };
+                    case TokenType::TOKEN_U32:
+                    case TokenType::TOKEN_S32:
+                    case TokenType::TOKEN_STRING:
+                        return SymbolTypeLayout{ 4, 2 };
+                    default:
+                        return {};
+                }
+            },
+            [ &settings ]( const SymbolUdtType& type ) -> std::optional< SymbolTypeLayout > {
+                if( const UdtSymbol* udt = settings.symbols.findUdt( settings.fileId, type.id ) ) {
+                    return udt->layout;
+                }
+
+                return {};
+            },
+            []( const SymbolFunctionType& ) -> std::optional< SymbolTypeLayout > {
+                // Function pointer
+                return SymbolTypeLayout{ 4, 2 };
+            },
+            [ &settings ]( const SymbolArrayType& type ) -> std::optional< SymbolTypeLayout > {
+                auto base = getTypeLayout( toSymbolType( type.base ), settings );
+                if( !base ) {
+                    return {};
+                }
+
+                // The last stride covers any padding in the dimensions before it
+                long size = base->size;
+                if( type.dimensions.size() ) {
+                    size *= type.strides.back() * type.dimensions.back();
+                }
+
+                return SymbolTypeLayout{ size, base->alignment };
+            }
+        }, type );
+    }
+
     // This is the new shit
     SymbolTypeResult getType( const Primary& node, SymbolTypeSettings settings ) {
+        GS_COUNT( GET_TYPE_CALLS );
 
         if( auto expressionSubtype = std::get_if< std::unique_ptr< Expression > >( &node.value ) ) {
             return getType( **expressionSubtype, settings );
@@ -283,7 +330,16 @@ namespace GoldScorpion {
         const Token& token = std::get< Token >( node.value );
         switch( token.type ) {
             case TokenType::TOKEN_LITERAL_INTEGER: {
-                return SymbolTypeResult::good( SymbolNativeType{ *typeIdToTokenType( getLiteralType( expectLong( token ) ) ) } );
+                if( node.foldedType ) {
+                    return SymbolTypeResult::good( SymbolNativeType{ *node.foldedType } );
+                }
+
+                auto literal = expectLong( token );
+                if( !literal ) {
+                    return SymbolTypeResult::err( "Internal compiler error (integer literal token has no value)" );
+                }
+
+                return SymbolTypeResult::good( SymbolNativeType{ *typeIdToTokenType( getLiteralType( *literal ) ) } );
             }
             case TokenType::TOKEN_LITERAL_STRING: {
                 return SymbolTypeResult::good( SymbolNativeType{ TokenType::TOKEN_STRING } );
@@ -292,25 +348,28 @@ namespace GoldScorpion {
                 // Type of "this" token is obtainable from the pointer on the stack
                 auto thisQuery = settings.symbols.findSymbol( settings.fileId, "this" );
                 if( !thisQuery ) {
-                    Error{ "Internal compiler error (unable to determine type of \"this\" token)", token }.throwException();
+                    return SymbolTypeResult::err( "Internal compiler error (unable to determine type of \"this\" token)" );
                 }
 
                 // Symbol type of thisQuery must be VariableSymbol
                 if( auto variableSymbol = std::get_if< VariableSymbol >( &( thisQuery->symbol ) ) ) {
                     if( auto udtType = std::get_if< SymbolUdtType >( &( variableSymbol->type ) ) ) {
                         return SymbolTypeResult::good( *udtType );
-                    } else {
-                        Error{ "Internal compiler error (\"this\" token only valid for SymbolUdtType)", token }.throwException();
                     }
-                } else {
-                    Error{ "Internal compiler error (type of \"this\" token does not point to instance of a variable)", token }.throwException();
+
+                    return SymbolTypeResult::err( "Internal compiler error (\"this\" token only valid for SymbolUdtType)" );
                 }
 
-                return SymbolTypeResult::err( "Internal compiler error" );
+                return SymbolTypeResult::err( "Internal compiler error (type of \"this\" token does not point to instance of a variable)" );
             }
             case TokenType::TOKEN_IDENTIFIER: {
                 // Look up identifier in memory
-                std::string id = expectString( token );
+                auto idValue = expectString( token );
+                if( !idValue ) {
+                    return SymbolTypeResult::err( "Internal compiler error (identifier token has no value)" );
+                }
+
+                std::string id = *idValue;
                 auto memoryQuery = settings.symbols.findSymbol( settings.fileId, id );
                 if( !memoryQuery ) {
                     return SymbolTypeResult::err( "Undefined symbol: " + id );
@@ -323,15 +382,12 @@ namespace GoldScorpion {
                     return SymbolTypeResult::good( constantSymbol->type );
                 } else if( auto functionSymbol = std::get_if< FunctionSymbol >( &( memoryQuery->symbol ) ) ) {
                     return SymbolTypeResult::good( SymbolFunctionType{ functionSymbol->id, {} } );
-                } else {
-                    Error{ "Internal compiler error (Identifier token cannot indirectly refer to UDT)", token }.throwException();
                 }
 
-                return SymbolTypeResult::err( "Internal compiler error" );
+                return SymbolTypeResult::err( "Internal compiler error (Identifier token cannot indirectly refer to UDT)" );
             }
             default: {
-                Error{ "Internal compiler error (Token not of expected type for SymbolTypeResult)", token }.throwException();
-                return SymbolTypeResult::err( "Internal compiler error" );
+                return SymbolTypeResult::err( "Internal compiler error (Token not of expected type for SymbolTypeResult)" );
             }
 
         }
@@ -339,6 +395,7 @@ namespace GoldScorpion {
     }
 
     SymbolTypeResult getType( const CallExpression& node, SymbolTypeSettings settings ) {
+        GS_COUNT( GET_TYPE_CALLS );
         // Get the return type of the expression
         SymbolTypeResult expressionType = getType( *node.identifier, settings );
         if( !expressionType ) {
@@ -354,31 +411,25 @@ namespace GoldScorpion {
         const SymbolFunctionType& functionRef = std::get< SymbolFunctionType >( *expressionType );
         FunctionSymbol function;
         if( functionRef.associatedTypeId ) {
-            auto udtQuery = settings.symbols.findSymbol( settings.fileId, *functionRef.associatedTypeId );
-            if( !udtQuery || !std::holds_alternative< UdtSymbol >( udtQuery->symbol ) ) {
-                Error{ "Internal compiler error (User-defined type defined on SymbolFunctionType, but user-defined type does not exist)", {} }.throwException();
+            const UdtSymbol* udt = settings.symbols.findUdt( settings.fileId, *functionRef.associatedTypeId );
+            if( !udt ) {
+                return SymbolTypeResult::err( "Internal compiler error (User-defined type defined on SymbolFunctionType, but user-defined type does not exist)" );
             }
 
-            bool found = false;
-            for( const SymbolField& field : std::get< UdtSymbol >( udtQuery->symbol ).fields ) {
-                if( field.id == functionRef.id ) {
-                    if( !std::holds_alternative< FunctionSymbol >( field.value ) ) {
-                        Error{ "Internal compiler error (Cannot call non-function symbol \"" + functionRef.id + "\" on user-defined type \"" + *functionRef.associatedTypeId + "\")", {} }.throwException();
-                    }
-
-                    function = std::get< FunctionSymbol >( field.value );
-                    found = true;
-                    break;
-                }
+            const SymbolField* field = findField( functionRef.id, *udt );
+            if( !field ) {
+                return SymbolTypeResult::err( "Symbol \"" + functionRef.id + "\" not found on user-defined type \"" + *functionRef.associatedTypeId + "\"" );
             }
 
-            if( !found ) {
-                return SymbolTypeResult::err( "Symbol \"" + functionRef.id + "\" not found on user-defined type \"" + *functionRef.associatedTypeId + "\"" );
+            if( !std::holds_alternative< FunctionSymbol >( field->value ) ) {
+                return SymbolTypeResult::err( "Internal compiler error (Cannot call non-function symbol \"" + functionRef.id + "\" on user-defined type \"" + *functionRef.associatedTypeId + "\")" );
             }
+
+            function = std::get< FunctionSymbol >( field->value );
         } else {
             auto functionQuery = settings.symbols.findSymbol( settings.fileId, functionRef.id );
             if( !functionQuery || !std::holds_alternative< FunctionSymbol >( functionQuery->symbol ) ) {
-                Error{ "Internal compiler error (function symbol said to exist does not exist)", {} }.throwException();
+                return SymbolTypeResult::err( "Internal compiler error (function symbol said to exist does not exist)" );
             }
 
             function = std::get< FunctionSymbol >( functionQuery->symbol );
@@ -392,6 +443,7 @@ namespace GoldScorpion {
     }
 
     SymbolTypeResult getType( const BinaryExpression& node, SymbolTypeSettings settings ) {
+        GS_COUNT( GET_TYPE_CALLS );
 
         SymbolTypeResult lhs = getType( *node.lhsValue, settings );
         if( !lhs ) {
@@ -404,7 +456,7 @@ namespace GoldScorpion {
         if( auto token = std::get_if< Token >( &node.op->value ) ) {
             tokenOp = token->type;
         } else {
-            Error{ "Internal compiler error (BinaryExpression op does not contain Token variant)", {} }.throwException();
+            return SymbolTypeResult::err( "Internal compiler error (BinaryExpression op does not contain Token variant)" );
         }
 
         switch( tokenOp ) {
@@ -416,34 +468,45 @@ namespace GoldScorpion {
                 }
 
                 std::string typeId = getSymbolTypeId( *lhs );
-                auto lhsUdt = settings.symbols.findSymbol( settings.fileId, typeId );
-                if( !lhsUdt ) {
-                    return SymbolTypeResult::err( "Undeclared user-defined type" );
+                if( !typeIsUdt( *lhs ) ) {
+                    return SymbolTypeResult::err( "Cannot apply dot operator to non-user-defined type " + typeId );
                 }
 
-                if( auto asUdt = std::get_if< UdtSymbol >( &( lhsUdt->symbol ) ) ) {
-                    // Find field of name rhsIdentifier
-                    for( const SymbolField& argument : asUdt->fields ) {
-                        if( argument.id == *rhsIdentifier ) {
-                            // Field name found
-                            // Discriminate VariableSymbol or FunctionSymbol and return that
-                            if( auto asVariable = std::get_if< VariableSymbol >( &argument.value ) ) {
-                                return SymbolTypeResult::good( ( *asVariable ).type );
-                            }
-
-                            if( std::holds_alternative< FunctionSymbol >( argument.value ) ) {
-                                return SymbolTypeResult::good( SymbolFunctionType{ argument.id, asUdt->id } );
-                            }
-
-                            return SymbolTypeResult::err( "Internal compiler error (unexpected UDT field type)" );
-                        }
-                    }
+                const UdtSymbol* asUdt = settings.symbols.findUdt( settings.fileId, typeId );
+                if( !asUdt ) {
+                    return SymbolTypeResult::err( "Undeclared user-defined type" );
+                }
 
-                    // If we got here, field name wasn't found
+                // Find field of name rhsIdentifier
+                const SymbolField* argument = findField( *rhsIdentifier, *asUdt );
+                if( !argument ) {
                     return SymbolTypeResult::err( "User-defined type " + typeId + " does not have field of name " + *rhsIdentifier );
-                } else {
-                    return SymbolTypeResult::err( "Cannot apply dot operator to non-user-defined type " + typeId );
                 }
+
+                // Discriminate VariableSymbol or FunctionSymbol and return that
+                if( auto asVariable = std::get_if< VariableSymbol >( &argument->value ) ) {
+                    return SymbolTypeResult::good( ( *asVariable ).type );
+                }
+
+                if( std::holds_alternative< FunctionSymbol >( argument->value ) ) {
+                    return SymbolTypeResult::good( SymbolFunctionType{ argument->id, asUdt->id } );
+                }
+
+                return SymbolTypeResult::err( "Internal compiler error (unexpected UDT field type)" );
+            }
+            case TokenType::TOKEN_DOUBLE_EQUALS:
+            case TokenType::TOKEN_NOT_EQUALS:
+            case TokenType::TOKEN_LESS_THAN:
+            case TokenType::TOKEN_LESS_THAN_EQUAL:
+            case TokenType::TOKEN_GREATER_THAN:
+            case TokenType::TOKEN_GREATER_THAN_EQUAL:
+            case TokenType::TOKEN_AND:
+            case TokenType::TOKEN_OR:
+            case TokenType::TOKEN_XOR: {
+                if( !rhs ) { return rhs; }
+
+                // Comparisons and logical operators give 1 or 0
+                return SymbolTypeResult::good( SymbolNativeType{ TokenType::TOKEN_U8 } );
             }
             default: {
                 // All other operators require both sides to have a well-defined type
@@ -470,7 +533,28 @@ namespace GoldScorpion {
         }
     }
 
+    SymbolTypeResult getType( const ArrayExpression& node, SymbolTypeSettings settings ) {
+        GS_COUNT( GET_TYPE_CALLS );
+        // Indexing every dimension of an array gives one element, of the array's base type
+        SymbolTypeResult arrayType = getType( *node.identifier, settings );
+        if( !arrayType ) {
+            return arrayType;
+        }
+
+        const SymbolArrayType* asArray = std::get_if< SymbolArrayType >( &*arrayType );
+        if( !asArray ) {
+            return SymbolTypeResult::err( "Cannot index non-array type " + getSymbolTypeId( *arrayType ) );
+        }
+
+        if( node.indices.size() != asArray->dimensions.size() ) {
+            return SymbolTypeResult::err( "Expected " + std::to_string( asArray->dimensions.size() ) + " indices for array of type " + getSymbolTypeId( *arrayType ) );
+        }
+
+        return SymbolTypeResult::good( toSymbolType( asArray->base ) );
+    }
+
     SymbolTypeResult getType( const AssignmentExpression& node, SymbolTypeSettings settings ) {
+        GS_COUNT( GET_TYPE_CALLS );
         // An assignment expression returns the type of the LHS ***IFF*** the RHS matches
         SymbolTypeResult lhs = getType( *node.identifier, settings );
         if( !lhs ) {
@@ -490,6 +574,7 @@ namespace GoldScorpion {
     }
 
     SymbolTypeResult getType( const Expression& node, SymbolTypeSettings settings ) {
+        GS_COUNT( GET_TYPE_CALLS );
 		if( auto binaryExpression = std::get_if< std::unique_ptr< BinaryExpression > >( &node.value ) ) {
  			return getType( **binaryExpression, settings );
 		}
@@ -511,6 +596,10 @@ namespace GoldScorpion {
             return getType( **assignmentExpression, settings );
         }
 
+        if( auto arrayExpression = std::get_if< std::unique_ptr< ArrayExpression > >( &node.value ) ) {
+            return getType( **arrayExpression, settings );
+        }
+
         return SymbolTypeResult::err( "Expression subtype not implemented" );
     }
 
@@ -4,6 +4,9 @@
 #include <exception>
 #include <string>
 #include <cstdio>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 namespace GoldScorpion::Utility {
 
@@ -68,4 +71,66 @@ namespace GoldScorpion::Utility {
 		return buffer;
 	}
 
+	std::string jsonEscape( const std::string& text ) {
+		std::string result;
+		for( char character : text ) {
+			switch( character ) {
+				case '"':
+					result += "\\\"";
+					break;
+				case '\\':
+					result += "\\\\";
+					break;
+				case '\n':
+					result += "\\n";
+					break;
+				case '\t':
+					result += "\\t";
+					break;
+				default:
+					if( static_cast< unsigned char >( character ) < 0x20 ) {
+						char buffer[ 7 ] = { 0 };
+						std::sprintf( buffer, "\\u%04x", character );
+						result += buffer;
+					} else {
+						result += character;
+					}
+			}
+		}
+
+		return result;
+	}
+
+	void parallelFor( size_t count, const std::function< void( size_t ) >& job ) {
+		size_t workerCount = std::min< size_t >( std::max( std::thread::hardware_concurrency(), 1u ), count );
+
+		// Not worth spinning up threads for a single job
+		if( workerCount <= 1 ) {
+			for( size_t i = 0; i != count; i++ ) {
+				job( i );
+			}
+
+			return;
+		}
+
+		std::atomic< size_t > next{ 0 };
+		auto worker = [ & ]() {
+			for( size_t i = next++; i < count; i = next++ ) {
+				job( i );
+			}
+		};
+
+		std::vector< std::thread > workers;
+		for( size_t i = 0; i != workerCount - 1; i++ ) {
+			workers.emplace_back( worker );
+		}
+
+		// Calling thread pulls its weight too
+		worker();
+
+		for( std::thread& thread : workers ) {
+			thread.join();
+		}
+	}
+
 }
\ No newline at end of file
@@ -4,24 +4,36 @@
 #include "type_tools.hpp"
 #include "tree_tools.hpp"
 #include "variant_visitor.hpp"
+#include "utility.hpp"
+#include "phase.hpp"
 #include <variant>
 #include <set>
+#include <algorithm>
+#include <iterator>
+#include <mutex>
 
 namespace GoldScorpion {
 
     using PlatformAnnotationPackage = m68k::md::AnnotationPackage;
     using PlatformAnnotationSettings = m68k::md::AnnotationSettings;
 
+    struct DeferredFunctionBody;
+
     struct VerifierSettings {
         std::string fileId;
         SymbolResolver& symbols;
+        Diagnostics& diagnostics;
         std::vector< PlatformAnnotationPackage >& currentAnnotationPackage;
-        std::optional< Token > nearestToken;
+        SourceSpan nearestSpan;
         std::optional< std::string > contextTypeId;
         std::optional< SymbolType > functionReturnType;
         bool anonymousFunctionPermitted;
         bool withinFunction;
         bool topLevelPermitted;
+        // When set, function bodies are queued here instead of being checked in place
+        std::vector< DeferredFunctionBody >* deferredBodies = nullptr;
+        // Top-level functions seen so far, which constants may call
+        FunctionTable* functions = nullptr;
     };
 
     struct CheckedParameter {
@@ -29,52 +41,76 @@ namespace GoldScorpion {
         SymbolType typeId;
     };
 
+    struct FunctionSignature {
+        std::optional< std::string > name;
+        std::vector< SymbolArgument > arguments;
+        std::optional< SymbolType > returnType;
+    };
+
+    struct DeferredFunctionBody {
+        const FunctionDeclaration* node;
+        FunctionSignature signature;
+        std::optional< std::string > contextTypeId;
+        SourceSpan nearestSpan;
+    };
+
     // Forward Declarations
-    static void check( const Expression& node, VerifierSettings settings );
-    static void check( const Declaration& node, VerifierSettings settings );
+    static bool check( const Expression& node, VerifierSettings settings );
+    static bool check( const Declaration& node, VerifierSettings settings );
     // end
 
-    static std::string expectTokenString( const Token& token, const std::string& error ) {
+    static bool fail( const VerifierSettings& settings, Error error ) {
+        settings.diagnostics.report( std::move( error ) );
+        return false;
+    }
+
+    static std::optional< std::string > expectTokenString( const Token& token, const std::string& error, const VerifierSettings& settings ) {
         if( token.value ) {
             if( auto stringValue = std::get_if< std::string >( &*token.value ) ) {
                 return *stringValue;
             }
         }
 
-        Error{ error, token }.throwException();
-        return "";
+        fail( settings, Error{ error, token.span } );
+        return {};
     }
 
-    static long expectTokenLong( const Token& token, const std::string& error ) {
+    static std::optional< long > expectTokenLong( const Token& token, const std::string& error, const VerifierSettings& settings ) {
         if( token.value ) {
             if( auto longValue = std::get_if< long >( &*token.value ) ) {
                 return *longValue;
             }
         }
 
-        Error{ error, token }.throwException();
-        return 0;
+        fail( settings, Error{ error, token.span } );
+        return {};
     }
 
-    static void expectTokenValue( const Token& token, const std::string& error ) {
+    static bool expectTokenValue( const Token& token, const std::string& error, const VerifierSettings& settings ) {
         if( !token.value ) {
-            Error{ error, token }.throwException();
+            return fail( settings, Error{ error, token.span } );
         }
+
+        return true;
     }
 
-    static void expectTokenOfType( const Token& token, const TokenType& type, const std::string& error ) {
+    static bool expectTokenOfType( const Token& token, const TokenType& type, const std::string& error, const VerifierSettings& settings ) {
         if( token.type != type ) {
-            Error{ error, token }.throwException();
+            return fail( settings, Error{ error, token.span } );
         }
+
+        return true;
     }
 
-    static void expectTokenOfType( const Token& token, const std::set< TokenType >& acceptableTypes, const std::string& error ) {
+    static bool expectTokenOfType( const Token& token, const std::set< TokenType >& acceptableTypes, const std::string& error, const VerifierSettings& settings ) {
         if( !acceptableTypes.count( token.type ) ) {
-            Error{ error, token }.throwException();
+            return fail( settings, Error{ error, token.span } );
         }
+
+        return true;
     }
 
-    static void expectTokenType( const Token& token, const std::string& error ) {
+    static bool expectTokenType( const Token& token, const std::string& error, const VerifierSettings& settings ) {
         static const std::set< TokenType > VALID_TOKENS = {
             TokenType::TOKEN_U8,
             TokenType::TOKEN_U16,
@@ -88,102 +124,164 @@ namespace GoldScorpion {
 
         bool identifierNoString = ( token.type == TokenType::TOKEN_IDENTIFIER ) && ( !token.value || !std::holds_alternative< std::string >( *token.value ) );
         if( identifierNoString || !VALID_TOKENS.count( token.type ) ) {
-            Error{ error, token }.throwException();
+            return fail( settings, Error{ error, token.span } );
         }
+
+        return true;
     }
 
-    static Token expectToken( const Primary& primary, std::optional< Token > nearestToken, const std::string& error ) {
+    static std::optional< Token > expectToken( const Primary& primary, SourceSpan nearestSpan, const std::string& error, const VerifierSettings& settings ) {
         if( auto token = std::get_if< Token >( &primary.value ) ) {
             return *token;
         }
 
-        Error{ error, nearestToken }.throwException();
-        return Token{ TokenType::TOKEN_NONE, {}, 0, 0 };
+        fail( settings, Error{ error, nearestSpan } );
+        return {};
     }
 
-    static CheckedParameter checkAndExtract( const Parameter& parameter, VerifierSettings settings ) {
-        expectTokenOfType( parameter.name, TokenType::TOKEN_IDENTIFIER, "Internal compiler error (Parameter identifier token not of identifier type)" );
-        std::string paramName = expectTokenString( parameter.name, "Internal compiler error (Parameter identifier token contains no string alternative)" );
+    static std::optional< CheckedParameter > checkAndExtract( const Parameter& parameter, VerifierSettings settings ) {
+        if( !expectTokenOfType( parameter.name, TokenType::TOKEN_IDENTIFIER, "Internal compiler error (Parameter identifier token not of identifier type)", settings ) ) {
+            return {};
+        }
+        auto paramName = expectTokenString( parameter.name, "Internal compiler error (Parameter identifier token contains no string alternative)", settings );
+        if( !paramName ) {
+            return {};
+        }
 
         // The typeId must be valid and, if a udt, declared
-        expectTokenType( parameter.type.type, "Internal compiler error (Parameter type identifier not of any discernable type)" );
+        if( !expectTokenType( parameter.type.type, "Internal compiler error (Parameter type identifier not of any discernable type)", settings ) ) {
+            return {};
+        }
 
         SymbolType type;
         if( tokenIsPrimitiveType( parameter.type.type ) ) {
             type = SymbolNativeType{ parameter.type.type.type };
         } else {
-            std::string typeId = expectTokenString( parameter.type.type, "Internal compiler error (Parameter type identifier nonprimitive but contains no string variant)" );
+            auto typeId = expectTokenString( parameter.type.type, "Internal compiler error (Parameter type identifier nonprimitive but contains no string variant)", settings );
+            if( !typeId ) {
+                return {};
+            }
 
-            auto symbolQuery = settings.symbols.findSymbol( settings.fileId, typeId );
+            auto symbolQuery = settings.symbols.findSymbol( settings.fileId, *typeId );
             if( !symbolQuery || !std::holds_alternative< UdtSymbol >( symbolQuery->symbol ) ) {
-                Error{ "Undeclared user-defined type: " + typeId, parameter.type.type }.throwException();
+                fail( settings, Error{ "Undeclared user-defined type: " + *typeId, parameter.type.type.span } );
+                return {};
+            }
+
+            type = SymbolUdtType{ *typeId };
+        }
+
+        return CheckedParameter{ *paramName, type };
+    }
+
+    /**
+     * Wrap the type of a declaration in an array of the dimensions it was declared with, if it has any. Each
+     * dimension is a literal or the name of an integer constant.
+     */
+    static std::optional< SymbolType > wrapArrayType( const DataType& type, SymbolType symbolType, bool padded, VerifierSettings settings ) {
+        if( type.arrayDimensions.empty() ) {
+            return symbolType;
+        }
+
+        auto baseType = toArrayIntermediateType( symbolType );
+        if( !baseType ) {
+            fail( settings, Error{ "Internal compiler error (cannot wrap an array in an array intermediate type)", type.type.span } );
+            return {};
+        }
+
+        std::vector< long > dimensions;
+
+        // Iterate through and get dimensions
+        for( const Token& dimension : type.arrayDimensions ) {
+            // Hack to get around constant evaluation of each parameter
+            std::unique_ptr< Expression > primary = std::make_unique< Expression >( Expression {
+                std::make_unique< Primary >( Primary { dimension } ),
+                {}
+            } );
+
+            std::stack< ConstantExpressionValue > stack;
+            auto dimensionValue = evaluateConst( *primary, ConstEvaluationSettings{ settings.fileId, stack, settings.symbols, settings.nearestSpan, settings.functions } );
+            if( !dimensionValue ) {
+                fail( settings, dimensionValue.getError() );
+                return {};
             }
 
-            type = SymbolUdtType{ typeId };
+            if( auto dimensionLong = std::get_if< long >( &*dimensionValue ) ) {
+                dimensions.push_back( *dimensionLong );
+            } else {
+                fail( settings, Error{ "Internal compiler error (Array dimension does not evaluate to long value)", dimension.span } );
+                return {};
+            }
         }
 
-        return CheckedParameter{ paramName, type };
+        return makeArrayType( std::move( dimensions ), *baseType, padded );
     }
 
     // mostly checks for internal compiler errors
-    static void check( const Primary& node, VerifierSettings settings ) {
-        std::visit( overloaded {
+    static bool check( const Primary& node, VerifierSettings settings ) {
+        return std::visit( overloaded {
 
             [ &settings ]( const Token& token ) {
                 switch( token.type ) {
                     case TokenType::TOKEN_THIS: {
                         if( !settings.contextTypeId ) {
-                            Error{ "\"this\" specifier not permitted in this context", token }.throwException();
+                            return fail( settings, Error{ "\"this\" specifier not permitted in this context", token.span } );
                         }
-                        break;
+                        return true;
                     }
                     case TokenType::TOKEN_IDENTIFIER: {
-                        expectTokenValue( token, "Internal compiler error (Token of type TOKEN_IDENTIFIER has no associated value)" );
-                        break;
+                        return expectTokenValue( token, "Internal compiler error (Token of type TOKEN_IDENTIFIER has no associated value)", settings );
                     }
                     case TokenType::TOKEN_LITERAL_STRING: {
-                        expectTokenString( token, "Internal compiler error (Token of type TOKEN_LITERAL_STRING has no associated string)" );
-                        break;
+                        return expectTokenString( token, "Internal compiler error (Token of type TOKEN_LITERAL_STRING has no associated string)", settings ).has_value();
                     }
                     case TokenType::TOKEN_LITERAL_INTEGER: {
-                        expectTokenLong( token, "Internal compiler error (Token of type TOKEN_LITERAL_INTEGER has no associated long)" );
-                        break;
+                        return expectTokenLong( token, "Internal compiler error (Token of type TOKEN_LITERAL_INTEGER has no associated long)", settings ).has_value();
                     }
                     default:
                         // tests pass
-                        break;
+                        return true;
                 }
             },
 
             [ &settings ]( const std::unique_ptr< Expression >& expression ) {
-                check( *expression, settings );
+                return check( *expression, settings );
             }
 
         }, node.value );
     }
 
-    static void check( const UnaryExpression& node, VerifierSettings settings ) {
+    static bool check( const UnaryExpression& node, VerifierSettings settings ) {
         // The only valid tokens here are "not" and "-"
-        check( *node.op, settings );
-        check( *node.value, settings );
+        if( !check( *node.op, settings ) || !check( *node.value, settings ) ) {
+            return false;
+        }
 
-        Token token = expectToken( *node.op, settings.nearestToken, "Expected: Operator of BinaryExpression to be of Token type" );
-        if( !( token.type == TokenType::TOKEN_NOT || token.type == TokenType::TOKEN_MINUS ) ) {
-            Error{ "Expected: \"not\" or \"-\" operator for UnaryExpression", token }.throwException();
+        auto token = expectToken( *node.op, settings.nearestSpan, "Expected: Operator of BinaryExpression to be of Token type", settings );
+        if( !token ) {
+            return false;
         }
+
+        if( !( token->type == TokenType::TOKEN_NOT || token->type == TokenType::TOKEN_MINUS ) ) {
+            return fail( settings, Error{ "Expected: \"not\" or \"-\" operator for UnaryExpression", token->span } );
+        }
+
+        return true;
     }
 
-    static void check( const CallExpression& node, VerifierSettings settings ) {
+    static bool check( const CallExpression& node, VerifierSettings settings ) {
         // Identifier must be a callable function with a non-void return type
-        check( *node.identifier, settings );
+        if( !check( *node.identifier, settings ) ) {
+            return false;
+        }
         SymbolTypeResult identifierType = getType( *node.identifier, SymbolTypeSettings{ settings.fileId, settings.symbols } );
 
         if( !identifierType ) {
-            Error{ "Unable to determine type of CallExpression identifier: " + identifierType.getError(), settings.nearestToken }.throwException();
+            return fail( settings, Error{ "Unable to determine type of CallExpression identifier: " + identifierType.getError(), settings.nearestSpan } );
         }
 
         if( !typeIsFunction( *identifierType ) ) {
-            Error{ "Unable to call non-function type " + getSymbolTypeId( *identifierType ), settings.nearestToken }.throwException();
+            return fail( settings, Error{ "Unable to call non-function type " + getSymbolTypeId( *identifierType ), settings.nearestSpan } );
         }
 
         SymbolFunctionType type = std::get< SymbolFunctionType >( *identifierType );
@@ -193,47 +291,43 @@ namespace GoldScorpion {
         FunctionSymbol functionType;
         if( type.associatedTypeId ) {
             // Must get associated UDT first, then search the type ID out of that
-            auto udtQuery = settings.symbols.findSymbol( settings.fileId, *type.associatedTypeId );
-            if( !udtQuery || !std::holds_alternative< UdtSymbol >( udtQuery->symbol ) ) {
-                Error{ "Internal compiler error (User-defined type defined on SymbolFunctionType, but user-defined type does not exist)", settings.nearestToken }.throwException();
+            const UdtSymbol* udt = settings.symbols.findUdt( settings.fileId, *type.associatedTypeId );
+            if( !udt ) {
+                return fail( settings, Error{ "Internal compiler error (User-defined type defined on SymbolFunctionType, but user-defined type does not exist)", settings.nearestSpan } );
             }
 
-            bool found = false;
-            for( const SymbolField& field : std::get< UdtSymbol >( udtQuery->symbol ).fields ) {
-                if( field.id == type.id ) {
-                    if( !std::holds_alternative< FunctionSymbol >( field.value ) ) {
-                        Error{ "Internal compiler error (Cannot call non-function symbol \"" + type.id + "\" on user-defined type \"" + *type.associatedTypeId + "\")", settings.nearestToken }.throwException();
-                    }
-
-                    functionType = std::get< FunctionSymbol >( field.value );
-                    found = true;
-                    break;
-                }
+            const SymbolField* field = findField( type.id, *udt );
+            if( !field ) {
+                return fail( settings, Error{ "Symbol \"" + type.id + "\" not found on user-defined type \"" + *type.associatedTypeId + "\"", settings.nearestSpan } );
             }
 
-            if( !found ) {
-                Error{ "Symbol \"" + type.id + "\" not found on user-defined type \"" + *type.associatedTypeId + "\"", settings.nearestToken }.throwException();
+            if( !std::holds_alternative< FunctionSymbol >( field->value ) ) {
+                return fail( settings, Error{ "Internal compiler error (Cannot call non-function symbol \"" + type.id + "\" on user-defined type \"" + *type.associatedTypeId + "\")", settings.nearestSpan } );
             }
+
+            functionType = std::get< FunctionSymbol >( field->value );
         } else {
             auto functionQuery = settings.symbols.findSymbol( settings.fileId, type.id );
             if( !functionQuery || !std::holds_alternative< FunctionSymbol >( functionQuery->symbol ) ) {
-                Error{ "Cannot find symbol or symbol not of function type: " + type.id, settings.nearestToken }.throwException();
+                return fail( settings, Error{ "Cannot find symbol or symbol not of function type: " + type.id, settings.nearestSpan } );
             }
             functionType = std::get< FunctionSymbol >( functionQuery->symbol );
         }
 
         if( functionType.arguments.size() != node.arguments.size() ) {
-            Error{ "CallExpression requires " + std::to_string( functionType.arguments.size() ) + " arguments but " + std::to_string( node.arguments.size() ) + " arguments were provided", settings.nearestToken }.throwException();
+            return fail( settings, Error{ "CallExpression requires " + std::to_string( functionType.arguments.size() ) + " arguments but " + std::to_string( node.arguments.size() ) + " arguments were provided", settings.nearestSpan } );
         }
 
         // Iterate through function type specification and make sure types match up
         for( unsigned int i = 0; i != functionType.arguments.size(); i++ ) {
             const SymbolArgument& parameter = functionType.arguments[ i ];
 
-            check( *node.arguments[ i ], settings );
+            if( !check( *node.arguments[ i ], settings ) ) {
+                return false;
+            }
             SymbolTypeResult argumentType = getType( *node.arguments[ i ], SymbolTypeSettings{ settings.fileId, settings.symbols } );
             if( !argumentType ) {
-                Error{ "Unable to determine type of argument" + std::to_string( i ) + "in CallExpression: " + argumentType.getError(), settings.nearestToken }.throwException();
+                return fail( settings, Error{ "Unable to determine type of argument" + std::to_string( i ) + "in CallExpression: " + argumentType.getError(), settings.nearestSpan } );
             }
 
             if( !(
@@ -241,31 +335,39 @@ namespace GoldScorpion {
                 integerTypesMatch( parameter.type, *argumentType ) ||
                 coercibleToString( parameter.type, *argumentType )
             ) ) {
-                Error{ "Expected: Type of argument " + std::to_string( i ) + " to be " + getSymbolTypeId( parameter.type ) + " but argument provided is of type " + getSymbolTypeId( *argumentType ), settings.nearestToken }.throwException();
+                return fail( settings, Error{ "Expected: Type of argument " + std::to_string( i ) + " to be " + getSymbolTypeId( parameter.type ) + " but argument provided is of type " + getSymbolTypeId( *argumentType ), settings.nearestSpan } );
             }
         }
+
+        return true;
     }
 
-    static void check( const BinaryExpression& node, VerifierSettings settings ) {
+    static bool check( const BinaryExpression& node, VerifierSettings settings ) {
         // Constraints on BinaryExpressions:
         // 1) Left-hand side expression and right-hand side expression must validate
-        // 2) Operator must be token-type primary and one of the following: +, -, *, /, %, or .
+        // 2) Operator must be token-type primary and one of the following: +, -, *, /, %, <<, >>, &, |, ^, ==, !=, <, >, <=, >=,
+        //    and, or, xor, or .
         // 3) For . operator:
         // - Left-hand side must return a declared UDT type
         // - Right-hand side must be a token-type primary of identifier type
         // - Right-hand side identifier must be a valid field on the left-hand side user-defined type
-        // 4) For all other operators:
+        // 4) Operators other than the arithmetic ones take integers only
+        // 5) For all other operators:
         // - Left-hand side type must match right-hand side type, OR
         // - Right-hand side type must be coercible to left-hand side type:
         //  - Both are integer type, or
         //  - One side is a string while another is an integer type
 
-        check( *node.lhsValue, settings );
-        check( *node.op, settings );
-        check( *node.rhsValue, settings );
+        if( !check( *node.lhsValue, settings ) || !check( *node.op, settings ) || !check( *node.rhsValue, settings ) ) {
+            return false;
+        }
+
+        auto token = expectToken( *node.op, settings.nearestSpan, "Expected: Operator of BinaryExpression to be of Token type", settings );
+        if( !token ) {
+            return false;
+        }
 
-        Token token = expectToken( *node.op, settings.nearestToken, "Expected: Operator of BinaryExpression to be of Token type" );
-        if( token.type == TokenType::TOKEN_DOT ) {
+        if( token->type == TokenType::TOKEN_DOT ) {
             // - Left-hand side must return a declared UDT type...
             auto lhsType = getType( *node.lhsValue, SymbolTypeSettings{ settings.fileId, settings.symbols } );
             if( !lhsType || !typeIsUdt( *lhsType ) ) {
@@ -273,336 +375,574 @@ namespace GoldScorpion {
                 if( !lhsType ) {
                     error += ": Unable to deduce type: " + lhsType.getError();
                 }
-                Error{ error, token }.throwException();
+                return fail( settings, Error{ error, token->span } );
             }
 
-            auto udtQuery = settings.symbols.findSymbol( settings.fileId, getSymbolTypeId( *lhsType ) );
-            if( !udtQuery || !std::holds_alternative< UdtSymbol >( udtQuery->symbol ) ) {
-                Error{ "Undeclared user-defined type: " + getSymbolTypeId( *lhsType ), token }.throwException();
+            const UdtSymbol* udt = settings.symbols.findUdt( settings.fileId, getSymbolTypeId( *lhsType ) );
+            if( !udt ) {
+                return fail( settings, Error{ "Undeclared user-defined type: " + getSymbolTypeId( *lhsType ), token->span } );
             }
 
             // - Right hand side must be a token-type primary....
             if( auto primaryType = std::get_if< std::unique_ptr< Primary > >( &node.rhsValue->value ) ) {
                 // ...of identifier type
-                Token rhsIdentifier = expectToken( **primaryType, settings.nearestToken, "Expected: Expression of Primary token type as right-hand side of BinaryExpression with \".\" operator" );
-                expectTokenOfType( rhsIdentifier, TokenType::TOKEN_IDENTIFIER, "Primary expression in RHS of BinaryExpression with \".\' operator must be of identifier type" );
+                auto rhsIdentifier = expectToken( **primaryType, settings.nearestSpan, "Expected: Expression of Primary token type as right-hand side of BinaryExpression with \".\" operator", settings );
+                if( !rhsIdentifier || !expectTokenOfType( *rhsIdentifier, TokenType::TOKEN_IDENTIFIER, "Primary expression in RHS of BinaryExpression with \".\' operator must be of identifier type", settings ) ) {
+                    return false;
+                }
 
-                std::string rhsUdtFieldId = expectTokenString( rhsIdentifier, "Internal compiler error (BinaryExpression dot RHS token has no string alternative)" );
-                if( !fieldPresent( rhsUdtFieldId, std::get< UdtSymbol >( udtQuery->symbol ) ) ) {
-                    Error{ "Invalid field " + rhsUdtFieldId + " on user-defined type " + getSymbolTypeId( *lhsType ), rhsIdentifier }.throwException();
+                auto rhsUdtFieldId = expectTokenString( *rhsIdentifier, "Internal compiler error (BinaryExpression dot RHS token has no string alternative)", settings );
+                if( !rhsUdtFieldId ) {
+                    return false;
+                }
+
+                if( !fieldPresent( *rhsUdtFieldId, *udt ) ) {
+                    return fail( settings, Error{ "Invalid field " + *rhsUdtFieldId + " on user-defined type " + getSymbolTypeId( *lhsType ), rhsIdentifier->span } );
                 }
             } else {
-                Error{ "Expected: Expression of Primary type as right-hand side of BinaryExpression with \".\" operator", settings.nearestToken }.throwException();
+                return fail( settings, Error{ "Expected: Expression of Primary type as right-hand side of BinaryExpression with \".\" operator", settings.nearestSpan } );
             }
 
-            return;
+            return true;
         }
 
-        expectTokenOfType(
-            token,
+        if( !expectTokenOfType(
+            *token,
             {
                 TokenType::TOKEN_PLUS,
                 TokenType::TOKEN_MINUS,
                 TokenType::TOKEN_ASTERISK,
                 TokenType::TOKEN_FORWARD_SLASH,
-                TokenType::TOKEN_MODULO
+                TokenType::TOKEN_MODULO,
+                TokenType::TOKEN_SHIFT_LEFT,
+                TokenType::TOKEN_SHIFT_RIGHT,
+                TokenType::TOKEN_AMPERSAND,
+                TokenType::TOKEN_PIPE,
+                TokenType::TOKEN_CARET,
+                TokenType::TOKEN_DOUBLE_EQUALS,
+                TokenType::TOKEN_NOT_EQUALS,
+                TokenType::TOKEN_LESS_THAN,
+                TokenType::TOKEN_LESS_THAN_EQUAL,
+                TokenType::TOKEN_GREATER_THAN,
+                TokenType::TOKEN_GREATER_THAN_EQUAL,
+                TokenType::TOKEN_AND,
+                TokenType::TOKEN_OR,
+                TokenType::TOKEN_XOR
             },
-            "Expected: Operator of BinaryExpression to be one of \"+\",\"-\",\"*\",\"/\",\"%\",\".\""
-        );
+            "Expected: Operator of BinaryExpression to be one of \"+\",\"-\",\"*\",\"/\",\"%\",\"<<\",\">>\",\"&\",\"|\",\"^\",\"==\",\"!=\",\"<\",\">\",\"<=\",\">=\",\"and\",\"or\",\"xor\",\".\"",
+            settings
+        ) ) {
+            return false;
+        }
 
         auto lhsType = getType( *node.lhsValue, SymbolTypeSettings{ settings.fileId, settings.symbols } );
-        if( !lhsType ) { Error{ lhsType.getError(), settings.nearestToken }.throwException(); }
+        if( !lhsType ) { return fail( settings, Error{ lhsType.getError(), settings.nearestSpan } ); }
 
         auto rhsType = getType( *node.rhsValue, SymbolTypeSettings{ settings.fileId, settings.symbols } );
-        if( !rhsType ) { Error{ rhsType.getError(), settings.nearestToken }.throwException(); }
+        if( !rhsType ) { return fail( settings, Error{ rhsType.getError(), settings.nearestSpan } ); }
+
+        bool arithmetic =
+            token->type == TokenType::TOKEN_PLUS ||
+            token->type == TokenType::TOKEN_MINUS ||
+            token->type == TokenType::TOKEN_ASTERISK ||
+            token->type == TokenType::TOKEN_FORWARD_SLASH ||
+            token->type == TokenType::TOKEN_MODULO;
+        if( !arithmetic && !integerTypesMatch( *lhsType, *rhsType ) ) {
+            return fail( settings, Error{ "Expected: Integer operands for this operator, but operands are of type " + getSymbolTypeId( *lhsType ) + " and " + getSymbolTypeId( *rhsType ), token->span } );
+        }
 
         // A type is only coercible to string if the operator is plus
         if( typeIsString( *lhsType ) || typeIsString( *rhsType ) ) {
-            expectTokenOfType( token, TokenType::TOKEN_PLUS, "Expected: \"+\" operator for the concatenation of strings with string or integer types" );
+            if( !expectTokenOfType( *token, TokenType::TOKEN_PLUS, "Expected: \"+\" operator for the concatenation of strings with string or integer types", settings ) ) {
+                return false;
+            }
         }
 
         // Operations cannot be performed on functions
         if( typeIsFunction( *lhsType ) || typeIsFunction( *rhsType ) ) {
-            Error{ "Cannot apply BinaryExpression operation to function type " + ( typeIsFunction( *lhsType ) ? getSymbolTypeId( *lhsType ) : getSymbolTypeId( *rhsType ) ), settings.nearestToken }.throwException();
+            return fail( settings, Error{ "Cannot apply BinaryExpression operation to function type " + ( typeIsFunction( *lhsType ) ? getSymbolTypeId( *lhsType ) : getSymbolTypeId( *rhsType ) ), settings.nearestSpan } );
         }
 
         // Check if types are identical, and if not identical, if they can be coerced
         if( !( typesMatch( *lhsType, *rhsType, SymbolTypeSettings{ settings.fileId, settings.symbols } ) || integerTypesMatch( *lhsType, *rhsType ) || coercibleToString( *lhsType, *rhsType ) ) ) {
-            Error{ "Type mismatch: Expected type " + getSymbolTypeId( *lhsType ) + " but right-hand side expression is of type " + getSymbolTypeId( *rhsType ), settings.nearestToken }.throwException();
+            return fail( settings, Error{ "Type mismatch: Expected type " + getSymbolTypeId( *lhsType ) + " but right-hand side expression is of type " + getSymbolTypeId( *rhsType ), settings.nearestSpan } );
+        }
+
+        return true;
+    }
+
+    static bool check( const ArrayExpression& node, VerifierSettings settings ) {
+        if( !check( *node.identifier, settings ) ) {
+            return false;
+        }
+
+        // Every index must be an integer
+        for( const auto& index : node.indices ) {
+            if( !check( *index, settings ) ) {
+                return false;
+            }
+
+            auto indexType = getType( *index, SymbolTypeSettings{ settings.fileId, settings.symbols } );
+            if( !indexType ) {
+                return fail( settings, Error{ indexType.getError(), settings.nearestSpan } );
+            }
+
+            if( !typeIsInteger( *indexType ) ) {
+                return fail( settings, Error{ "Array index must be an integer, not " + getSymbolTypeId( *indexType ), settings.nearestSpan } );
+            }
         }
+
+        // The identifier must be an array, indexed in every dimension
+        auto elementType = getType( node, SymbolTypeSettings{ settings.fileId, settings.symbols } );
+        if( !elementType ) {
+            return fail( settings, Error{ elementType.getError(), settings.nearestSpan } );
+        }
+
+        return true;
     }
 
-    static void check( const AssignmentExpression& node, VerifierSettings settings ) {
+    static bool check( const AssignmentExpression& node, VerifierSettings settings ) {
         // Begin with a simple verification of both the left-hand side and the right-hand side
-        check( *node.identifier, settings );
-        check( *node.expression, settings );
+        if( !check( *node.identifier, settings ) || !check( *node.expression, settings ) ) {
+            return false;
+        }
 
         // Left hand side must be either primary expression type with identifier, or binaryexpression type with dot operator
         const Expression& identifierExpression = *node.identifier;
         if( auto primaryExpression = std::get_if< std::unique_ptr< Primary > >( &identifierExpression.value ) ) {
             const Primary& primary = **primaryExpression;
 
-            Token token = expectToken( primary, identifierExpression.nearestToken, "Expected: Primary expression in LHS of AssignmentExpression must be a single identifier" );
+            auto token = expectToken( primary, identifierExpression.nearestSpan, "Expected: Primary expression in LHS of AssignmentExpression must be a single identifier", settings );
 
             // Primary expression must contain a token of type IDENTIFIER
-            expectTokenOfType( token, TokenType::TOKEN_IDENTIFIER, "Primary expression in LHS of AssignmentExpression must be a single identifier" );
-            expectTokenString( token, "Internal compiler error (AssignmentExpression token has no string alternative" );
+            if(
+                !token ||
+                !expectTokenOfType( *token, TokenType::TOKEN_IDENTIFIER, "Primary expression in LHS of AssignmentExpression must be a single identifier", settings ) ||
+                !expectTokenString( *token, "Internal compiler error (AssignmentExpression token has no string alternative", settings )
+            ) {
+                return false;
+            }
         } else if( auto result = std::get_if< std::unique_ptr< BinaryExpression > >( &identifierExpression.value ) ) {
             // Validate this binary expression
             const BinaryExpression& binaryExpression = **result;
 
             // The above binary expression may validate as correct, but in this case, it must be a dot expression
-            Token token = expectToken( *binaryExpression.op, identifierExpression.nearestToken, "BinaryExpression must have an operator of Token type" );
-            expectTokenOfType( token, TokenType::TOKEN_DOT, "BinaryExpression must have operator \".\" for left-hand side of AssignmentExpression" );
+            auto token = expectToken( *binaryExpression.op, identifierExpression.nearestSpan, "BinaryExpression must have an operator of Token type", settings );
+            if( !token || !expectTokenOfType( *token, TokenType::TOKEN_DOT, "BinaryExpression must have operator \".\" for left-hand side of AssignmentExpression", settings ) ) {
+                return false;
+            }
+        } else if( auto result = std::get_if< std::unique_ptr< ArrayExpression > >( &identifierExpression.value ) ) {
+            // An element of a constant array is as constant as the rest of it
+            auto arrayName = getIdentifierName( *( *result )->identifier );
+            if( arrayName && settings.symbols.findConstant( settings.fileId, *arrayName ) ) {
+                return fail( settings, Error{ "Cannot assign to an element of constant array " + *arrayName, settings.nearestSpan } );
+            }
         } else {
-            Error{ "Invalid left-hand expression type for AssignmentExpression", settings.nearestToken }.throwException();
+            return fail( settings, Error{ "Invalid left-hand expression type for AssignmentExpression", settings.nearestSpan } );
         }
 
         // Type of right hand side assignment should match type of identifier on left hand side
         auto lhsType = getType( *node.identifier, SymbolTypeSettings{ settings.fileId, settings.symbols } );
-        if( !lhsType ) { Error{ lhsType.getError(), settings.nearestToken }.throwException(); }
+        if( !lhsType ) { return fail( settings, Error{ lhsType.getError(), settings.nearestSpan } ); }
 
         auto rhsType = getType( *node.expression, SymbolTypeSettings{ settings.fileId, settings.symbols } );
-        if( !rhsType ) { Error{ rhsType.getError(), settings.nearestToken }.throwException(); }
+        if( !rhsType ) { return fail( settings, Error{ rhsType.getError(), settings.nearestSpan } ); }
 
         if( !( typesMatch( *lhsType, *rhsType, SymbolTypeSettings{ settings.fileId, settings.symbols } ) || integerTypesMatch( *lhsType, *rhsType ) || assignmentCoercible( *lhsType, *rhsType ) ) ) {
-            Error{ "Type mismatch: Expected type " + getSymbolTypeId( *lhsType ) + " but expression is of type " + getSymbolTypeId( *rhsType ), settings.nearestToken }.throwException();
+            return fail( settings, Error{ "Type mismatch: Expected type " + getSymbolTypeId( *lhsType ) + " but expression is of type " + getSymbolTypeId( *rhsType ), settings.nearestSpan } );
         }
+
+        return true;
     }
 
-    static void check( const Expression& node, VerifierSettings settings ) {
-        settings.nearestToken = node.nearestToken;
+    static bool check( const Expression& node, VerifierSettings settings ) {
+        // Operands the parser assembles from a postfix chain carry no span of their own
+        if( node.nearestSpan ) {
+            settings.nearestSpan = node.nearestSpan;
+        }
 
-        std::visit( overloaded {
+        return std::visit( overloaded {
 
-            [ &settings ]( const std::unique_ptr< AssignmentExpression >& expression ) { check( *expression, settings ); },
-            [ &settings ]( const std::unique_ptr< BinaryExpression >& expression ) { check( *expression, settings ); },
-            [ &settings ]( const std::unique_ptr< UnaryExpression >& expression ) { check( *expression, settings ); },
-            [ &settings ]( const std::unique_ptr< CallExpression >& expression ) { check( *expression, settings ); },
-            [ &settings ]( const std::unique_ptr< ArrayExpression >& expression ) { Error{ "Internal compiler error (Expression check not implemented for expression subtype ArrayExpression)", {} }.throwException(); },
-            [ &settings ]( const std::unique_ptr< Primary >& expression ) { check( *expression, settings ); },
+            [ &settings ]( const std::unique_ptr< AssignmentExpression >& expression ) { return check( *expression, settings ); },
+            [ &settings ]( const std::unique_ptr< BinaryExpression >& expression ) { return check( *expression, settings ); },
+            [ &settings ]( const std::unique_ptr< UnaryExpression >& expression ) { return check( *expression, settings ); },
+            [ &settings ]( const std::unique_ptr< CallExpression >& expression ) { return check( *expression, settings ); },
+            [ &settings ]( const std::unique_ptr< ArrayExpression >& expression ) { return check( *expression, settings ); },
+            [ &settings ]( const std::unique_ptr< Primary >& expression ) { return check( *expression, settings ); },
 
         }, node.value );
     }
 
-    static void check( const VarDeclaration& node, VerifierSettings settings ) {
+    static bool check( const VarDeclaration& node, VerifierSettings settings ) {
         // def x as type [= value]
 
         // Verify x is an identifier containing a string
-        expectTokenOfType( node.variable.name, TokenType::TOKEN_IDENTIFIER, "Expected: Identifier as token type for parameter declaration" );
-        std::string name = expectTokenString( node.variable.name, "Internal compiler error (VarDeclaration variable.name has no string alternative)" );
+        if( !expectTokenOfType( node.variable.name, TokenType::TOKEN_IDENTIFIER, "Expected: Identifier as token type for parameter declaration", settings ) ) {
+            return false;
+        }
+        auto name = expectTokenString( node.variable.name, "Internal compiler error (VarDeclaration variable.name has no string alternative)", settings );
+        if( !name ) {
+            return false;
+        }
+
+        // Annotations above apply to this declaration only
+        std::vector< PlatformAnnotationPackage > annotationPackages = settings.currentAnnotationPackage;
 
         // Cannot redefine a variable in the same scope, check for this using symbol table
-        if( settings.symbols.findSymbol( settings.fileId, name ) ) {
-            Error{ "Redeclaration of identifier " + name + " in the current scope", node.variable.name }.throwException();
+        if( settings.symbols.findSymbol( settings.fileId, *name ) ) {
+            return fail( settings, Error{ "Redeclaration of identifier " + *name + " in the current scope", node.variable.name.span } );
         }
 
         // Verify type is either primitive or declared
-        expectTokenType( node.variable.type.type, "Expected: Declared user-defined type or one of [u8, u16, u32, s8, s16, s32, string]" );
+        if( !expectTokenType( node.variable.type.type, "Expected: Declared user-defined type or one of [u8, u16, u32, s8, s16, s32, string]", settings ) ) {
+            return false;
+        }
 
         // If type is user-defined type (IDENTIFIER) then we must verify the UDT was declared
         SymbolType symbolType;
         if( node.variable.type.type.type == TokenType::TOKEN_IDENTIFIER ) {
-            std::string typeId = expectTokenString( node.variable.type.type, "Internal compiler error (VarDeclaration node.variable.type.type not a string type)" );
-            auto udtQuery = settings.symbols.findSymbol( settings.fileId, typeId );
+            auto typeId = expectTokenString( node.variable.type.type, "Internal compiler error (VarDeclaration node.variable.type.type not a string type)", settings );
+            if( !typeId ) {
+                return false;
+            }
+
+            auto udtQuery = settings.symbols.findSymbol( settings.fileId, *typeId );
             if( !udtQuery || !std::holds_alternative< UdtSymbol >( udtQuery->symbol ) ) {
-                Error{ "Undeclared user-defined type: " + typeId, node.variable.type.type }.throwException();
+                return fail( settings, Error{ "Undeclared user-defined type: " + *typeId, node.variable.type.type.span } );
             }
 
-            symbolType = SymbolUdtType{ typeId };
+            symbolType = SymbolUdtType{ *typeId };
         } else {
             symbolType = SymbolNativeType{ node.variable.type.type.type };
         }
 
         // If this is an array type we need to wrap the type
-        if( node.variable.type.arrayDimensions.size() ) {
-            SymbolArrayType wrapType = SymbolArrayType{ std::vector< long >(), toArrayIntermediateType( symbolType ) };
-
-            // Iterate through and get dimensions
-            for( const Token& dimension : node.variable.type.arrayDimensions ) {
-                // Hack to get around constant evaluation of each parameter
-                std::unique_ptr< Expression > primary = std::make_unique< Expression >( Expression {
-                    std::make_unique< Primary >( Primary { dimension } ),
-                    {}
-                } );
-
-                std::stack< ConstantExpressionValue > stack;
-                ConstantExpressionValue dimensionValue = evaluateConst( *primary, ConstEvaluationSettings{ settings.fileId, stack, settings.symbols, settings.nearestToken } );
-                if( auto dimensionLong = std::get_if< long >( &dimensionValue ) ) {
-                    wrapType.dimensions.push_back( *dimensionLong );
-                } else {
-                    Error{ "Internal compiler error (VarDeclaration array dimension does not evaluate to long value)", dimension }.throwException();
-                }
-            }
+        auto declaredType = wrapArrayType( node.variable.type, symbolType, m68k::md::padsArrays( annotationPackages ), settings );
+        if( !declaredType ) {
+            return false;
+        }
+        symbolType = *declaredType;
 
-            symbolType = wrapType;
+        for( const PlatformAnnotationPackage& package : annotationPackages ) {
+            if( auto error = m68k::md::checkVariable( package.id, settings.nearestSpan, symbolType ) ) {
+                return fail( settings, *error );
+            }
         }
 
         auto identifierTitle = getIdentifierName( node.variable.name );
         if( !identifierTitle ) {
-            Error{ "Internal compiler error (VarDeclaration variable.name is not an identifier)", node.variable.name }.throwException();
+            return fail( settings, Error{ "Internal compiler error (VarDeclaration variable.name is not an identifier)", node.variable.name.span } );
         }
 
         // The type returned by the expression on the right must match the declared type, or be coercible to the type.
         if( node.value ) {
             // Validate expression
-            check( **node.value, settings );
+            if( !check( **node.value, settings ) ) {
+                return false;
+            }
 
             // Get type of expression
             auto expressionType = getType( **node.value, SymbolTypeSettings{ settings.fileId, settings.symbols } );
             if( !expressionType ) {
-                Error{ "Internal compiler error (VarDeclaration validated Expression failed to yield a type)", settings.nearestToken }.throwException();
+                return fail( settings, Error{ expressionType.getError(), settings.nearestSpan } );
             }
 
             if( !( typesMatch( symbolType, *expressionType, SymbolTypeSettings{ settings.fileId, settings.symbols } ) || integerTypesMatch( symbolType, *expressionType ) || assignmentCoercible( symbolType, *expressionType ) ) ) {
-                Error{ "Type mismatch: Expected type " + getSymbolTypeId( symbolType ) + " but expression is of type " + getSymbolTypeId( *expressionType ), node.variable.type.type }.throwException();
+                return fail( settings, Error{ "Type mismatch: Expected type " + getSymbolTypeId( symbolType ) + " but expression is of type " + getSymbolTypeId( *expressionType ), node.variable.type.type.span } );
             }
         }
 
         settings.symbols.addSymbol( settings.fileId, Symbol{ VariableSymbol{ *identifierTitle, symbolType }, false } );
+        return true;
     }
 
-    static void check( const ConstDeclaration& node, VerifierSettings settings ) {
+    static bool check( const ConstDeclaration& node, VerifierSettings settings ) {
         // const X as type = value
 
         // Verify x is an identifier containing a string
-        expectTokenOfType( node.variable.name, TokenType::TOKEN_IDENTIFIER, "Expected: Identifier as token type for parameter declaration" );
-        std::string name = expectTokenString( node.variable.name, "Internal compiler error (ConstDeclaration variable.name has no string alternative)" );
+        if( !expectTokenOfType( node.variable.name, TokenType::TOKEN_IDENTIFIER, "Expected: Identifier as token type for parameter declaration", settings ) ) {
+            return false;
+        }
+        auto name = expectTokenString( node.variable.name, "Internal compiler error (ConstDeclaration variable.name has no string alternative)", settings );
+        if( !name ) {
+            return false;
+        }
 
         // Cannot redefine a variable in the same scope, check for this using symbol table
-        if( settings.symbols.findSymbol( settings.fileId, name ) ) {
-            Error{ "Redeclaration of identifier " + name + " in the current scope", node.variable.name }.throwException();
+        if( settings.symbols.findSymbol( settings.fileId, *name ) ) {
+            return fail( settings, Error{ "Redeclaration of identifier " + *name + " in the current scope", node.variable.name.span } );
         }
 
         // Verify type is either primitive or declared
-        expectTokenType( node.variable.type.type, "Expected: Declared user-defined type or one of [u8, u16, u32, s8, s16, s32, string]" );
+        if( !expectTokenType( node.variable.type.type, "Expected: Declared user-defined type or one of [u8, u16, u32, s8, s16, s32, string]", settings ) ) {
+            return false;
+        }
 
         // If type is user-defined type (IDENTIFIER) then we must verify the UDT was declared
         SymbolType symbolType;
         if( node.variable.type.type.type == TokenType::TOKEN_IDENTIFIER ) {
-            std::string typeId = expectTokenString( node.variable.type.type, "Internal compiler error (ConstDeclaration node.variable.type.type not a string type)" );
-            auto udtQuery = settings.symbols.findSymbol( settings.fileId, typeId );
+            auto typeId = expectTokenString( node.variable.type.type, "Internal compiler error (ConstDeclaration node.variable.type.type not a string type)", settings );
+            if( !typeId ) {
+                return false;
+            }
+
+            auto udtQuery = settings.symbols.findSymbol( settings.fileId, *typeId );
             if( !udtQuery || !std::holds_alternative< UdtSymbol >( udtQuery->symbol ) ) {
-                Error{ "Undeclared user-defined type: " + typeId, node.variable.type.type }.throwException();
+                return fail( settings, Error{ "Undeclared user-defined type: " + *typeId, node.variable.type.type.span } );
             }
 
-            symbolType = SymbolUdtType{ typeId };
+            symbolType = SymbolUdtType{ *typeId };
         } else {
             symbolType = SymbolNativeType{ node.variable.type.type.type };
         }
 
+        // Constant arrays are built by functions evaluated at compile time
+        auto declaredType = wrapArrayType( node.variable.type, symbolType, false, settings );
+        if( !declaredType ) {
+            return false;
+        }
+        symbolType = *declaredType;
+
         auto identifierTitle = getIdentifierName( node.variable.name );
         if( !identifierTitle ) {
-            Error{ "Internal compiler error (ConstDeclaration variable.name is not an identifier)", node.variable.name }.throwException();
+            return fail( settings, Error{ "Internal compiler error (ConstDeclaration variable.name is not an identifier)", node.variable.name.span } );
         }
 
         // Validate expression
-        check( *node.value, settings );
+        if( !check( *node.value, settings ) ) {
+            return false;
+        }
 
         // Get type of expression
         auto expressionType = getType( *node.value, SymbolTypeSettings{ settings.fileId, settings.symbols } );
         if( !expressionType ) {
-            Error{ "Internal compiler error (ConstDeclaration validated Expression failed to yield a type)", {} }.throwException();
+            return fail( settings, Error{ expressionType.getError(), settings.nearestSpan } );
         }
 
         if( !( typesMatch( symbolType, *expressionType, SymbolTypeSettings{ settings.fileId, settings.symbols } ) || integerTypesMatch( symbolType, *expressionType ) || assignmentCoercible( symbolType, *expressionType ) ) ) {
-            Error{ "Type mismatch: Expected type " + getSymbolTypeId( symbolType ) + " but expression is of type " + getSymbolTypeId( *expressionType ), node.variable.type.type }.throwException();
+            return fail( settings, Error{ "Type mismatch: Expected type " + getSymbolTypeId( symbolType ) + " but expression is of type " + getSymbolTypeId( *expressionType ), node.variable.type.type.span } );
         }
 
         // Get constant value and add constant to symbol table
         std::stack< ConstantExpressionValue > stack;
+        auto value = evaluateConst( *node.value, ConstEvaluationSettings{ settings.fileId, stack, settings.symbols, settings.nearestSpan, settings.functions } );
+        if( !value ) {
+            return fail( settings, value.getError() );
+        }
+
+        ConstantExpressionValue constant = value.claim();
+        if( auto nativeType = std::get_if< SymbolNativeType >( &symbolType ) ) {
+            constant = narrowToType( std::move( constant ), nativeType->type );
+        }
+
         settings.symbols.addSymbol( settings.fileId, Symbol{
-            ConstantSymbol{ *identifierTitle, symbolType, evaluateConst( *node.value, ConstEvaluationSettings{ settings.fileId, stack, settings.symbols, settings.nearestToken } ) },
+            ConstantSymbol{ *identifierTitle, symbolType, std::move( constant ) },
             false
         } );
+        return true;
     }
 
-    static void check( const ReturnStatement& node, VerifierSettings settings ) {
+    static bool check( const ReturnStatement& node, VerifierSettings settings ) {
         // Return statement never valid outside function
         if( !settings.withinFunction ) {
-            Error{ "Return statement not valid outside of function body", settings.nearestToken }.throwException();
+            return fail( settings, Error{ "Return statement not valid outside of function body", settings.nearestSpan } );
         }
 
         // Return statement not valid if return type is specified but ReturnStatement expression is not
         if( !node.expression ) {
             if( settings.functionReturnType ) {
-                Error{ "Return statement must return expression of type " + getSymbolTypeId( *settings.functionReturnType ), settings.nearestToken }.throwException();
+                return fail( settings, Error{ "Return statement must return expression of type " + getSymbolTypeId( *settings.functionReturnType ), settings.nearestSpan } );
             }
         } else {
             // If expression is provided it must both validate and be the same type as the function
             // Return statement not valid if return type is not specified but ReturnStatement expression is
             if( !settings.functionReturnType ) {
-                Error{ "Return statement must not return expression for function of void return type", settings.nearestToken }.throwException();
+                return fail( settings, Error{ "Return statement must not return expression for function of void return type", settings.nearestSpan } );
             }
 
-            check( **node.expression, settings );
+            if( !check( **node.expression, settings ) ) {
+                return false;
+            }
 
             auto typeId = getType( **node.expression, SymbolTypeSettings{ settings.fileId, settings.symbols } );
             if( !typeId ) {
-                Error{ "Internal compiler error (ReturnStatement unable to determine type for expression)", settings.nearestToken }.throwException();
+                return fail( settings, Error{ typeId.getError(), settings.nearestSpan } );
             }
 
             if( !( typesMatch( *typeId, *settings.functionReturnType, SymbolTypeSettings{ settings.fileId, settings.symbols } ) || integerTypesMatch( *typeId, *settings.functionReturnType ) || assignmentCoercible( *typeId, *settings.functionReturnType ) ) ) {
-                Error{ "Return statement expression of type " + getSymbolTypeId( *typeId ) + " does not match function return type of " + getSymbolTypeId( *settings.functionReturnType ), settings.nearestToken }.throwException();
+                return fail( settings, Error{ "Return statement expression of type " + getSymbolTypeId( *typeId ) + " does not match function return type of " + getSymbolTypeId( *settings.functionReturnType ), settings.nearestSpan } );
             }
         }
+
+        return true;
     }
 
-    static void check( const FunctionDeclaration& node, VerifierSettings settings ) {
-        // Copy array instantly - it will be cleared by successive checks to the function body expressions
-        std::vector< PlatformAnnotationPackage > annotationPackages = settings.currentAnnotationPackage;
+    static bool checkInteger( const Expression& node, const std::string& description, VerifierSettings settings ) {
+        if( !check( node, settings ) ) {
+            return false;
+        }
+
+        auto type = getType( node, SymbolTypeSettings{ settings.fileId, settings.symbols } );
+        if( !type ) {
+            return fail( settings, Error{ type.getError(), settings.nearestSpan } );
+        }
+
+        if( !typeIsInteger( *type ) ) {
+            return fail( settings, Error{ "Expected: " + description + " of integer type, but expression is of type " + getSymbolTypeId( *type ), settings.nearestSpan } );
+        }
+
+        return true;
+    }
+
+    static bool checkBlock( const std::vector< std::unique_ptr< Declaration > >& body, VerifierSettings settings ) {
+        // Anything declared in a block is checked in place and goes out of scope with it
+        settings.deferredBodies = nullptr;
+        settings.symbols.openScope( settings.fileId );
+
+        bool valid = true;
+        for( const auto& declaration : body ) {
+            valid = check( *declaration, settings ) && valid;
+        }
+
+        settings.symbols.closeScope( settings.fileId );
+        return valid;
+    }
+
+    static bool check( const IfStatement& node, VerifierSettings settings ) {
+        // A broken condition or branch doesn't stop the rest of the statement from being checked
+        bool valid = true;
+        for( const auto& condition : node.conditions ) {
+            valid = checkInteger( *condition, "If condition", settings ) && valid;
+        }
+
+        for( const auto& body : node.bodies ) {
+            valid = checkBlock( body, settings ) && valid;
+        }
+
+        return valid;
+    }
+
+    static bool check( const WhileStatement& node, VerifierSettings settings ) {
+        bool condition = checkInteger( *node.condition, "While condition", settings );
+        return checkBlock( node.body, settings ) && condition;
+    }
+
+    static bool check( const ForStatement& node, VerifierSettings settings ) {
+        // for i = from to to [every step]
+        auto name = getIdentifierName( node.index );
+        if( !name ) {
+            return fail( settings, Error{ "Expected: Identifier as index of ForStatement", node.index.span } );
+        }
+
+        if( settings.symbols.findSymbol( settings.fileId, *name ) ) {
+            return fail( settings, Error{ "Redeclaration of identifier " + *name + " in the current scope", node.index.span } );
+        }
+
+        if(
+            !checkInteger( *node.from, "Start of for loop", settings ) ||
+            !checkInteger( *node.to, "End of for loop", settings ) ||
+            ( node.every && !checkInteger( **node.every, "Step of for loop", settings ) )
+        ) {
+            return false;
+        }
+
+        // The index is wide enough to hold both ends of the range
+        auto fromType = getType( *node.from, SymbolTypeSettings{ settings.fileId, settings.symbols } );
+        auto toType = getType( *node.to, SymbolTypeSettings{ settings.fileId, settings.symbols } );
+        SymbolNativeType indexType = promotePrimitiveTypes( std::get< SymbolNativeType >( *fromType ), std::get< SymbolNativeType >( *toType ) );
+
+        settings.symbols.openScope( settings.fileId );
+        settings.symbols.addSymbol( settings.fileId, Symbol{ VariableSymbol{ *name, indexType }, false } );
+        bool valid = checkBlock( node.body, settings );
+        settings.symbols.closeScope( settings.fileId );
+
+        return valid;
+    }
+
+    static std::optional< FunctionSignature > checkSignature( const FunctionDeclaration& node, VerifierSettings settings ) {
+        FunctionSignature signature;
 
         if( !node.name && !settings.anonymousFunctionPermitted ) {
-            Error{ "Anonymous function declaration not permitted here", settings.nearestToken }.throwException();
+            fail( settings, Error{ "Anonymous function declaration not permitted here", settings.nearestSpan } );
+            return {};
         }
 
-        std::optional< std::string > functionName;
         if( node.name ) {
-            expectTokenOfType( *node.name, TokenType::TOKEN_IDENTIFIER, "Name token not of identifier type" );
-            functionName = expectTokenString( *node.name, "Identifier token not of string type" );
+            if( !expectTokenOfType( *node.name, TokenType::TOKEN_IDENTIFIER, "Name token not of identifier type", settings ) ) {
+                return {};
+            }
+
+            signature.name = expectTokenString( *node.name, "Identifier token not of string type", settings );
+            if( !signature.name ) {
+                return {};
+            }
         }
 
         // - No arguments can have duplicate names
         // - No arguments can refer to undeclared user-defined types
         std::set< std::string > usedNames;
-        std::vector< SymbolArgument > arguments;
         for( const Parameter& parameter : node.arguments ) {
-            CheckedParameter checkedParameter = checkAndExtract( parameter, settings );
+            auto checkedParameter = checkAndExtract( parameter, settings );
+            if( !checkedParameter ) {
+                return {};
+            }
 
-            if( usedNames.count( checkedParameter.id ) ) {
-                Error{ "Duplicate argument identifier: " + checkedParameter.id, parameter.name }.throwException();
+            if( usedNames.count( checkedParameter->id ) ) {
+                fail( settings, Error{ "Duplicate argument identifier: " + checkedParameter->id, parameter.name.span } );
+                return {};
             } else {
-                usedNames.insert( checkedParameter.id );
+                usedNames.insert( checkedParameter->id );
             }
 
-            arguments.push_back( SymbolArgument { checkedParameter.id, checkedParameter.typeId } );
+            signature.arguments.push_back( SymbolArgument { checkedParameter->id, checkedParameter->typeId } );
         }
 
         // Return type must be a valid
         if( node.returnType ) {
-            expectTokenType( *node.returnType, "Internal compiler error (FunctionDeclaration return type identifier not of any discernable type)" );
-            if( node.returnType->type == TokenType::TOKEN_IDENTIFIER ) {
-                std::string typeId = expectTokenString( *node.returnType, "Internal compiler error (FunctionDeclaration return type identifier contains no string alternative)" );
-                auto udtQuery = settings.symbols.findSymbol( settings.fileId, typeId );
+            const Token& returnType = node.returnType->type;
+            if( !expectTokenType( returnType, "Internal compiler error (FunctionDeclaration return type identifier not of any discernable type)", settings ) ) {
+                return {};
+            }
+
+            SymbolType symbolType;
+            if( returnType.type == TokenType::TOKEN_IDENTIFIER ) {
+                auto typeId = expectTokenString( returnType, "Internal compiler error (FunctionDeclaration return type identifier contains no string alternative)", settings );
+                if( !typeId ) {
+                    return {};
+                }
+
+                auto udtQuery = settings.symbols.findSymbol( settings.fileId, *typeId );
                 if( !udtQuery || !std::holds_alternative< UdtSymbol >( udtQuery->symbol ) ) {
-                    Error{ "Undeclared user-defined type: " + typeId, *node.returnType }.throwException();
+                    fail( settings, Error{ "Undeclared user-defined type: " + *typeId, returnType.span } );
+                    return {};
                 }
 
-                settings.functionReturnType = SymbolUdtType{ typeId };
+                symbolType = SymbolUdtType{ *typeId };
             } else {
-                settings.functionReturnType = SymbolNativeType{ node.returnType->type };
+                symbolType = SymbolNativeType{ returnType.type };
+            }
+
+            signature.returnType = wrapArrayType( *node.returnType, symbolType, false, settings );
+            if( !signature.returnType ) {
+                return {};
             }
-        } else {
-            settings.functionReturnType = {};
         }
 
+        return signature;
+    }
+
+    static bool checkBody( const FunctionDeclaration& node, const FunctionSignature& signature, VerifierSettings settings ) {
+        settings.functionReturnType = signature.returnType;
+
         // All subdeclarations must validate properly - pass down settings
         settings.symbols.openScope( settings.fileId );
         // anonymousFunctionPermitted does not propagate, set within function
         settings.anonymousFunctionPermitted = true;
         settings.withinFunction = true;
+        // Anything declared in here is checked in place
+        settings.deferredBodies = nullptr;
         // Push arguments onto stack right-to-left so that they are in scope when subsequent checks are performed
-        for( auto argument = arguments.crbegin(); argument != arguments.crend(); ++argument ) {
+        for( auto argument = signature.arguments.crbegin(); argument != signature.arguments.crend(); ++argument ) {
             // Just gotta have something in scope with the ID + type ID
             settings.symbols.addSymbol(
                 settings.fileId,
@@ -622,148 +962,207 @@ namespace GoldScorpion {
                 }
             );
         }
+
+        // A broken declaration doesn't stop the rest of the body from being checked
+        bool valid = true;
         for( const auto& declaration : node.body ) {
-            check( *declaration, settings );
+            valid = check( *declaration, settings ) && valid;
         }
 
         // If function has return type, function must contain a return
         if( settings.functionReturnType && !containsReturn( node ) ) {
-            Error{ "Function has return type " + getSymbolTypeId( *settings.functionReturnType ) + " but function does not always return value of type", settings.nearestToken }.throwException();
+            valid = fail( settings, Error{ "Function has return type " + getSymbolTypeId( *settings.functionReturnType ) + " but function does not always return value of type", settings.nearestSpan } );
         }
 
         // This should clear anything done by the function including the pushed arguments
         settings.symbols.closeScope( settings.fileId );
+        return valid;
+    }
 
+    static bool registerFunction( const FunctionSignature& signature, VerifierSettings settings ) {
         // If function belongs to a type context, the validated function must be added as a field to the type
         // Otherwise, add the function to the stack
         if( settings.contextTypeId ) {
-            if( !functionName ) {
-                Error{ "Internal compiler error (Expected function name here)", settings.nearestToken }.throwException();
+            if( !signature.name ) {
+                return fail( settings, Error{ "Internal compiler error (Expected function name here)", settings.nearestSpan } );
             }
 
             settings.symbols.addFieldToSymbol( settings.fileId, *settings.contextTypeId, SymbolField {
-                *functionName,
-               FunctionSymbol { *functionName, arguments, settings.functionReturnType }
+                *signature.name,
+               FunctionSymbol { *signature.name, signature.arguments, signature.returnType }
             } );
         } else {
-            if( !functionName ) {
-                Error{ "Internal compiler error (Expected function name here; anonymous functions currently broken)", settings.nearestToken }.throwException();
+            if( !signature.name ) {
+                return fail( settings, Error{ "Internal compiler error (Expected function name here; anonymous functions currently broken)", settings.nearestSpan } );
             }
 
-            settings.symbols.addSymbol( settings.fileId, Symbol{ FunctionSymbol{ *functionName, arguments, settings.functionReturnType }, false } );
+            settings.symbols.addSymbol( settings.fileId, Symbol{ FunctionSymbol{ *signature.name, signature.arguments, signature.returnType }, false } );
+        }
+
+        return true;
+    }
+
+    static bool check( const FunctionDeclaration& node, VerifierSettings settings ) {
+        // Copy array instantly - it will be cleared by successive checks to the function body expressions
+        std::vector< PlatformAnnotationPackage > annotationPackages = settings.currentAnnotationPackage;
+
+        auto signature = checkSignature( node, settings );
+        if( !signature ) {
+            return false;
+        }
+
+        if( settings.deferredBodies ) {
+            // Signature goes in now so that every body can see every other function; the body is checked later
+            if( !registerFunction( *signature, settings ) ) {
+                return false;
+            }
+            settings.deferredBodies->push_back( DeferredFunctionBody{ &node, *signature, settings.contextTypeId, settings.nearestSpan } );
+            if( !settings.contextTypeId && signature->name ) {
+                settings.functions->declarations[ *signature->name ] = &node;
+            }
+        } else {
+            if( !checkBody( node, *signature, settings ) || !registerFunction( *signature, settings ) ) {
+                return false;
+            }
         }
 
         // After function is fully-validated, check annotations that may be attached
         for( const PlatformAnnotationPackage& package : annotationPackages ) {
-            m68k::md::checkFunction( package.id, settings.nearestToken, settings.functionReturnType );
+            if( auto error = m68k::md::checkFunction( package.id, settings.nearestSpan, signature->returnType ) ) {
+                return fail( settings, *error );
+            }
         }
+
+        return true;
     }
 
-    static void check( const TypeDeclaration& node, VerifierSettings settings ) {
+    static bool check( const TypeDeclaration& node, VerifierSettings settings ) {
         // Type name is a single token of string type
-        expectTokenOfType( node.name, TokenType::TOKEN_IDENTIFIER, "Internal compiler error (TypeDeclaration token not of identifier type)" );
-        std::string typeId = expectTokenString( node.name, "Internal compiler error (TypeDeclaration token of identifier type contains no string alternative)" );
+        if( !expectTokenOfType( node.name, TokenType::TOKEN_IDENTIFIER, "Internal compiler error (TypeDeclaration token not of identifier type)", settings ) ) {
+            return false;
+        }
+        auto typeId = expectTokenString( node.name, "Internal compiler error (TypeDeclaration token of identifier type contains no string alternative)", settings );
+        if( !typeId ) {
+            return false;
+        }
 
         // Typeid must not already exist in the current scope
-        if( settings.symbols.findSymbol( settings.fileId, typeId ) ) {
-            Error{ "Redeclaration of symbol " + typeId + " in the current scope", node.name }.throwException();
+        if( settings.symbols.findSymbol( settings.fileId, *typeId ) ) {
+            return fail( settings, Error{ "Redeclaration of symbol " + *typeId + " in the current scope", node.name.span } );
         }
 
         // Each parameter must contain an identifier/string token and either a primitive type or a declared user-defined type
         // No two fields may have the same name
-        std::set< std::string > declaredNames;
-        std::vector< SymbolField > fields;
+        // Each field is given its slot in the instance as it is added
+        UdtSymbol udt;
+        udt.id = *typeId;
         for( const Parameter& parameter : node.fields ) {
-            CheckedParameter checkedParameter = checkAndExtract( parameter, settings );
+            auto checkedParameter = checkAndExtract( parameter, settings );
+            if( !checkedParameter ) {
+                return false;
+            }
 
-            if( declaredNames.count( checkedParameter.id ) ) {
-                Error{ "Redeclaration of user-defined type field: " + checkedParameter.id, parameter.name }.throwException();
-            } else {
-                declaredNames.insert( checkedParameter.id );
+            if( fieldPresent( checkedParameter->id, udt ) ) {
+                return fail( settings, Error{ "Redeclaration of user-defined type field: " + checkedParameter->id, parameter.name.span } );
             }
 
-            fields.push_back( SymbolField {
-                checkedParameter.id,
+            auto layout = getTypeLayout( checkedParameter->typeId, SymbolTypeSettings{ settings.fileId, settings.symbols } );
+            if( !layout ) {
+                return fail( settings, Error{ "Internal compiler error (unable to determine storage for field " + checkedParameter->id + ")", parameter.name.span } );
+            }
+
+            addUdtField( udt, SymbolField {
+                checkedParameter->id,
                 VariableSymbol {
-                    checkedParameter.id,
-                    checkedParameter.typeId
+                    checkedParameter->id,
+                    checkedParameter->typeId
                 }
-            } );
+            }, layout );
         }
 
         // User-defined type must contain at least one field
-        if( fields.empty() ) {
-            Error{ "User-defined type must declare at least one field", node.name }.throwException();
+        if( udt.fields.empty() ) {
+            return fail( settings, Error{ "User-defined type must declare at least one field", node.name.span } );
         }
 
         // For all functions inside this type, set the contextTypeId so that "this" tokens may have obtainable types
-        settings.contextTypeId = typeId;
+        settings.contextTypeId = *typeId;
 
         // Add the user-defined type to the symbol table
-        settings.symbols.addSymbol( settings.fileId, Symbol{ UdtSymbol{ typeId, fields }, false } );
+        settings.symbols.addSymbol( settings.fileId, Symbol{ std::move( udt ), false } );
 
         // Check all member functions
+        bool valid = true;
         for( const std::unique_ptr< FunctionDeclaration >& function : node.functions ) {
-            check( *function, settings );
+            valid = check( *function, settings ) && valid;
         }
+
+        return valid;
     }
 
-    static void check( const Annotation& node, VerifierSettings settings ) {
+    static bool check( const Annotation& node, VerifierSettings settings ) {
         // Must be at least one directive
         if( node.directives.empty() ) {
-            Error{ "Must provide at least one expression for annotation", settings.nearestToken }.throwException();
+            return fail( settings, Error{ "Must provide at least one expression for annotation", settings.nearestSpan } );
         }
 
         // Attempt to get a seties of annotation packages
         // The package will be consumed by the next declaration
-        settings.currentAnnotationPackage = getAnnotationPackageList( node, PlatformAnnotationSettings{ settings.symbols, settings.nearestToken } );
+        auto packages = getAnnotationPackageList( node, PlatformAnnotationSettings{ settings.symbols, settings.nearestSpan } );
+        if( !packages ) {
+            return fail( settings, packages.getError() );
+        }
+
+        settings.currentAnnotationPackage = packages.claim();
+        return true;
     }
 
-    static void check( const ImportDeclaration& node, VerifierSettings settings ) {
+    static bool check( const ImportDeclaration& node, VerifierSettings settings ) {
         // ImportDeclaration only valid at top level declaration
         if( !settings.topLevelPermitted ) {
-            Error{ "ImportDeclaration only valid at top level of file", settings.nearestToken }.throwException();
+            return fail( settings, Error{ "ImportDeclaration only valid at top level of file", settings.nearestSpan } );
         }
 
         if( node.path == "" || node.path.empty() ) {
-            Error{ "ImportDeclaration must contain valid path", settings.nearestToken }.throwException();
+            return fail( settings, Error{ "ImportDeclaration must contain valid path", settings.nearestSpan } );
         }
 
         // Actual path will be validated by the file function
+        return true;
     }
 
-    static void check( const Statement& node, VerifierSettings settings ) {
-        settings.nearestToken = node.nearestToken;
+    static bool check( const Statement& node, VerifierSettings settings ) {
+        settings.nearestSpan = node.nearestSpan;
 
-        std::visit( overloaded {
+        return std::visit( overloaded {
 
-            [ &settings ]( const std::unique_ptr< ExpressionStatement >& statement ) { check( *(statement->value), settings ); },
-			[]( const std::unique_ptr< ForStatement >& statement ) { Error{ "Internal compiler error (Statement check not implemented for statement subtype ForStatement)", {} }.throwException(); },
-			[]( const std::unique_ptr< IfStatement >& statement ) { Error{ "Internal compiler error (Statement check not implemented for statement subtype IfStatement)", {} }.throwException(); },
-			[ &settings ]( const std::unique_ptr< ReturnStatement >& statement ) { check( *statement, settings ); },
-			[]( const std::unique_ptr< AsmStatement >& statement ) { Error{ "Internal compiler error (Statement check not implemented for statement subtype AsmStatement)", {} }.throwException(); },
-			[]( const std::unique_ptr< WhileStatement >& statement ) { Error{ "Internal compiler error (Statement check not implemented for statement subtype WhileStatement)", {} }.throwException(); }
+            [ &settings ]( const std::unique_ptr< ExpressionStatement >& statement ) { return check( *(statement->value), settings ); },
+			[ &settings ]( const std::unique_ptr< ForStatement >& statement ) { return check( *statement, settings ); },
+			[ &settings ]( const std::unique_ptr< IfStatement >& statement ) { return check( *statement, settings ); },
+			[ &settings ]( const std::unique_ptr< ReturnStatement >& statement ) { return check( *statement, settings ); },
+			[ &settings ]( const std::unique_ptr< AsmStatement >& statement ) { return fail( settings, Error{ "Internal compiler error (Statement check not implemented for statement subtype AsmStatement)", {} } ); },
+			[ &settings ]( const std::unique_ptr< WhileStatement >& statement ) { return check( *statement, settings ); }
 
         }, node.value );
     }
 
-    static void check( const Declaration& node, VerifierSettings settings ) {
-        settings.nearestToken = node.nearestToken;
+    static bool check( const Declaration& node, VerifierSettings settings ) {
+        settings.nearestSpan = node.nearestSpan;
         bool freshAnnotation = false;
 
         if( !std::holds_alternative< std::unique_ptr< ImportDeclaration > >( node.value ) ) {
             settings.topLevelPermitted = false;
         }
 
-        std::visit( overloaded {
+        bool valid = std::visit( overloaded {
 
-            [ &settings, &freshAnnotation ]( const std::unique_ptr< Annotation >& declaration ) { check( *declaration, settings ); freshAnnotation = true; },
-            [ &settings ]( const std::unique_ptr< VarDeclaration >& declaration ) { check( *declaration, settings ); },
-            [ &settings ]( const std::unique_ptr< ConstDeclaration >& declaration ) { check( *declaration, settings ); },
-            [ &settings ]( const std::unique_ptr< FunctionDeclaration >& declaration ) { check( *declaration, settings ); },
-            [ &settings ]( const std::unique_ptr< TypeDeclaration >& declaration ) { check( *declaration, settings ); },
-            [ &settings ]( const std::unique_ptr< ImportDeclaration >& declaration ) { check( *declaration, settings ); },
-            [ &settings ]( const std::unique_ptr< Statement >& declaration ) { check( *declaration, settings ); }
+            [ &settings, &freshAnnotation ]( const std::unique_ptr< Annotation >& declaration ) { freshAnnotation = true; return check( *declaration, settings ); },
+            [ &settings ]( const std::unique_ptr< VarDeclaration >& declaration ) { return check( *declaration, settings ); },
+            [ &settings ]( const std::unique_ptr< ConstDeclaration >& declaration ) { return check( *declaration, settings ); },
+            [ &settings ]( const std::unique_ptr< FunctionDeclaration >& declaration ) { return check( *declaration, settings ); },
+            [ &settings ]( const std::unique_ptr< TypeDeclaration >& declaration ) { return check( *declaration, settings ); },
+            [ &settings ]( const std::unique_ptr< ImportDeclaration >& declaration ) { return check( *declaration, settings ); },
+            [ &settings ]( const std::unique_ptr< Statement >& declaration ) { return check( *declaration, settings ); }
 
         }, node.value );
 
@@ -771,24 +1170,112 @@ namespace GoldScorpion {
         if( !freshAnnotation ) {
             settings.currentAnnotationPackage.clear();
         }
+
+        return valid;
     }
 
     /**
      * Run a verification step to make sure items are logically consistent
+     *
+     * Verification runs in two phases. The first phase walks the file in order, registering types, constants,
+     * variables and function signatures. Function bodies cannot affect one another once every signature is
+     * known, so the second phase checks them in parallel, each against its own fork of the symbol table.
+     * Errors are reported to the Diagnostics sink and checking carries on with the next declaration, so one pass
+     * reports everything it can. The return value says whether the program verified.
      */
-    std::optional< std::string > check( const std::string& fileId, const Program& program, SymbolResolver& symbols ) {
+    bool check(
+        const std::string& fileId,
+        const Program& program,
+        SymbolResolver& symbols,
+        Diagnostics& diagnostics,
+        const std::function< bool( const FunctionDeclaration& ) >& bodyFilter,
+        std::map< const FunctionDeclaration*, Diagnostics >& bodyDiagnostics
+    ) {
         std::vector< PlatformAnnotationPackage > currentAnnotationPackage;
+        std::vector< DeferredFunctionBody > deferredBodies;
+        FunctionTable functions;
+
+        Diagnostics fileDiagnostics;
+
+        // A body a constant calls is checked on the first call, before phase 2 gets to it. No result yet means
+        // the check is underway, and a constant in a body calling back into it is refused.
+        std::map< const FunctionDeclaration*, std::optional< bool > > constBodies;
+        std::recursive_mutex constBodiesLock;
+        functions.verify = [ & ]( const FunctionDeclaration& node ) {
+            std::lock_guard< std::recursive_mutex > guard( constBodiesLock );
+            auto checked = constBodies.find( &node );
+            if( checked != constBodies.end() ) {
+                return checked->second.value_or( false );
+            }
 
-        VerifierSettings settings{ fileId, symbols, currentAnnotationPackage, {}, {}, {}, false, false, true };
-        for( const auto& declaration : program.statements ) {
-            try {
-                check( *declaration, settings );
-            } catch( std::runtime_error e ) {
-                return e.what();
+            auto deferred = std::find_if( deferredBodies.begin(), deferredBodies.end(), [ &node ]( const DeferredFunctionBody& body ) { return body.node == &node; } );
+            if( deferred == deferredBodies.end() ) {
+                return false;
             }
+
+            constBodies[ &node ] = std::nullopt;
+            SymbolResolver scopedSymbols = symbols.fork();
+            Diagnostics discarded;
+            std::vector< PlatformAnnotationPackage > annotationPackage;
+            VerifierSettings bodySettings{ fileId, scopedSymbols, discarded, annotationPackage, deferred->nearestSpan, deferred->contextTypeId, {}, true, true, false, nullptr, &functions };
+            bool valid = checkBody( node, deferred->signature, bodySettings ) && discarded.empty();
+            constBodies[ &node ] = valid;
+            return valid;
+        };
+
+        VerifierSettings settings{ fileId, symbols, fileDiagnostics, currentAnnotationPackage, {}, {}, {}, false, false, true, &deferredBodies, &functions };
+        bool valid = true;
+        for( const auto& declaration : program.statements ) {
+            valid = check( *declaration, settings ) && valid;
         }
 
-        return {};
+        // The full list stays put for constants in phase 2 that call a body the filter leaves out
+        std::vector< DeferredFunctionBody > filteredBodies;
+        std::copy_if( deferredBodies.begin(), deferredBodies.end(), std::back_inserter( filteredBodies ), [ & ]( const DeferredFunctionBody& deferred ) { return bodyFilter( *deferred.node ); } );
+
+        // Each body reports into its own sink, so the bodies can be checked in parallel
+        std::vector< Diagnostics > bodySinks( filteredBodies.size() );
+        Utility::parallelFor( filteredBodies.size(), [ & ]( size_t i ) {
+            const DeferredFunctionBody& deferred = filteredBodies[ i ];
+            Phase phase( fileId, "check-body", deferred.signature.name.value_or( "" ) );
+            SymbolResolver scopedSymbols = symbols.fork();
+            std::vector< PlatformAnnotationPackage > annotationPackage;
+
+            // Phase 1 is done with the function table, so every body can read it at once; verify takes a lock
+            VerifierSettings bodySettings{ fileId, scopedSymbols, bodySinks[ i ], annotationPackage, deferred.nearestSpan, deferred.contextTypeId, {}, true, true, false, nullptr, &functions };
+            checkBody( *deferred.node, deferred.signature, bodySettings );
+        } );
+
+        for( size_t i = 0; i != filteredBodies.size(); i++ ) {
+            valid = bodySinks[ i ].empty() && valid;
+            bodyDiagnostics[ filteredBodies[ i ].node ] = std::move( bodySinks[ i ] );
+        }
+
+        diagnostics.append( fileDiagnostics );
+
+        return valid;
+    }
+
+    bool check( const std::string& fileId, const Program& program, SymbolResolver& symbols, Diagnostics& diagnostics ) {
+        Diagnostics fileDiagnostics;
+        std::map< const FunctionDeclaration*, Diagnostics > bodyDiagnostics;
+        // Every body is checked; note the order they come in so they merge back deterministically
+        std::vector< const FunctionDeclaration* > bodies;
+        auto everyBody = [ &bodies ]( const FunctionDeclaration& node ) {
+            bodies.push_back( &node );
+            return true;
+        };
+        bool valid = check( fileId, program, symbols, fileDiagnostics, everyBody, bodyDiagnostics );
+
+        for( const FunctionDeclaration* body : bodies ) {
+            fileDiagnostics.append( bodyDiagnostics[ body ] );
+        }
+
+        // Bodies were checked after everything else, so put the file back in source order
+        fileDiagnostics.sortByPosition();
+        diagnostics.append( fileDiagnostics );
+
+        return valid;
     }
 
 }
\ No newline at end of file
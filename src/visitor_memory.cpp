@@ -0,0 +1,294 @@
+#include "visitor_memory.hpp"
+#include "variant_visitor.hpp"
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+namespace GoldScorpion {
+
+	struct KindTally {
+		size_t count = 0;
+		size_t bytes = 0;
+	};
+
+	struct MemoryCensus {
+		// Node bytes are the node itself plus the buffers of any vectors it owns
+		std::map< std::string, KindTally > kinds;
+		size_t tokens = 0;
+		size_t tokenStringBytes = 0;
+		size_t tokenSpanBytes = 0;
+		size_t nearestSpanBytes = 0;
+		size_t deepestExpression = 0;
+
+		void node( const char* kind, size_t bytes ) {
+			KindTally& tally = kinds[ kind ];
+			tally.count++;
+			tally.bytes += bytes;
+		}
+	};
+
+	// Forward declarations
+	static void visit( const Expression& node, MemoryCensus& census, size_t depth );
+	static void visit( const Primary& node, MemoryCensus& census, size_t depth );
+	static void visit( const Declaration& node, MemoryCensus& census );
+	// End forward declarations
+
+	template< typename Element >
+	static size_t bufferBytes( const std::vector< Element >& vector ) {
+		return vector.capacity() * sizeof( Element );
+	}
+
+	// Short strings live inside the string object and cost nothing beyond the node that holds them
+	static size_t heapBytes( const std::string& string ) {
+		const char* object = reinterpret_cast< const char* >( &string );
+		if( string.data() >= object && string.data() < object + sizeof( std::string ) ) {
+			return 0;
+		}
+
+		return string.capacity() + 1;
+	}
+
+	static void visit( const Token& token, MemoryCensus& census ) {
+		census.tokens++;
+		census.tokenSpanBytes += sizeof( SourceSpan );
+
+		if( token.value ) {
+			if( auto string = std::get_if< std::string >( &*token.value ) ) {
+				census.tokenStringBytes += heapBytes( *string );
+			}
+		}
+	}
+
+	static void visit( const DataType& node, MemoryCensus& census ) {
+		visit( node.type, census );
+		for( const Token& token : node.arrayDimensions ) {
+			visit( token, census );
+		}
+	}
+
+	static void visit( const Parameter& node, MemoryCensus& census ) {
+		visit( node.name, census );
+		visit( node.type, census );
+	}
+
+	static void visit( const AssignmentExpression& node, MemoryCensus& census, size_t depth ) {
+		census.node( "AssignmentExpression", sizeof( node ) );
+		visit( *node.identifier, census, depth + 1 );
+		visit( *node.expression, census, depth + 1 );
+	}
+
+	static void visit( const BinaryExpression& node, MemoryCensus& census, size_t depth ) {
+		census.node( "BinaryExpression", sizeof( node ) );
+		visit( *node.lhsValue, census, depth + 1 );
+		visit( *node.op, census, depth );
+		visit( *node.rhsValue, census, depth + 1 );
+	}
+
+	static void visit( const UnaryExpression& node, MemoryCensus& census, size_t depth ) {
+		census.node( "UnaryExpression", sizeof( node ) );
+		visit( *node.op, census, depth );
+		visit( *node.value, census, depth + 1 );
+	}
+
+	static void visit( const CallExpression& node, MemoryCensus& census, size_t depth ) {
+		census.node( "CallExpression", sizeof( node ) + bufferBytes( node.arguments ) );
+		visit( *node.identifier, census, depth + 1 );
+		for( const std::unique_ptr< Expression >& argument : node.arguments ) {
+			visit( *argument, census, depth + 1 );
+		}
+	}
+
+	static void visit( const ArrayExpression& node, MemoryCensus& census, size_t depth ) {
+		census.node( "ArrayExpression", sizeof( node ) + bufferBytes( node.indices ) );
+		visit( *node.identifier, census, depth + 1 );
+		for( const std::unique_ptr< Expression >& index : node.indices ) {
+			visit( *index, census, depth + 1 );
+		}
+	}
+
+	static void visit( const Primary& node, MemoryCensus& census, size_t depth ) {
+		census.node( "Primary", sizeof( node ) );
+
+		std::visit( overloaded {
+			[ &census ]( const Token& token ) { visit( token, census ); },
+			[ &census, depth ]( const std::unique_ptr< Expression >& expression ) { visit( *expression, census, depth + 1 ); }
+		}, node.value );
+	}
+
+	static void visit( const Expression& node, MemoryCensus& census, size_t depth ) {
+		census.node( "Expression", sizeof( node ) );
+		census.nearestSpanBytes += sizeof( node.nearestSpan );
+		census.deepestExpression = std::max( census.deepestExpression, depth );
+
+		std::visit( overloaded {
+			[ &census, depth ]( const std::unique_ptr< AssignmentExpression >& expression ) { visit( *expression, census, depth ); },
+			[ &census, depth ]( const std::unique_ptr< BinaryExpression >& expression ) { visit( *expression, census, depth ); },
+			[ &census, depth ]( const std::unique_ptr< UnaryExpression >& expression ) { visit( *expression, census, depth ); },
+			[ &census, depth ]( const std::unique_ptr< CallExpression >& expression ) { visit( *expression, census, depth ); },
+			[ &census, depth ]( const std::unique_ptr< ArrayExpression >& expression ) { visit( *expression, census, depth ); },
+			[ &census, depth ]( const std::unique_ptr< Primary >& expression ) { visit( *expression, census, depth ); }
+		}, node.value );
+	}
+
+	static void visit( const std::vector< std::unique_ptr< Declaration > >& body, MemoryCensus& census ) {
+		for( const auto& declaration : body ) {
+			visit( *declaration, census );
+		}
+	}
+
+	static void visit( const ForStatement& node, MemoryCensus& census ) {
+		census.node( "ForStatement", sizeof( node ) + bufferBytes( node.body ) );
+		visit( node.index, census );
+		visit( *node.from, census, 1 );
+		visit( *node.to, census, 1 );
+		if( node.every ) {
+			visit( **node.every, census, 1 );
+		}
+		visit( node.body, census );
+	}
+
+	static void visit( const IfStatement& node, MemoryCensus& census ) {
+		size_t bytes = sizeof( node ) + bufferBytes( node.conditions ) + bufferBytes( node.bodies );
+		for( const auto& body : node.bodies ) {
+			bytes += bufferBytes( body );
+		}
+		census.node( "IfStatement", bytes );
+
+		for( const auto& condition : node.conditions ) {
+			visit( *condition, census, 1 );
+		}
+		for( const auto& body : node.bodies ) {
+			visit( body, census );
+		}
+	}
+
+	static void visit( const ReturnStatement& node, MemoryCensus& census ) {
+		census.node( "ReturnStatement", sizeof( node ) );
+		if( node.expression ) {
+			visit( **node.expression, census, 1 );
+		}
+	}
+
+	static void visit( const AsmStatement& node, MemoryCensus& census ) {
+		census.node( "AsmStatement", sizeof( node ) );
+		visit( node.body, census );
+	}
+
+	static void visit( const WhileStatement& node, MemoryCensus& census ) {
+		census.node( "WhileStatement", sizeof( node ) + bufferBytes( node.body ) );
+		visit( *node.condition, census, 1 );
+		visit( node.body, census );
+	}
+
+	static void visit( const ExpressionStatement& node, MemoryCensus& census ) {
+		census.node( "ExpressionStatement", sizeof( node ) );
+		visit( *node.value, census, 1 );
+	}
+
+	static void visit( const Statement& node, MemoryCensus& census ) {
+		census.node( "Statement", sizeof( node ) );
+		census.nearestSpanBytes += sizeof( node.nearestSpan );
+
+		std::visit( [ &census ]( const auto& statement ) { visit( *statement, census ); }, node.value );
+	}
+
+	static void visit( const VarDeclaration& node, MemoryCensus& census ) {
+		census.node( "VarDeclaration", sizeof( node ) + bufferBytes( node.variable.type.arrayDimensions ) );
+		visit( node.variable, census );
+		if( node.value ) {
+			visit( **node.value, census, 1 );
+		}
+	}
+
+	static void visit( const ConstDeclaration& node, MemoryCensus& census ) {
+		census.node( "ConstDeclaration", sizeof( node ) + bufferBytes( node.variable.type.arrayDimensions ) );
+		visit( node.variable, census );
+		visit( *node.value, census, 1 );
+	}
+
+	static void visit( const FunctionDeclaration& node, MemoryCensus& census ) {
+		size_t bytes = sizeof( node ) + bufferBytes( node.arguments ) + bufferBytes( node.body );
+		for( const Parameter& parameter : node.arguments ) {
+			bytes += bufferBytes( parameter.type.arrayDimensions );
+		}
+		census.node( "FunctionDeclaration", bytes );
+
+		if( node.name ) {
+			visit( *node.name, census );
+		}
+		for( const Parameter& parameter : node.arguments ) {
+			visit( parameter, census );
+		}
+		if( node.returnType ) {
+			visit( *node.returnType, census );
+		}
+		visit( node.body, census );
+	}
+
+	static void visit( const TypeDeclaration& node, MemoryCensus& census ) {
+		size_t bytes = sizeof( node ) + bufferBytes( node.fields ) + bufferBytes( node.functions );
+		for( const Parameter& field : node.fields ) {
+			bytes += bufferBytes( field.type.arrayDimensions );
+		}
+		census.node( "TypeDeclaration", bytes );
+
+		visit( node.name, census );
+		for( const Parameter& field : node.fields ) {
+			visit( field, census );
+		}
+		for( const auto& function : node.functions ) {
+			visit( *function, census );
+		}
+	}
+
+	static void visit( const ImportDeclaration& node, MemoryCensus& census ) {
+		census.node( "ImportDeclaration", sizeof( node ) + heapBytes( node.path ) );
+	}
+
+	static void visit( const Annotation& node, MemoryCensus& census ) {
+		census.node( "Annotation", sizeof( node ) + bufferBytes( node.directives ) );
+		for( const auto& expression : node.directives ) {
+			visit( *expression, census, 1 );
+		}
+	}
+
+	static void visit( const Declaration& node, MemoryCensus& census ) {
+		census.node( "Declaration", sizeof( node ) );
+		census.nearestSpanBytes += sizeof( node.nearestSpan );
+
+		std::visit( [ &census ]( const auto& declaration ) { visit( *declaration, census ); }, node.value );
+	}
+
+	void printAstMemory( const Program& program ) {
+		MemoryCensus census;
+		census.node( "Program", sizeof( program ) + bufferBytes( program.statements ) );
+		visit( program.statements, census );
+
+		std::vector< std::pair< std::string, KindTally > > kinds( census.kinds.begin(), census.kinds.end() );
+		std::stable_sort( kinds.begin(), kinds.end(), []( const auto& lhs, const auto& rhs ) { return lhs.second.bytes > rhs.second.bytes; } );
+
+		auto printLine = []( const std::string& name, const std::string& count, const std::string& bytes ) {
+			std::cout << std::left << std::setw( 24 ) << name << std::right << std::setw( 12 ) << count << std::setw( 14 ) << bytes << std::endl;
+		};
+
+		printLine( "Node", "Count", "Bytes" );
+
+		size_t nodeBytes = 0;
+		for( const auto& [ kind, tally ] : kinds ) {
+			printLine( kind, std::to_string( tally.count ), std::to_string( tally.bytes ) );
+			nodeBytes += tally.bytes;
+		}
+
+		std::cout << std::endl;
+		printLine( "All nodes", "", std::to_string( nodeBytes ) );
+		// Spans are stored inline, so they are part of the node bytes above rather than in addition to them
+		printLine( "  token spans", std::to_string( census.tokens ), std::to_string( census.tokenSpanBytes ) );
+		printLine( "  nearest spans", "", std::to_string( census.nearestSpanBytes ) );
+		printLine( "Token strings", "", std::to_string( census.tokenStringBytes ) );
+		printLine( "Total", "", std::to_string( nodeBytes + census.tokenStringBytes ) );
+		std::cout << std::endl << "Deepest expression nesting: " << census.deepestExpression << std::endl;
+	}
+
+}
\ No newline at end of file
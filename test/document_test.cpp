@@ -0,0 +1,44 @@
+#include "document.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace GoldScorpion;
+
+static int failures = 0;
+
+static void expectDiagnostic( const std::vector< DocumentDiagnostic >& diagnostics, uint32_t line, const std::string& message, const std::string& test ) {
+	for( const DocumentDiagnostic& diagnostic : diagnostics ) {
+		if( diagnostic.range.start.line == line && diagnostic.message == message ) {
+			return;
+		}
+	}
+
+	std::cerr << "FAIL " << test << ": no \"" << message << "\" on line " << line << std::endl;
+	failures++;
+}
+
+int main() {
+	// A declaration left unfinished at the end of the file is reported on its last line
+	Document opened( "opened.gs", "function q() as u16\n" );
+	expectDiagnostic( opened.getDiagnostics(), 1, "Expected: \"end\" token following function body", "unfinished function on open" );
+
+	Document edited( "edited.gs", "function q() as u16\n    return 1\nend\n" );
+	edited.edit( DocumentRange{ { 2, 0 }, { 2, 3 } }, "" );
+	expectDiagnostic( edited.getDiagnostics(), 3, "Expected: \"end\" token following function body", "missing end after edit" );
+
+	// A stray token is fallout only while recovering from the error before it
+	Document stray( "stray.gs", "def a as = 1\ndef b as u8 = 2\n) )\n" );
+	expectDiagnostic( stray.getDiagnostics(), 2, "Expected: Declaration or statement", "stray token after recovery" );
+	if( stray.getDiagnostics().size() != 2 ) {
+		std::cerr << "FAIL stray token after recovery: expected 2 diagnostics, got " << stray.getDiagnostics().size() << std::endl;
+		failures++;
+	}
+
+	if( failures ) {
+		return 1;
+	}
+
+	std::cout << "document_test passed" << std::endl;
+	return 0;
+}